@@ -0,0 +1,131 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#include "hscpp/mem/MemoryManager.h"
+
+// Compares dereferencing an hscpp::mem::Ref against dereferencing a raw pointer to the same
+// object. Build in Release to get meaningful numbers. Ref validation can be compiled out by
+// configuring with -DHSCPP_MEM_DISABLE_REF_CHECKS=ON.
+//
+// A Ref dereference is a lookup of a few dependent loads, so its cost is a fixed amount per
+// dereference rather than a fraction of the work done on the object. The target is an absolute
+// overhead on the order of a nanosecond per dereference. Relative to raw pointers, that is only
+// within a few percent when each dereference is followed by substantial work. For tiny updates
+// like the one below, expect tens of percent. Resolving a Ref once per object in hot loops, rather
+// than dereferencing it repeatedly, keeps the overhead to a single lookup.
+
+struct Particle
+{
+    float x = 0.f;
+    float y = 10.f;
+    float z = 0.f;
+    float vx = 1.f;
+    float vy = 0.f;
+    float vz = 0.5f;
+
+    // A typical small simulation step: apply gravity and drag, and bounce off the floor.
+    void Update(float dt)
+    {
+        vy -= 9.8f * dt;
+
+        vx *= 0.999f;
+        vy *= 0.999f;
+        vz *= 0.999f;
+
+        x += vx * dt;
+        y += vy * dt;
+        z += vz * dt;
+
+        if (y < 0.f)
+        {
+            y = -y;
+            vy = -vy;
+        }
+    }
+};
+
+const static size_t N_PARTICLES = 1 << 16;
+const static size_t N_PASSES = 200;
+const static float DT = 1.f / 60.f;
+
+static double Measure(const std::function<void()>& cb)
+{
+    // Warm up caches, then take the fastest of a few runs.
+    cb();
+
+    double best = 0.0;
+    for (int i = 0; i < 5; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        cb();
+        auto end = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        if (i == 0 || ns < best)
+        {
+            best = ns;
+        }
+    }
+
+    return best / static_cast<double>(N_PARTICLES * N_PASSES);
+}
+
+int main()
+{
+    hscpp::mem::MemoryManager::Config config;
+    config.reservedBlocks = N_PARTICLES;
+
+    hscpp::mem::UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+
+    std::vector<hscpp::mem::UniqueRef<Particle>> uniqueParticles;
+    std::vector<hscpp::mem::Ref<Particle>> refParticles;
+    std::vector<Particle*> rawParticles;
+
+    for (size_t i = 0; i < N_PARTICLES; ++i)
+    {
+        uniqueParticles.push_back(rMemoryManager->Allocate<Particle>());
+        refParticles.push_back(uniqueParticles.back());
+        rawParticles.push_back(&uniqueParticles.back());
+    }
+
+    // Both loops touch exactly the same objects, so only the cost of dereferencing differs.
+    double rawNs = Measure([&]() {
+        for (size_t iPass = 0; iPass < N_PASSES; ++iPass)
+        {
+            for (Particle* pParticle : rawParticles)
+            {
+                pParticle->Update(DT);
+            }
+        }
+    });
+
+    double refNs = Measure([&]() {
+        for (size_t iPass = 0; iPass < N_PASSES; ++iPass)
+        {
+            for (const hscpp::mem::Ref<Particle>& rParticle : refParticles)
+            {
+                rParticle->Update(DT);
+            }
+        }
+    });
+
+    float checksum = 0.f;
+    for (Particle* pParticle : rawParticles)
+    {
+        checksum += pParticle->x + pParticle->y + pParticle->z;
+    }
+
+#ifdef HSCPP_MEM_DISABLE_REF_CHECKS
+    std::cout << "Ref checks: disabled" << std::endl;
+#else
+    std::cout << "Ref checks: enabled" << std::endl;
+#endif
+
+    std::cout << "Raw pointer:     " << rawNs << " ns/access" << std::endl;
+    std::cout << "Ref:             " << refNs << " ns/access ("
+        << 100.0 * (refNs - rawNs) / rawNs << "% over raw)" << std::endl;
+    std::cout << "Ref overhead:    " << refNs - rawNs << " ns/access" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+}
@@ -3,11 +3,20 @@
 #include <vector>
 #include <cstdint>
 #include <limits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <type_traits>
 
 #include "hscpp/module/IAllocator.h"
 #include "hscpp/module/AllocationResolver.h"
 #include "hscpp/mem/Ref.h"
 #include "hscpp/mem/IMemoryManager.h"
+#include "hscpp/mem/SlabAllocator.h"
+#include "hscpp/mem/MemoryStats.h"
 
 namespace hscpp { namespace mem {
 
@@ -16,6 +25,12 @@ namespace hscpp { namespace mem {
         // Use the Create() function to make a new MemoryManager.
         MemoryManager(const MemoryManager&) = delete;
 
+        // Refs resolve their ids directly, without going through the IMemoryManager interface.
+        template <typename T> friend class Ref;
+        template <typename T> friend class UniqueRef;
+        template <typename T> friend class SharedRef;
+        template <typename T> friend class WeakRef;
+
     public:
         struct Config
         {
@@ -26,43 +41,293 @@ namespace hscpp { namespace mem {
             // Number of Blocks to reserve on initialization.
             uint64_t reservedBlocks = 100;
 
-            // Overridable Allocate/Free functions.
+            // Overridable Allocate/Free functions. Unless both are set, the MemoryManager's built-in
+            // SlabAllocator is used. Custom functions must return memory aligned to at least
+            // alignof(std::max_align_t); over-aligned types require the built-in allocator.
             std::function<uint8_t*(uint64_t size)> AllocateCb;
             std::function<void(uint8_t* pMemory)> FreeCb;
+
+            // Allow Refs to be allocated and freed from multiple threads. Each thread keeps a small
+            // cache of free Block indices, which is refilled from a lock-free global free list.
+            // Custom AllocateCb and FreeCb functions are serialized by the MemoryManager.
+            bool bConcurrent = false;
+
+            // Maximum number of threads that hold their own Block index cache at once, in concurrent
+            // mode. A thread gives its cache back when it exits. Additional threads use the global
+            // free list directly, until a cache becomes available.
+            uint64_t maxThreadCaches = 64;
         };
 
+        ~MemoryManager();
+
         static UniqueRef<MemoryManager> Create(const Config& config = Config());
 
         template <typename T>
         UniqueRef<T> Allocate();
 
-        // Free is handled by the UniqueRef when it goes out of scope. The UniqueRef will handle
-        // calling the destructor.
+        // Allocate an object with shared ownership. The reference count is stored alongside the
+        // object, and survives runtime swaps.
+        template <typename T>
+        SharedRef<T> AllocateShared();
+
+        // Allocate count objects, packed one after the other in a single allocation, so that
+        // walking the returned Refs in order walks memory linearly. Each object is still freed
+        // individually. Runtime swaps keep the objects together, as long as hscpp tracks them
+        // in the same order.
+        template <typename T>
+        std::vector<UniqueRef<T>> AllocateN(uint64_t count);
+
+        // Free is handled by the UniqueRef when it goes out of scope (or by the last SharedRef).
+        // The Ref will handle calling the destructor.
 
         uint64_t GetNumBlocks() const;
 
+        // Number of threads currently holding a Block index cache, in concurrent mode.
+        uint64_t GetNumThreadCaches() const;
+
+        // Take a snapshot of per-type allocation counters. Compare two snapshots with
+        // MemoryStats::Diff, ex. to find types that leak objects across a runtime swap.
+        MemoryStats GetStats() const;
+
+        // In concurrent mode, block until all in-flight allocations and frees have completed, and
+        // hold off new ones until ResumeTheWorld is called. The calling thread may continue to
+        // allocate. Call this before a runtime swap (ex. in Callbacks::BeforeSwap), and make sure
+        // no other thread dereferences a Ref while the swap is migrating objects. ResumeTheWorld
+        // must be called from the same thread.
+        //
+        // With an AllocationResolver, the hscpp trackers lock is taken before the world is stopped,
+        // and held until it resumes. Other threads finish constructing their tracked objects
+        // first, and cannot create or destroy tracked objects until then.
+        void StopTheWorld();
+        void ResumeTheWorld();
+
+        // Move the live objects of each HSCPP_TRACK type into one contiguous allocation, in the
+        // order hscpp tracks them. Objects are rebuilt exactly as in a runtime swap, so they keep
+        // their ids. Only types whose every instance has a swap handler are compacted, since the
+        // state of other types would be reset. Untracked objects are never moved, and nothing is
+        // done without an AllocationResolver.
+        //
+        // At most maxTypes types are compacted per call, so the work can be spread over several
+        // frames. Returns true once every tracked type has been compacted; the next call starts
+        // a new pass. In concurrent mode, this stops the world while objects are moved.
+        bool Compact(uint64_t maxTypes = (std::numeric_limits<uint64_t>::max)());
+
     private:
         struct BlockHeader
         {
-            uint64_t iBlock = INVALID_ID;
+            uint32_t iBlock = 0;
+
+            // Number of SharedRefs that own the object. Carried over into the new allocation
+            // during a runtime swap. Always 0 for objects owned by a UniqueRef.
+            std::atomic<uint32_t> nSharedRefs = { 0 };
         };
 
         struct Block
         {
-            // Get BlockHeader at location: pMemory - sizeof(BlockHeader)
+            // Start of the underlying allocation, which holds the padded BlockHeader followed by
+            // the object. During a swap, the Block's memory is null but the allocation is kept,
+            // so that it can be reused if the new object fits in the same size class.
+            uint8_t* pAllocation = nullptr;
+            uint64_t allocationSize = 0;
+            uint32_t headerSize = 0;
+
+            // Type of the object, and its size in bytes (0 if the Block holds no object).
+            uint32_t iTypeKey = 0;
+            uint64_t objectSize = 0;
+
+            // Region holding the allocation, stored as index + 1 (0 if allocated individually).
+            uint32_t iRegionPlusOne = 0;
+
+            // Next Block in the global free list, stored as index + 1 (0 terminates the list).
+            std::atomic<uint32_t> iNextFreePlusOne = { 0 };
+        };
+
+        struct TypeCounters
+        {
+            std::atomic<uint64_t> nLiveBlocks = { 0 };
+            std::atomic<uint64_t> liveBytes = { 0 };
+            std::atomic<uint64_t> nAllocations = { 0 };
+            std::atomic<uint64_t> nFrees = { 0 };
+            std::atomic<uint64_t> nSwaps = { 0 };
+            std::atomic<uint64_t> highWaterBlocks = { 0 };
+            std::atomic<uint64_t> highWaterBytes = { 0 };
+        };
+
+        // Contiguous allocation shared by compacted or bulk allocated objects of a single type. It is freed
+        // once all of them have been freed or moved out.
+        struct Region
+        {
             uint8_t* pMemory = nullptr;
+            uint64_t size = 0;
+            uint64_t nLiveBlocks = 0;
+        };
+
+        // Hands out consecutive slots of a single Region to a batch of objects of the same type,
+        // during a swap or a bulk allocation.
+        struct RegionBatch
+        {
+            // During a swap, whether every object is moved into the Region (ex. when compacting).
+            bool bActive = false;
+            uint64_t nInstances = 0;
+
+            uint32_t iRegion = 0;
+            uint8_t* pNextSlot = nullptr;
+            uint8_t* pRegionEnd = nullptr;
+            uint64_t slotSize = 0;
+        };
+
+        struct ThreadCache
+        {
+            std::vector<uint32_t> iFreeBlocks;
+
+            // Keep caches of different threads on different cache lines.
+            uint8_t padding[64 - sizeof(std::vector<uint32_t>)];
+        };
+
+        // Shared between a MemoryManager and the threads holding one of its ThreadCaches, so that a
+        // thread exiting after the MemoryManager has been destroyed leaves it alone.
+        struct ThreadCacheOwner
+        {
+            std::mutex mutex;
+            MemoryManager* pMemoryManager = nullptr;
+        };
+
+        struct BulkAllocation
+        {
+            uint32_t iTypeKey = 0;
+            RegionBatch batch;
+        };
+
+        // State of the allocations made by one thread.
+        struct ThreadState
+        {
+            // Null if the thread has no ThreadCache, ex. if every cache is taken.
+            ThreadCache* pCache = nullptr;
+
+            // Type of the object being allocated through Allocate<T>.
+            uint32_t iPendingTypeKey = UNKNOWN_TYPE_KEY;
+
+            // Bulk allocation in progress through AllocateN, if any.
+            BulkAllocation* pBulkAllocation = nullptr;
+        };
+
+        // ThreadStates of the current thread, whose ThreadCaches are given back when it exits.
+        class ThreadCacheGuard;
+
+        // Type keys registered so far, indexed by their number.
+        struct TypeKeyRegistry
+        {
+            mutable std::mutex mutex;
+            std::vector<std::string> keys = { "<unknown>" };
+            std::unordered_map<std::string, uint32_t> iKeysByKey;
+        };
+
+        // Places allocations of the given type made by the current thread into one Region, until
+        // the scope ends.
+        class BulkAllocationScope
+        {
+        public:
+            BulkAllocationScope(MemoryManager& memoryManager, uint64_t count, uint32_t iTypeKey);
+            ~BulkAllocationScope();
+
+        private:
+            MemoryManager& m_MemoryManager;
+            BulkAllocation m_BulkAllocation;
+            BulkAllocation* m_pPreviousBulkAllocation = nullptr;
+        };
+
+        // Enters the MemoryManager as a mutator of the Block lists. This is a no-op outside of
+        // concurrent mode, or if the current thread has stopped the world.
+        class MutatorScope
+        {
+        public:
+            explicit MutatorScope(MemoryManager& memoryManager);
+            ~MutatorScope();
+
+        private:
+            MemoryManager& m_MemoryManager;
+            bool m_bEntered = false;
         };
 
+        // Blocks are stored in fixed-size chunks, so that they never move once created. This lets
+        // GetMemory run without locks while other threads create new Blocks.
+        constexpr static uint64_t BLOCK_CHUNK_SHIFT = 12;
+        constexpr static uint64_t BLOCKS_PER_CHUNK = uint64_t(1) << BLOCK_CHUNK_SHIFT;
+        constexpr static uint64_t MAX_BLOCK_CHUNKS = 16384;
+
+        struct BlockChunk
+        {
+            // Data read on every Ref dereference is packed into separate arrays, so that walking
+            // many Refs touches as little memory as walking the equivalent raw pointers.
+            //
+            // Get BlockHeader at location: pMemory - sizeof(BlockHeader)
+            uint8_t* pMemory[BLOCKS_PER_CHUNK] = {};
+
+            // Incremented whenever a Block is released, so that Refs to a previous occupant of
+            // the Block can be detected. An id holds both the Block index and its generation.
+            std::atomic<uint32_t> generation[BLOCKS_PER_CHUNK] = {};
+
+            Block blocks[BLOCKS_PER_CHUNK];
+        };
+
+        // Type keys are numbered by each MemoryManager. Key 0 collects allocations of an unknown
+        // type, as well as any types past the maximum.
+        constexpr static uint32_t UNKNOWN_TYPE_KEY = 0;
+        constexpr static uint32_t MAX_TYPE_KEYS = 1024;
+
+        // Number of Block indices moved between a thread cache and the global free list at once.
+        constexpr static size_t THREAD_CACHE_BATCH_SIZE = 32;
+
         AllocationResolver* m_pAllocationResolver = nullptr;
 
         std::function<uint8_t*(uint64_t size)> m_AllocateCb;
         std::function<void(uint8_t* pMemory)> m_FreeCb;
 
-        std::vector<Block> m_Blocks;
+        bool m_bUseSlabAllocator = true;
+        SlabAllocator m_SlabAllocator;
+        std::mutex m_AllocatorMutex;
+
+        // Kept inline, to save an indirection on every Ref dereference.
+        std::atomic<BlockChunk*> m_BlockChunks[MAX_BLOCK_CHUNKS] = {};
+        std::mutex m_BlockChunksMutex;
+        std::atomic<uint64_t> m_nCreatedBlocks = { 0 };
+        std::atomic<uint64_t> m_nUsedBlocks = { 0 };
+
+        // Head of the global free list. The lower 32 bits hold the first free Block index + 1, and
+        // the upper 32 bits hold a tag that is incremented on every update, avoiding ABA issues.
+        std::atomic<uint64_t> m_FreeListHead = { 0 };
+
+        bool m_bConcurrent = false;
+        std::unique_ptr<ThreadCache[]> m_pThreadCaches;
+        uint64_t m_nThreadCaches = 0;
+
+        // One bit per ThreadCache, which is set while a thread holds it.
+        std::unique_ptr<std::atomic<uint64_t>[]> m_pUsedThreadCaches;
+        std::shared_ptr<ThreadCacheOwner> m_pThreadCacheOwner;
+
+        // Outside of concurrent mode, the single thread allowed to allocate uses this state.
+        ThreadState m_ThreadState;
 
-        uint64_t m_iFreeBlocksBegin = 0;
-        std::vector<uint64_t> m_FreeBlockIndices;
-        std::vector<uint64_t> m_FreeBlockIndexByBlock;
+        std::mutex m_WorldMutex;
+        std::atomic<bool> m_bWorldStopped = { false };
+        std::atomic<std::thread::id> m_WorldOwner = { std::thread::id() };
+        std::atomic<uint64_t> m_nActiveMutators = { 0 };
+        std::unique_lock<std::recursive_mutex> m_TrackersLock;
+
+        std::unique_ptr<TypeCounters[]> m_pTypeCounters;
+        TypeKeyRegistry m_TypeKeys;
+
+        // Identifies this MemoryManager in caches of its type keys, which may outlive it.
+        uint64_t m_InstanceId = 0;
+
+        // Regions are guarded by m_AllocatorMutex in concurrent mode.
+        std::vector<Region> m_Regions;
+        std::vector<uint32_t> m_iFreeRegions;
+
+        std::atomic<bool> m_bCompacting = { false };
+        RegionBatch m_SwapBatch;
+        std::vector<std::string> m_CompactionKeys;
+        size_t m_iNextCompactionKey = 0;
 
         MemoryManager() = default;
 
@@ -70,45 +335,398 @@ namespace hscpp { namespace mem {
         // Used by Ref to get underlying memory for a given id. Note that the returned pointer
         // may change for the same id, should a runtime swap take place.
         uint8_t* GetMemory(uint64_t id) override;
-        void FreeBlock(uint64_t iBlock, bool bReleaseReservation) override;
+        void FreeBlock(uint64_t id, bool bReleaseReservation) override;
 
         // hscpp::IAllocator
         AllocationInfo Hscpp_Allocate(uint64_t size) override;
         AllocationInfo Hscpp_AllocateSwap(uint64_t previousId, uint64_t size) override;
         uint64_t Hscpp_FreeSwap(uint8_t* pMemory) override;
+        void Hscpp_BeginSwapBatch(const char* pKey, uint64_t nInstances) override;
+        void Hscpp_EndSwapBatch() override;
+
+        // Resolve an id to its memory, returning nullptr for an invalid or stale id. Inlined into
+        // Ref dereferences.
+        uint8_t* ResolveId(uint64_t id) const;
+
+        // Resolve an id with no validation whatsoever, for use with HSCPP_MEM_DISABLE_REF_CHECKS.
+        uint8_t* ResolveIdUnchecked(uint64_t id) const;
+
+        // SharedRef reference counting. Invalid or stale ids are ignored.
+        void AddSharedRef(uint64_t id);
+        bool ReleaseSharedRef(uint64_t id); // Returns true if the last SharedRef was released.
+        bool TryAddSharedRef(uint64_t id); // Fails if the object has no SharedRefs left.
+        uint32_t GetNumSharedRefs(uint64_t id);
+
+        BlockHeader* GetLiveBlockHeader(uint64_t id);
+        static BlockHeader* GetBlockHeader(const Block& block);
+
+        // Kept out of line, so that inlined Ref dereferences stay small.
+        [[noreturn]] static void ThrowNullRef(const char* pMessage);
+
+        static uint64_t MakeId(uint64_t iBlock, uint32_t generation);
+        static uint64_t GetBlockIndex(uint64_t id);
+        static uint32_t GetGeneration(uint64_t id);
+
+        // Per-type accounting. Allocate<T> sets the pending type key of the calling thread, so
+        // that Hscpp_Allocate can attribute the allocation it receives from hscpp.
+        //
+        // A runtime module that links hscpp-mem gets its own copy of every static, and of every
+        // non-virtual function. Type keys and ThreadStates are only reached through virtual
+        // functions, so that they are always the ones of the image that created the MemoryManager.
+        template <typename T>
+        uint32_t GetTypeKey();
+        virtual uint32_t RegisterTypeKey(const char* pKey);
+        virtual ThreadState& GetThreadState();
+        void SetPendingTypeKey(uint32_t iTypeKey);
+        uint32_t TakePendingTypeKey();
+
+        void RecordAllocation(uint32_t iTypeKey, uint64_t size);
+        void RecordFree(uint32_t iTypeKey, uint64_t size);
+        void RecordSwap(uint32_t iTypeKey, uint64_t previousSize, uint64_t size);
 
         // Helper methods
-        uint8_t* AllocateBlock(uint64_t size, uint64_t iBlock);
-        uint64_t ReserveFirstFreeBlock();
+        uint8_t* AllocateNewBlock(uint64_t size, uint64_t alignment, uint64_t& id, uint32_t iTypeKey);
+        uint8_t* AllocateBlock(uint64_t size, uint64_t alignment, uint64_t id, RegionBatch* pBatch = nullptr);
+        void ReleaseAllocation(uint64_t iBlock);
+
+        bool AllocateRegionSlot(RegionBatch& batch, Block& block, uint64_t allocationSize);
+        void FinishRegionBatch(RegionBatch& batch);
+        bool IsFillingRegion(uint32_t iRegion);
+        uint32_t CreateRegion(uint64_t size);
+        void ReleaseRegionSlot(uint32_t iRegion);
+        void FreeRegion(uint32_t iRegion);
+
+        uint64_t ReserveBlock();
+        void ReleaseBlock(uint64_t iBlock);
+
+        BlockChunk& GetBlockChunk(uint64_t iBlock);
+        Block& GetBlock(uint64_t iBlock);
+        uint8_t*& GetBlockMemory(uint64_t iBlock);
+        std::atomic<uint32_t>& GetBlockGeneration(uint64_t iBlock);
+        uint64_t CreateBlocks(uint64_t nBlocks);
+
+        bool PopFreeBlock(uint64_t& iBlock);
+        void PushFreeBlock(uint64_t iBlock);
+
+        ThreadCache* GetThreadCache();
+        bool AcquireThreadCache(uint64_t& iCache);
+        void ReleaseThreadCache(uint64_t iCache);
+        void RefillThreadCache(ThreadCache& cache);
+        void FlushThreadCache(ThreadCache& cache, size_t nBlocks);
+
+        static uint64_t GetAlignment(uint64_t size);
+        static uint64_t GetHeaderSize(uint64_t alignment);
     };
 
     template<typename T>
     UniqueRef<T> MemoryManager::Allocate()
     {
+        static_assert(alignof(T) <= SlabAllocator::MAX_ALIGNMENT,
+            "MemoryManager does not support types aligned beyond SlabAllocator::MAX_ALIGNMENT.");
+
         UniqueRef<T> ref;
-        uint64_t iBlock = IMemoryManager::INVALID_ID;
+        uint64_t id = IMemoryManager::INVALID_ID;
 
         if (m_pAllocationResolver != nullptr)
         {
             // hscpp is active, allocate through the hscpp::AllocationResolver. This will ultimately
             // call back into this class, through Hscpp_Allocate.
             AllocationInfo info;
+            SetPendingTypeKey(GetTypeKey<T>());
             m_pAllocationResolver->Allocate<T>(info);
-            iBlock = info.id;
+            SetPendingTypeKey(UNKNOWN_TYPE_KEY);
+            id = info.id;
         }
         else
         {
             // hscpp is inactive, allocate directly.
             uint64_t size = sizeof(typename std::aligned_storage<sizeof(T)>::type);
 
-            iBlock = ReserveFirstFreeBlock();
-            uint8_t* pMemory = AllocateBlock(size, iBlock);
+            uint8_t* pMemory = AllocateNewBlock(size, alignof(T), id, GetTypeKey<T>());
             new (pMemory) T;
         }
 
-        ref.m_Id = iBlock;
+        ref.m_Id = id;
         ref.m_pMemoryManager = this;
         return ref;
     }
 
-}}
\ No newline at end of file
+    template <typename T>
+    SharedRef<T> MemoryManager::AllocateShared()
+    {
+        return SharedRef<T>(Allocate<T>());
+    }
+
+    template <typename T>
+    uint32_t MemoryManager::GetTypeKey()
+    {
+        // Remember the key given by the last MemoryManager to allocate a T on this thread, as
+        // there is usually only one.
+        struct CachedTypeKey
+        {
+            uint64_t instanceId = 0;
+            uint32_t iTypeKey = UNKNOWN_TYPE_KEY;
+        };
+
+        thread_local CachedTypeKey cached;
+        if (cached.instanceId != m_InstanceId)
+        {
+            cached.iTypeKey = RegisterTypeKey(AllocationResolver::GetTypeKey<T>());
+            cached.instanceId = m_InstanceId;
+        }
+
+        return cached.iTypeKey;
+    }
+
+    template <typename T>
+    std::vector<UniqueRef<T>> MemoryManager::AllocateN(uint64_t count)
+    {
+        std::vector<UniqueRef<T>> refs;
+        refs.reserve(count);
+
+        BulkAllocationScope scope(*this, count, GetTypeKey<T>());
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            refs.push_back(Allocate<T>());
+        }
+
+        return refs;
+    }
+
+    inline uint64_t MemoryManager::MakeId(uint64_t iBlock, uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation) << 32) | iBlock;
+    }
+
+    inline uint64_t MemoryManager::GetBlockIndex(uint64_t id)
+    {
+        return id & 0xFFFFFFFF;
+    }
+
+    inline uint32_t MemoryManager::GetGeneration(uint64_t id)
+    {
+        return static_cast<uint32_t>(id >> 32);
+    }
+
+    inline uint8_t* MemoryManager::ResolveId(uint64_t id) const
+    {
+        // INVALID_ID and MEMORY_MANAGER_ID hold an out of range Block index, and never match a
+        // Block, so they are only checked for after the lookup fails.
+        uint64_t iBlock = GetBlockIndex(id);
+        uint64_t iChunk = iBlock >> BLOCK_CHUNK_SHIFT;
+
+        if (iChunk < MAX_BLOCK_CHUNKS)
+        {
+            const BlockChunk* pChunk = m_BlockChunks[iChunk].load(std::memory_order_acquire);
+            if (pChunk != nullptr)
+            {
+                uint64_t iInChunk = iBlock & (BLOCKS_PER_CHUNK - 1);
+                if (pChunk->generation[iInChunk].load(std::memory_order_relaxed) == GetGeneration(id))
+                {
+                    return pChunk->pMemory[iInChunk];
+                }
+            }
+        }
+
+        if (id == IMemoryManager::MEMORY_MANAGER_ID)
+        {
+            return reinterpret_cast<uint8_t*>(const_cast<MemoryManager*>(this));
+        }
+
+        return nullptr;
+    }
+
+    inline uint8_t* MemoryManager::ResolveIdUnchecked(uint64_t id) const
+    {
+        uint64_t iBlock = GetBlockIndex(id);
+        const BlockChunk* pChunk = m_BlockChunks[iBlock >> BLOCK_CHUNK_SHIFT].load(std::memory_order_relaxed);
+
+        return pChunk->pMemory[iBlock & (BLOCKS_PER_CHUNK - 1)];
+    }
+
+    //============================================================================
+    // Ref
+    //============================================================================
+
+    template <typename T>
+    T* Ref<T>::GetMemory() const
+    {
+#ifdef HSCPP_MEM_DISABLE_REF_CHECKS
+        // A Ref to the MemoryManager is the only one that does not refer to a Block.
+        if (std::is_same<T, MemoryManager>::value)
+        {
+            return reinterpret_cast<T*>(m_pMemoryManager);
+        }
+
+        return reinterpret_cast<T*>(m_pMemoryManager->ResolveIdUnchecked(m_Id));
+#else
+        if (m_pMemoryManager == nullptr)
+        {
+            MemoryManager::ThrowNullRef("Ref is null (MemoryManager == nullptr).");
+        }
+
+        T* pT = reinterpret_cast<T*>(m_pMemoryManager->ResolveId(m_Id));
+        if (pT == nullptr)
+        {
+            MemoryManager::ThrowNullRef("Ref is null.");
+        }
+
+        return pT;
+#endif
+    }
+
+    template <typename T>
+    T* Ref<T>::GetMemoryUnsafe() const
+    {
+        if (m_pMemoryManager == nullptr)
+        {
+            return nullptr;
+        }
+
+        return reinterpret_cast<T*>(m_pMemoryManager->ResolveId(m_Id));
+    }
+
+    //============================================================================
+    // SharedRef
+    //============================================================================
+
+    template <typename T>
+    SharedRef<T>::SharedRef(const SharedRef<T>& rhs)
+    {
+        CopyRef(rhs);
+    }
+
+    template <typename T>
+    SharedRef<T>::SharedRef(SharedRef<T>&& rhs) noexcept
+    {
+        MoveRef(std::move(rhs));
+    }
+
+    template <typename T>
+    SharedRef<T>::SharedRef(UniqueRef<T>&& rhs)
+    {
+        // Transfer ownership from the UniqueRef, which becomes null.
+        this->m_Id = rhs.m_Id;
+        this->m_pMemoryManager = rhs.m_pMemoryManager;
+
+        rhs.m_Id = IMemoryManager::INVALID_ID;
+        rhs.m_pMemoryManager = nullptr;
+
+        if (this->m_pMemoryManager != nullptr)
+        {
+            this->m_pMemoryManager->AddSharedRef(this->m_Id);
+        }
+    }
+
+    template <typename T>
+    SharedRef<T>& SharedRef<T>::operator=(const SharedRef<T>& rhs)
+    {
+        if (this != &rhs)
+        {
+            Reset();
+            CopyRef(rhs);
+        }
+
+        return *this;
+    }
+
+    template <typename T>
+    SharedRef<T>& SharedRef<T>::operator=(SharedRef<T>&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            Reset();
+            MoveRef(std::move(rhs));
+        }
+
+        return *this;
+    }
+
+    template <typename T>
+    SharedRef<T>::~SharedRef()
+    {
+        Reset();
+    }
+
+    template <typename T>
+    void SharedRef<T>::Reset()
+    {
+        if (this->m_pMemoryManager != nullptr && this->m_pMemoryManager->ReleaseSharedRef(this->m_Id))
+        {
+            // This was the last owner.
+            T* pSelf = this->GetMemoryUnsafe();
+            if (pSelf != nullptr)
+            {
+                pSelf->~T();
+            }
+
+            this->m_pMemoryManager->FreeBlock(this->m_Id, true);
+        }
+
+        this->m_Id = IMemoryManager::INVALID_ID;
+        this->m_pMemoryManager = nullptr;
+    }
+
+    template <typename T>
+    uint32_t SharedRef<T>::GetUseCount() const
+    {
+        if (this->m_pMemoryManager == nullptr)
+        {
+            return 0;
+        }
+
+        return this->m_pMemoryManager->GetNumSharedRefs(this->m_Id);
+    }
+
+    template <typename T>
+    void SharedRef<T>::CopyRef(const SharedRef<T>& rhs)
+    {
+        this->m_Id = rhs.m_Id;
+        this->m_pMemoryManager = rhs.m_pMemoryManager;
+
+        if (this->m_pMemoryManager != nullptr)
+        {
+            this->m_pMemoryManager->AddSharedRef(this->m_Id);
+        }
+    }
+
+    template <typename T>
+    void SharedRef<T>::MoveRef(SharedRef<T>&& rhs) noexcept
+    {
+        this->m_Id = rhs.m_Id;
+        this->m_pMemoryManager = rhs.m_pMemoryManager;
+
+        rhs.m_Id = IMemoryManager::INVALID_ID;
+        rhs.m_pMemoryManager = nullptr;
+    }
+
+    //============================================================================
+    // WeakRef
+    //============================================================================
+
+    template <typename T>
+    WeakRef<T>::WeakRef(const SharedRef<T>& rhs)
+        : m_Id(rhs.m_Id)
+        , m_pMemoryManager(rhs.m_pMemoryManager)
+    {}
+
+    template <typename T>
+    SharedRef<T> WeakRef<T>::Lock() const
+    {
+        SharedRef<T> ref;
+        if (m_pMemoryManager != nullptr && m_pMemoryManager->TryAddSharedRef(m_Id))
+        {
+            ref.m_Id = m_Id;
+            ref.m_pMemoryManager = m_pMemoryManager;
+        }
+
+        return ref;
+    }
+
+    template <typename T>
+    bool WeakRef<T>::IsExpired() const
+    {
+        return m_pMemoryManager == nullptr || m_pMemoryManager->GetNumSharedRefs(m_Id) == 0;
+    }
+
+}}
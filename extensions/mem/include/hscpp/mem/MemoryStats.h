@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+
+namespace hscpp { namespace mem {
+
+    // Allocation counters of a single type. Tracked types are identified by their HSCPP_TRACK
+    // key, and other types by their typeid name.
+    struct TypeStats
+    {
+        std::string key;
+
+        uint64_t nLiveBlocks = 0;
+        uint64_t liveBytes = 0;
+
+        // Totals since the MemoryManager was created.
+        uint64_t nAllocations = 0;
+        uint64_t nFrees = 0;
+        uint64_t nSwaps = 0;
+
+        // Largest number of live Blocks and bytes held at any one time.
+        uint64_t highWaterBlocks = 0;
+        uint64_t highWaterBytes = 0;
+    };
+
+    // Change in a type's counters between two snapshots.
+    struct TypeStatsDiff
+    {
+        std::string key;
+
+        int64_t liveBlocksDelta = 0;
+        int64_t liveBytesDelta = 0;
+
+        uint64_t nAllocations = 0;
+        uint64_t nFrees = 0;
+        uint64_t nSwaps = 0;
+
+        double allocationsPerSecond = 0;
+        double freesPerSecond = 0;
+    };
+
+    struct MemoryStatsDiff
+    {
+        double seconds = 0;
+        std::vector<TypeStatsDiff> types;
+
+        // Types that hold more live Blocks than in the earlier snapshot. When taken around a
+        // runtime swap, which should not change the number of objects, these point at leaks.
+        std::vector<TypeStatsDiff> GetLeaks() const;
+    };
+
+    struct MemoryStats
+    {
+        std::chrono::steady_clock::time_point time;
+
+        // Every type that has been allocated, sorted by key.
+        std::vector<TypeStats> types;
+
+        // Returns nullptr if the type has never been allocated.
+        const TypeStats* Find(const std::string& key) const;
+
+        // Compare against an earlier snapshot, ex. one taken before a runtime swap.
+        MemoryStatsDiff Diff(const MemoryStats& previous) const;
+    };
+
+}}
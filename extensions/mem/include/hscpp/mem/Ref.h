@@ -7,10 +7,14 @@
 
 namespace hscpp { namespace mem {
 
+    class MemoryManager;
+
     template <typename T>
     class Ref
     {
         friend class MemoryManager;
+        template <typename U> friend class SharedRef;
+        template <typename U> friend class WeakRef;
 
     public:
         T* operator->() const
@@ -30,38 +34,28 @@ namespace hscpp { namespace mem {
 
     protected:
         uint64_t m_Id = IMemoryManager::INVALID_ID;
-        IMemoryManager* m_pMemoryManager = nullptr;
-
-        // Throws an std::runtime_error on a nullptr access. This makes it possible to catch
-        // a null dereference on Linux and macOS with the hscpp::DoProtectedCall wrapper, and fix
-        // the error during runtime (on Windows, a nullptr exception can always be caught).
-        T* GetMemory() const
-        {
-            if (m_pMemoryManager == nullptr)
-            {
-                throw std::runtime_error("Ref is null (MemoryManager == nullptr).");
-            }
-
-            T* pT = reinterpret_cast<T*>(m_pMemoryManager->GetMemory(m_Id));
-            if (pT == nullptr)
-            {
-                throw std::runtime_error("Ref is null.");
-            }
-
-            return pT;
-        }
-
-        // No std::runtime_error throw on a nullptr access.
-        T* GetMemoryUnsafe() const
-        {
-            if (m_pMemoryManager == nullptr)
-            {
-                return nullptr;
-            }
-
-            return reinterpret_cast<T*>(m_pMemoryManager->GetMemory(m_Id));
-        }
-
+        MemoryManager* m_pMemoryManager = nullptr;
+
+        // Dereferencing is non-virtual and inlined, as it is expected to happen in tight loops.
+        // Both methods are defined in MemoryManager.h, since they need a complete MemoryManager.
+        //
+        // Unless HSCPP_MEM_DISABLE_REF_CHECKS is defined, throws an std::runtime_error on a nullptr
+        // or stale access. This makes it possible to catch a null dereference on Linux and macOS
+        // with the hscpp::DoProtectedCall wrapper, and fix the error during runtime (on Windows,
+        // a nullptr exception can always be caught).
+        //
+        // Since this is inlined, HSCPP_MEM_DISABLE_REF_CHECKS must be defined the same way in the
+        // program and in runtime compiled modules. The CMake option forwards it to modules as a
+        // default preprocessor definition; when building otherwise, or when default definitions
+        // are disabled, add it with Hotswapper::AddPreprocessorDefinition.
+        //
+        // Each dereference costs a lookup of a few dependent loads, which the compiler cannot
+        // merge across dereferences. In hot loops, dereference a Ref once per object and work
+        // through the returned pointer.
+        T* GetMemory() const;
+
+        // No std::runtime_error throw on a nullptr access. Always checked.
+        T* GetMemoryUnsafe() const;
     };
 
     template <typename T>
@@ -127,4 +121,55 @@ namespace hscpp { namespace mem {
         }
     };
 
-}}
\ No newline at end of file
+    // Reference counted Ref. The count is stored in the BlockHeader next to the object, so no
+    // separate control block is allocated, and the count is preserved across runtime swaps.
+    // Members are defined in MemoryManager.h.
+    template <typename T>
+    class SharedRef : public Ref<T>
+    {
+        friend class MemoryManager;
+        template <typename U> friend class WeakRef;
+
+    public:
+        SharedRef() = default;
+        SharedRef(const SharedRef<T>& rhs);
+        SharedRef(SharedRef<T>&& rhs) noexcept;
+
+        // Take ownership of an object allocated with MemoryManager::Allocate.
+        SharedRef(UniqueRef<T>&& rhs);
+
+        SharedRef<T>& operator=(const SharedRef<T>& rhs);
+        SharedRef<T>& operator=(SharedRef<T>&& rhs) noexcept;
+
+        ~SharedRef();
+
+        // Release this owner. The object is destroyed once the last owner is released.
+        void Reset();
+
+        uint32_t GetUseCount() const;
+
+    private:
+        void CopyRef(const SharedRef<T>& rhs);
+        void MoveRef(SharedRef<T>&& rhs) noexcept;
+    };
+
+    // Non-owning reference to an object owned by SharedRefs. Unlike a plain Ref, a WeakRef can be
+    // promoted into a SharedRef, provided the object is still alive. A recycled Block has a new
+    // generation, so a WeakRef can never be promoted into a Ref to an unrelated object.
+    template <typename T>
+    class WeakRef
+    {
+    public:
+        WeakRef() = default;
+        WeakRef(const SharedRef<T>& rhs);
+
+        // Returns a null SharedRef if the object has been destroyed.
+        SharedRef<T> Lock() const;
+        bool IsExpired() const;
+
+    private:
+        uint64_t m_Id = IMemoryManager::INVALID_ID;
+        MemoryManager* m_pMemoryManager = nullptr;
+    };
+
+}}
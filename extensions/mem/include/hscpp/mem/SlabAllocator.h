@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <array>
+
+namespace hscpp { namespace mem {
+
+    // Size-class slab allocator used by the MemoryManager when no custom AllocateCb/FreeCb are
+    // provided. Small allocations are rounded up to a size class and carved out of large slabs,
+    // so that thousands of small tracked objects do not each hit the global heap.
+    //
+    // A slot is aligned to the largest power of two that divides its size class, up to
+    // MAX_ALIGNMENT. Since sizeof(T) is always a multiple of alignof(T), any request whose size
+    // is a multiple of its alignment is therefore correctly aligned.
+    class SlabAllocator
+    {
+        SlabAllocator(const SlabAllocator&) = delete;
+        SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    public:
+        constexpr static uint64_t MAX_ALIGNMENT = 64;
+
+        // Allocations larger than this bypass the slabs, and are allocated individually.
+        constexpr static uint64_t MAX_SLOT_SIZE = 2048;
+
+        explicit SlabAllocator(uint64_t slabSize = 64 * 1024);
+        ~SlabAllocator();
+
+        uint8_t* Allocate(uint64_t size);
+        void Free(uint8_t* pMemory, uint64_t size);
+
+        // Returns the number of bytes actually reserved for an allocation of the given size. Two
+        // sizes with the same size class can share the same slot.
+        static uint64_t GetSizeClass(uint64_t size);
+
+        uint64_t GetNumSlabs() const;
+
+    private:
+        struct FreeSlot
+        {
+            FreeSlot* pNext = nullptr;
+        };
+
+        struct SizeClass
+        {
+            FreeSlot* pFreeList = nullptr;
+
+            // Slots are carved lazily out of the most recent slab.
+            uint8_t* pNextSlot = nullptr;
+            uint8_t* pSlabEnd = nullptr;
+        };
+
+        constexpr static size_t N_SIZE_CLASSES = 24;
+
+        uint64_t m_SlabSize = 0;
+        std::array<SizeClass, N_SIZE_CLASSES> m_SizeClasses;
+        std::vector<uint8_t*> m_Slabs;
+
+        static size_t GetSizeClassIndex(uint64_t size);
+        static uint64_t GetSizeClassSize(size_t iSizeClass);
+
+        static uint8_t* AlignedAllocate(uint64_t size);
+        static void AlignedFree(uint8_t* pMemory);
+    };
+
+}}
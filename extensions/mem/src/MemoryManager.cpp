@@ -1,16 +1,87 @@
+#include <stdexcept>
+#include <algorithm>
+#include <list>
+
 #include "hscpp/mem/MemoryManager.h"
 
 namespace hscpp { namespace mem {
 
+    constexpr static uint64_t BITS_PER_WORD = 64;
+
+    class MemoryManager::ThreadCacheGuard
+    {
+    public:
+        struct Entry
+        {
+            std::shared_ptr<ThreadCacheOwner> pOwner;
+            uint64_t iCache = 0;
+            ThreadState state;
+        };
+
+        // A list, so that ThreadStates stay in place as other MemoryManagers come and go.
+        std::list<Entry> entries;
+
+        ~ThreadCacheGuard()
+        {
+            for (const Entry& entry : entries)
+            {
+                std::lock_guard<std::mutex> lock(entry.pOwner->mutex);
+                if (entry.pOwner->pMemoryManager != nullptr && entry.state.pCache != nullptr)
+                {
+                    entry.pOwner->pMemoryManager->ReleaseThreadCache(entry.iCache);
+                }
+            }
+        }
+    };
+
+    // Numbers MemoryManagers from 1, as 0 marks an empty type key cache.
+    static std::atomic<uint64_t> s_nInstances(0);
+
+    MemoryManager::~MemoryManager()
+    {
+        if (m_pThreadCacheOwner != nullptr)
+        {
+            // Threads that exit from now on no longer give their ThreadCaches back.
+            std::lock_guard<std::mutex> lock(m_pThreadCacheOwner->mutex);
+            m_pThreadCacheOwner->pMemoryManager = nullptr;
+        }
+
+        uint64_t nChunks = (m_nCreatedBlocks.load() + BLOCKS_PER_CHUNK - 1) >> BLOCK_CHUNK_SHIFT;
+        for (uint64_t iChunk = 0; iChunk < nChunks; ++iChunk)
+        {
+            delete m_BlockChunks[iChunk].load();
+        }
+    }
+
     UniqueRef<MemoryManager> MemoryManager::Create(const Config& config /*=Config()*/)
     {
         MemoryManager* pMemoryManager = new MemoryManager();
+        pMemoryManager->m_InstanceId = ++s_nInstances;
         pMemoryManager->m_pAllocationResolver = config.pAllocationResolver;
         pMemoryManager->m_AllocateCb = config.AllocateCb;
         pMemoryManager->m_FreeCb = config.FreeCb;
-        pMemoryManager->m_Blocks.reserve(config.reservedBlocks);
-        pMemoryManager->m_FreeBlockIndices.reserve(config.reservedBlocks);
-        pMemoryManager->m_FreeBlockIndexByBlock.reserve(config.reservedBlocks);
+        pMemoryManager->m_bUseSlabAllocator = (config.AllocateCb == nullptr || config.FreeCb == nullptr);
+        pMemoryManager->m_pTypeCounters.reset(new TypeCounters[MAX_TYPE_KEYS]);
+
+        if (config.bConcurrent)
+        {
+            pMemoryManager->m_bConcurrent = true;
+            pMemoryManager->m_nThreadCaches = config.maxThreadCaches;
+            pMemoryManager->m_pThreadCaches.reset(new ThreadCache[config.maxThreadCaches]);
+
+            uint64_t nWords = (config.maxThreadCaches + BITS_PER_WORD - 1) / BITS_PER_WORD;
+            pMemoryManager->m_pUsedThreadCaches.reset(new std::atomic<uint64_t>[nWords]());
+
+            pMemoryManager->m_pThreadCacheOwner = std::make_shared<ThreadCacheOwner>();
+            pMemoryManager->m_pThreadCacheOwner->pMemoryManager = pMemoryManager;
+        }
+
+        // Push reserved Blocks in reverse, so that they are handed out in ascending order.
+        uint64_t iFirstBlock = pMemoryManager->CreateBlocks(config.reservedBlocks);
+        for (uint64_t i = config.reservedBlocks; i > 0; --i)
+        {
+            pMemoryManager->PushFreeBlock(iFirstBlock + i - 1);
+        }
 
         UniqueRef<MemoryManager> ref;
         ref.m_pMemoryManager = pMemoryManager;
@@ -21,65 +92,200 @@ namespace hscpp { namespace mem {
 
     uint64_t MemoryManager::GetNumBlocks() const
     {
-        return m_iFreeBlocksBegin;
+        return m_nUsedBlocks.load();
     }
 
-    uint8_t* MemoryManager::GetMemory(uint64_t id)
+    uint64_t MemoryManager::GetNumThreadCaches() const
     {
-        switch (id)
+        uint64_t nThreadCaches = 0;
+        for (uint64_t iCache = 0; iCache < m_nThreadCaches; ++iCache)
         {
-            case IMemoryManager::INVALID_ID:
-                return nullptr;
-            case IMemoryManager::MEMORY_MANAGER_ID:
-                return reinterpret_cast<uint8_t*>(this);
-            default:
-                return m_Blocks.at(id).pMemory;
+            uint64_t used = m_pUsedThreadCaches[iCache / BITS_PER_WORD].load(std::memory_order_relaxed);
+            if ((used & (uint64_t(1) << (iCache % BITS_PER_WORD))) != 0)
+            {
+                ++nThreadCaches;
+            }
+        }
+
+        return nThreadCaches;
+    }
+
+    MemoryStats MemoryManager::GetStats() const
+    {
+        std::vector<std::string> typeKeys;
+        {
+            std::lock_guard<std::mutex> lock(m_TypeKeys.mutex);
+            typeKeys = m_TypeKeys.keys;
+        }
+
+        MemoryStats stats;
+        stats.time = std::chrono::steady_clock::now();
+
+        for (size_t iTypeKey = 0; iTypeKey < typeKeys.size(); ++iTypeKey)
+        {
+            const TypeCounters& counters = m_pTypeCounters[iTypeKey];
+            if (counters.nAllocations.load() == 0)
+            {
+                continue;
+            }
+
+            TypeStats typeStats;
+            typeStats.key = typeKeys.at(iTypeKey);
+            typeStats.nLiveBlocks = counters.nLiveBlocks.load();
+            typeStats.liveBytes = counters.liveBytes.load();
+            typeStats.nAllocations = counters.nAllocations.load();
+            typeStats.nFrees = counters.nFrees.load();
+            typeStats.nSwaps = counters.nSwaps.load();
+            typeStats.highWaterBlocks = counters.highWaterBlocks.load();
+            typeStats.highWaterBytes = counters.highWaterBytes.load();
+
+            stats.types.push_back(typeStats);
+        }
+
+        std::sort(stats.types.begin(), stats.types.end(), [](const TypeStats& lhs, const TypeStats& rhs) {
+            return lhs.key < rhs.key;
+        });
+
+        return stats;
+    }
+
+    void MemoryManager::StopTheWorld()
+    {
+        if (!m_bConcurrent)
+        {
+            return;
+        }
+
+        // A thread constructing a tracked object holds the trackers lock while allocating, so it
+        // must be taken first. Otherwise, that thread would wait on the stopped world, while a
+        // swap on this thread waits on the lock. Tracked objects only exist with hscpp active.
+        std::unique_lock<std::recursive_mutex> trackersLock;
+        if (m_pAllocationResolver != nullptr)
+        {
+            trackersLock = ModuleSharedState::LockTrackers();
+        }
+
+        // Only one thread may stop the world at a time. The locks are held until ResumeTheWorld.
+        m_WorldMutex.lock();
+        m_TrackersLock = std::move(trackersLock);
+
+        m_WorldOwner.store(std::this_thread::get_id());
+        m_bWorldStopped.store(true);
+
+        while (m_nActiveMutators.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+
+        // No other thread can touch its cache now. Return cached Blocks to the global free list,
+        // so that they are visible to the swap and to GetNumBlocks bookkeeping.
+        for (uint64_t iCache = 0; iCache < m_nThreadCaches; ++iCache)
+        {
+            ThreadCache& cache = m_pThreadCaches[iCache];
+            FlushThreadCache(cache, cache.iFreeBlocks.size());
+        }
+    }
+
+    void MemoryManager::ResumeTheWorld()
+    {
+        if (!m_bConcurrent)
+        {
+            return;
+        }
+
+        m_bWorldStopped.store(false);
+        m_WorldOwner.store(std::thread::id());
+
+        // Released once the world mutex is, in the reverse order of StopTheWorld.
+        std::unique_lock<std::recursive_mutex> trackersLock = std::move(m_TrackersLock);
+        m_WorldMutex.unlock();
+    }
+
+    bool MemoryManager::Compact(uint64_t maxTypes /*= max*/)
+    {
+        if (m_pAllocationResolver == nullptr)
+        {
+            return true;
+        }
+
+        if (m_iNextCompactionKey == m_CompactionKeys.size())
+        {
+            // Start a new pass, over the types that are tracked right now and can restore their
+            // state after being rebuilt.
+            m_CompactionKeys = m_pAllocationResolver->GetTrackedKeys(true);
+            m_iNextCompactionKey = 0;
         }
+
+        StopTheWorld();
+
+        for (uint64_t i = 0; i < maxTypes && m_iNextCompactionKey < m_CompactionKeys.size(); ++i)
+        {
+            // Rebuilding the objects reallocates them through Hscpp_AllocateSwap, which will
+            // place them into a new Region.
+            m_bCompacting.store(true);
+            m_pAllocationResolver->RebuildTrackedObjects(m_CompactionKeys.at(m_iNextCompactionKey++));
+            m_bCompacting.store(false);
+        }
+
+        ResumeTheWorld();
+
+        return m_iNextCompactionKey == m_CompactionKeys.size();
     }
 
-    void MemoryManager::FreeBlock(uint64_t iBlock, bool bReleaseReservation)
+    uint8_t* MemoryManager::GetMemory(uint64_t id)
+    {
+        return ResolveId(id);
+    }
+
+    void MemoryManager::FreeBlock(uint64_t id, bool bReleaseReservation)
     {
-        switch (iBlock)
+        switch (id)
         {
             case IMemoryManager::INVALID_ID:
                 break; // Equivalent to deleting a nullptr.
             case IMemoryManager::MEMORY_MANAGER_ID:
                 break; // MemoryManager instance does not use any Block.
             default:
-                m_FreeCb(m_Blocks.at(iBlock).pMemory - sizeof(BlockHeader));
-                m_Blocks.at(iBlock).pMemory = nullptr;
+            {
+                MutatorScope scope(*this);
 
-                if (bReleaseReservation)
-                {
-                    // Get the index of the last Block that is not free, in the free Block list.
-                    size_t iLastUsedBlock = m_FreeBlockIndices.at(m_iFreeBlocksBegin - 1);
+                uint64_t iBlock = GetBlockIndex(id);
+                std::atomic<uint32_t>& generation = GetBlockGeneration(iBlock);
 
-                    // Map the Block index to the free Block list.
-                    size_t iFreeBlock = m_FreeBlockIndexByBlock.at(iBlock);
+                if (generation.load() != GetGeneration(id))
+                {
+                    break; // Block has already been released, and may belong to another object.
+                }
 
-                    // Swap freed Block with last taken Block before the free Blocks. Since the
-                    // number of free Blocks will be decremented, this will push the freed Block
-                    // into the free list.
-                    std::swap(m_FreeBlockIndices.at(iFreeBlock), m_FreeBlockIndices.at(m_iFreeBlocksBegin - 1));
+                Block& block = GetBlock(iBlock);
+                if (block.objectSize != 0)
+                {
+                    RecordFree(block.iTypeKey, block.objectSize);
+                    block.objectSize = 0;
+                }
 
-                    // Update the free Block list mapping.
-                    std::swap(m_FreeBlockIndexByBlock.at(iBlock), m_FreeBlockIndexByBlock.at(iLastUsedBlock));
+                ReleaseAllocation(iBlock);
 
-                    m_iFreeBlocksBegin--;
+                if (bReleaseReservation)
+                {
+                    // Invalidate all outstanding Refs to this Block.
+                    generation.fetch_add(1);
+                    ReleaseBlock(iBlock);
                 }
 
                 break;
+            }
         }
     }
 
     AllocationInfo MemoryManager::Hscpp_Allocate(uint64_t size)
     {
         // Performing a generic allocation through hscpp.
-        uint64_t iBlock = ReserveFirstFreeBlock();
-        uint8_t* pMemory = AllocateBlock(size, iBlock);
+        uint64_t id = IMemoryManager::INVALID_ID;
+        uint8_t* pMemory = AllocateNewBlock(size, GetAlignment(size), id, TakePendingTypeKey());
 
         AllocationInfo info;
-        info.id = iBlock;
+        info.id = id;
         info.pMemory = pMemory;
 
         return info;
@@ -89,12 +295,17 @@ namespace hscpp { namespace mem {
     {
         // Performing a runtime swap of an HSCPP_TRACK object. Reuse the old Block, so that old
         // Refs will now refer to the newly allocated class.
-        uint64_t iBlock = previousId;
-        AllocateBlock(size, iBlock);
+        RegionBatch* pBatch = m_SwapBatch.bActive ? &m_SwapBatch : nullptr;
+        uint8_t* pMemory = AllocateBlock(size, GetAlignment(size), previousId, pBatch);
+
+        // The object keeps its type key, but its implementation may have changed size.
+        Block& block = GetBlock(GetBlockIndex(previousId));
+        RecordSwap(block.iTypeKey, block.objectSize, size);
+        block.objectSize = size;
 
         AllocationInfo info;
-        info.id = iBlock;
-        info.pMemory = m_Blocks.at(iBlock).pMemory;
+        info.id = previousId;
+        info.pMemory = pMemory;
 
         return info;
     }
@@ -103,48 +314,795 @@ namespace hscpp { namespace mem {
     {
         // Performing a free during a runtime swap. Return the old object id so that
         // HscppAllocateSwap knows the previous id of the deleted object. The Block's
-        // memory will be freed, but its id will still be reserved.
+        // allocation is kept, so that Hscpp_AllocateSwap can reuse it if the new object has the
+        // same size class. Its id will still be reserved.
         uint64_t iBlock = reinterpret_cast<BlockHeader*>(pMemory - sizeof(BlockHeader))->iBlock;
-        FreeBlock(iBlock, false);
+        GetBlockMemory(iBlock) = nullptr;
 
-        return iBlock;
+        return MakeId(iBlock, GetBlockGeneration(iBlock).load());
+    }
+
+    void MemoryManager::Hscpp_BeginSwapBatch(const char* pKey, uint64_t nInstances)
+    {
+        (void)pKey;
+
+        // Outside of Compact, runtime swaps keep objects in their current allocations.
+        m_SwapBatch = RegionBatch();
+        m_SwapBatch.bActive = m_bCompacting.load();
+        m_SwapBatch.nInstances = nInstances;
+    }
+
+    void MemoryManager::Hscpp_EndSwapBatch()
+    {
+        FinishRegionBatch(m_SwapBatch);
+        m_SwapBatch = RegionBatch();
+    }
+
+    uint8_t* MemoryManager::AllocateNewBlock(uint64_t size, uint64_t alignment, uint64_t& id, uint32_t iTypeKey)
+    {
+        // The object is constructed by the caller, outside of the MutatorScope. Constructors may
+        // allocate further Refs, and must not be blocked by a stop that is waiting on this thread.
+        MutatorScope scope(*this);
+
+        uint64_t iBlock = ReserveBlock();
+        id = MakeId(iBlock, GetBlockGeneration(iBlock).load());
+
+        // Objects of a bulk allocation are packed together. Allocations made by their
+        // constructors are of a different type, and are not.
+        RegionBatch* pBatch = nullptr;
+        BulkAllocation* pBulkAllocation = GetThreadState().pBulkAllocation;
+        if (pBulkAllocation != nullptr && pBulkAllocation->iTypeKey == iTypeKey && iTypeKey != UNKNOWN_TYPE_KEY)
+        {
+            pBatch = &pBulkAllocation->batch;
+        }
+
+        uint8_t* pMemory = AllocateBlock(size, alignment, id, pBatch);
+
+        Block& block = GetBlock(iBlock);
+        block.iTypeKey = iTypeKey;
+        block.objectSize = size;
+        RecordAllocation(iTypeKey, size);
+
+        return pMemory;
     }
 
-    uint8_t* MemoryManager::AllocateBlock(uint64_t size, uint64_t iBlock)
+    uint8_t* MemoryManager::AllocateBlock(uint64_t size, uint64_t alignment, uint64_t id, RegionBatch* pBatch /*= nullptr*/)
     {
-        // Allocate sizeof(BlockHeader) extra space, allowing Block info to be saved alongside
+        // Allocate extra space for the BlockHeader, allowing Block info to be saved alongside
         // the pointer. This makes it possible to quickly find the index during an Hscpp_FreeSwap.
-        uint8_t* pMemory = m_AllocateCb(size + sizeof(BlockHeader));
+        // The header is padded, so that the memory following it keeps the requested alignment.
+        uint64_t headerSize = GetHeaderSize(alignment);
+        uint64_t allocationSize = headerSize + size;
+
+        uint64_t iBlock = GetBlockIndex(id);
+        Block& block = GetBlock(iBlock);
+
+        // A Block undergoing a runtime swap still holds its previous allocation. Reuse it if the
+        // new object fits in the same slot, and avoid a round trip through the allocator.
+        uint32_t nSharedRefs = 0;
+        if (block.pAllocation != nullptr)
+        {
+            nSharedRefs = GetBlockHeader(block)->nSharedRefs.load();
+
+            // A slot in a Region is packed tightly against its neighbors, and cannot grow. If the
+            // object grew during a swap, move it into a new Region along with the rest of its
+            // batch, to keep the objects together.
+            bool bSameSizeClass = false;
+            if (block.iRegionPlusOne != 0)
+            {
+                bSameSizeClass = allocationSize <= block.allocationSize;
+                if (!bSameSizeClass && pBatch == nullptr && m_SwapBatch.nInstances != 0)
+                {
+                    pBatch = &m_SwapBatch;
+                }
+            }
+            else
+            {
+                bSameSizeClass = m_bUseSlabAllocator
+                    ? SlabAllocator::GetSizeClass(block.allocationSize) == SlabAllocator::GetSizeClass(allocationSize)
+                    : block.allocationSize == allocationSize;
+            }
+
+            // A compacted object always moves out of its previous allocation.
+            if (pBatch != nullptr || !bSameSizeClass)
+            {
+                ReleaseAllocation(iBlock);
+            }
+        }
+
+        if (block.pAllocation == nullptr && pBatch != nullptr)
+        {
+            AllocateRegionSlot(*pBatch, block, allocationSize);
+        }
+
+        if (block.pAllocation == nullptr)
+        {
+            std::unique_lock<std::mutex> lock(m_AllocatorMutex, std::defer_lock);
+            if (m_bConcurrent)
+            {
+                lock.lock();
+            }
 
-        reinterpret_cast<BlockHeader*>(pMemory)->iBlock = iBlock;
+            block.pAllocation = m_bUseSlabAllocator
+                ? m_SlabAllocator.Allocate(allocationSize)
+                : m_AllocateCb(allocationSize);
+            block.allocationSize = allocationSize;
+        }
 
         // Return memory past the BlockHeader.
-        m_Blocks.at(iBlock).pMemory = pMemory + sizeof(BlockHeader);
-        return m_Blocks.at(iBlock).pMemory;
+        uint8_t* pMemory = block.pAllocation + headerSize;
+        block.headerSize = static_cast<uint32_t>(headerSize);
+
+        BlockHeader* pHeader = new (pMemory - sizeof(BlockHeader)) BlockHeader();
+        pHeader->iBlock = static_cast<uint32_t>(iBlock);
+        pHeader->nSharedRefs.store(nSharedRefs);
+
+        GetBlockMemory(iBlock) = pMemory;
+        return pMemory;
     }
 
-    uint64_t MemoryManager::ReserveFirstFreeBlock()
+    void MemoryManager::ReleaseAllocation(uint64_t iBlock)
     {
-        if (m_iFreeBlocksBegin == m_FreeBlockIndices.size())
+        Block& block = GetBlock(iBlock);
+
+        if (block.pAllocation != nullptr)
         {
-            // No free blocks remain, push back a new one.
-            m_FreeBlockIndices.push_back(m_iFreeBlocksBegin);
-            m_FreeBlockIndexByBlock.push_back(m_iFreeBlocksBegin);
-            m_Blocks.push_back(Block());
+            std::unique_lock<std::mutex> lock(m_AllocatorMutex, std::defer_lock);
+            if (m_bConcurrent)
+            {
+                lock.lock();
+            }
+
+            if (block.iRegionPlusOne != 0)
+            {
+                ReleaseRegionSlot(block.iRegionPlusOne - 1);
+            }
+            else if (m_bUseSlabAllocator)
+            {
+                m_SlabAllocator.Free(block.pAllocation, block.allocationSize);
+            }
+            else
+            {
+                m_FreeCb(block.pAllocation);
+            }
         }
 
-        m_iFreeBlocksBegin++;
-        return m_FreeBlockIndices.at(m_iFreeBlocksBegin - 1);
+        GetBlockMemory(iBlock) = nullptr;
+        block.pAllocation = nullptr;
+        block.allocationSize = 0;
+        block.headerSize = 0;
+        block.iRegionPlusOne = 0;
     }
 
-    MemoryManager::Config::Config()
+    bool MemoryManager::AllocateRegionSlot(RegionBatch& batch, Block& block, uint64_t allocationSize)
     {
-        AllocateCb = [](uint64_t size) {
-            return new uint8_t[size];
-        };
+        std::unique_lock<std::mutex> lock(m_AllocatorMutex, std::defer_lock);
+        if (m_bConcurrent)
+        {
+            lock.lock();
+        }
 
-        FreeCb = [](uint8_t* pMemory) {
-            delete[] pMemory;
-        };
+        if (batch.pNextSlot == nullptr)
+        {
+            // All instances share a type, so the first one determines the size of every slot.
+            batch.slotSize = allocationSize;
+            batch.iRegion = CreateRegion(batch.nInstances * allocationSize);
+
+            const Region& region = m_Regions.at(batch.iRegion);
+            batch.pNextSlot = region.pMemory;
+            batch.pRegionEnd = region.pMemory + region.size;
+        }
+
+        // Should more objects arrive than were announced, the rest are allocated individually.
+        if (allocationSize != batch.slotSize || batch.pNextSlot == batch.pRegionEnd)
+        {
+            return false;
+        }
+
+        block.pAllocation = batch.pNextSlot;
+        block.allocationSize = allocationSize;
+        block.iRegionPlusOne = batch.iRegion + 1;
+
+        batch.pNextSlot += allocationSize;
+        ++m_Regions.at(batch.iRegion).nLiveBlocks;
+
+        return true;
+    }
+
+    uint32_t MemoryManager::CreateRegion(uint64_t size)
+    {
+        // Slots are a multiple of the object's alignment, so packing them one after the other
+        // keeps every object aligned, given a suitably aligned Region.
+        Region region;
+        region.pMemory = m_bUseSlabAllocator
+            ? m_SlabAllocator.Allocate(size)
+            : m_AllocateCb(size);
+        region.size = size;
+
+        if (!m_iFreeRegions.empty())
+        {
+            uint32_t iRegion = m_iFreeRegions.back();
+            m_iFreeRegions.pop_back();
+
+            m_Regions.at(iRegion) = region;
+            return iRegion;
+        }
+
+        m_Regions.push_back(region);
+        return static_cast<uint32_t>(m_Regions.size() - 1);
+    }
+
+    void MemoryManager::ReleaseRegionSlot(uint32_t iRegion)
+    {
+        Region& region = m_Regions.at(iRegion);
+        --region.nLiveBlocks;
+
+        // A Region that is still handing out slots is checked once its batch is finished.
+        if (region.nLiveBlocks == 0 && !IsFillingRegion(iRegion))
+        {
+            FreeRegion(iRegion);
+        }
+    }
+
+    void MemoryManager::FinishRegionBatch(RegionBatch& batch)
+    {
+        if (batch.pNextSlot == nullptr)
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_AllocatorMutex, std::defer_lock);
+        if (m_bConcurrent)
+        {
+            lock.lock();
+        }
+
+        // Every object may have been freed already, or not fit into the Region.
+        if (m_Regions.at(batch.iRegion).nLiveBlocks == 0)
+        {
+            FreeRegion(batch.iRegion);
+        }
+
+        batch.pNextSlot = nullptr;
+    }
+
+    bool MemoryManager::IsFillingRegion(uint32_t iRegion)
+    {
+        if (m_SwapBatch.pNextSlot != nullptr && m_SwapBatch.iRegion == iRegion)
+        {
+            return true;
+        }
+
+        // Bulk allocations on other threads fill their own Regions, which have live objects
+        // from the moment they are created.
+        BulkAllocation* pBulkAllocation = GetThreadState().pBulkAllocation;
+        return pBulkAllocation != nullptr
+            && pBulkAllocation->batch.pNextSlot != nullptr && pBulkAllocation->batch.iRegion == iRegion;
+    }
+
+    void MemoryManager::FreeRegion(uint32_t iRegion)
+    {
+        Region& region = m_Regions.at(iRegion);
+
+        if (m_bUseSlabAllocator)
+        {
+            m_SlabAllocator.Free(region.pMemory, region.size);
+        }
+        else
+        {
+            m_FreeCb(region.pMemory);
+        }
+
+        region = Region();
+        m_iFreeRegions.push_back(iRegion);
+    }
+
+    uint64_t MemoryManager::ReserveBlock()
+    {
+        uint64_t iBlock = IMemoryManager::INVALID_ID;
+
+        ThreadCache* pCache = GetThreadCache();
+        if (pCache != nullptr)
+        {
+            if (pCache->iFreeBlocks.empty())
+            {
+                RefillThreadCache(*pCache);
+            }
+
+            iBlock = pCache->iFreeBlocks.back();
+            pCache->iFreeBlocks.pop_back();
+        }
+        else if (!PopFreeBlock(iBlock))
+        {
+            // No free blocks remain, create a new one.
+            iBlock = CreateBlocks(1);
+        }
+
+        m_nUsedBlocks.fetch_add(1, std::memory_order_relaxed);
+        return iBlock;
+    }
+
+    void MemoryManager::ReleaseBlock(uint64_t iBlock)
+    {
+        ThreadCache* pCache = GetThreadCache();
+        if (pCache != nullptr)
+        {
+            pCache->iFreeBlocks.push_back(static_cast<uint32_t>(iBlock));
+
+            // Bound the number of Blocks a single thread can hold on to. Keep a full batch, so
+            // that alternating allocations and frees do not bounce on the global free list.
+            if (pCache->iFreeBlocks.size() > 2 * THREAD_CACHE_BATCH_SIZE)
+            {
+                FlushThreadCache(*pCache, THREAD_CACHE_BATCH_SIZE);
+            }
+        }
+        else
+        {
+            PushFreeBlock(iBlock);
+        }
+
+        m_nUsedBlocks.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    MemoryManager::BlockChunk& MemoryManager::GetBlockChunk(uint64_t iBlock)
+    {
+        uint64_t iChunk = iBlock >> BLOCK_CHUNK_SHIFT;
+        if (iChunk >= MAX_BLOCK_CHUNKS)
+        {
+            throw std::out_of_range("Block id is out of range.");
+        }
+
+        BlockChunk* pChunk = m_BlockChunks[iChunk].load(std::memory_order_acquire);
+        if (pChunk == nullptr)
+        {
+            throw std::out_of_range("Block id is out of range.");
+        }
+
+        return *pChunk;
+    }
+
+    MemoryManager::Block& MemoryManager::GetBlock(uint64_t iBlock)
+    {
+        return GetBlockChunk(iBlock).blocks[iBlock & (BLOCKS_PER_CHUNK - 1)];
+    }
+
+    uint8_t*& MemoryManager::GetBlockMemory(uint64_t iBlock)
+    {
+        return GetBlockChunk(iBlock).pMemory[iBlock & (BLOCKS_PER_CHUNK - 1)];
+    }
+
+    std::atomic<uint32_t>& MemoryManager::GetBlockGeneration(uint64_t iBlock)
+    {
+        return GetBlockChunk(iBlock).generation[iBlock & (BLOCKS_PER_CHUNK - 1)];
+    }
+
+    uint64_t MemoryManager::CreateBlocks(uint64_t nBlocks)
+    {
+        // Creating Blocks is rare compared to reusing them, as Blocks are never destroyed.
+        std::lock_guard<std::mutex> lock(m_BlockChunksMutex);
+
+        uint64_t iFirstBlock = m_nCreatedBlocks.load(std::memory_order_relaxed);
+        uint64_t iEndBlock = iFirstBlock + nBlocks;
+
+        for (uint64_t iChunk = iFirstBlock >> BLOCK_CHUNK_SHIFT;
+            (iChunk << BLOCK_CHUNK_SHIFT) < iEndBlock; ++iChunk)
+        {
+            if (iChunk >= MAX_BLOCK_CHUNKS)
+            {
+                throw std::length_error("MemoryManager has run out of Blocks.");
+            }
+
+            if (m_BlockChunks[iChunk].load(std::memory_order_relaxed) == nullptr)
+            {
+                m_BlockChunks[iChunk].store(new BlockChunk(), std::memory_order_release);
+            }
+        }
+
+        m_nCreatedBlocks.store(iEndBlock, std::memory_order_relaxed);
+        return iFirstBlock;
+    }
+
+    bool MemoryManager::PopFreeBlock(uint64_t& iBlock)
+    {
+        uint64_t head = m_FreeListHead.load(std::memory_order_acquire);
+        while (true)
+        {
+            uint32_t iFirstPlusOne = static_cast<uint32_t>(head);
+            if (iFirstPlusOne == 0)
+            {
+                return false;
+            }
+
+            // Blocks are never destroyed, so reading the next index of a Block that has been
+            // popped by another thread is safe. The tag will make the exchange fail in that case.
+            uint32_t iNextPlusOne = GetBlock(iFirstPlusOne - 1).iNextFreePlusOne.load(std::memory_order_relaxed);
+            uint64_t newHead = (((head >> 32) + 1) << 32) | iNextPlusOne;
+
+            if (m_FreeListHead.compare_exchange_weak(head, newHead,
+                std::memory_order_acquire, std::memory_order_acquire))
+            {
+                iBlock = iFirstPlusOne - 1;
+                return true;
+            }
+        }
+    }
+
+    void MemoryManager::PushFreeBlock(uint64_t iBlock)
+    {
+        Block& block = GetBlock(iBlock);
+
+        uint64_t head = m_FreeListHead.load(std::memory_order_relaxed);
+        uint64_t newHead = 0;
+        do
+        {
+            block.iNextFreePlusOne.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            newHead = (((head >> 32) + 1) << 32) | (iBlock + 1);
+        } while (!m_FreeListHead.compare_exchange_weak(head, newHead,
+            std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    MemoryManager::ThreadCache* MemoryManager::GetThreadCache()
+    {
+        if (!m_bConcurrent)
+        {
+            return nullptr;
+        }
+
+        return GetThreadState().pCache;
+    }
+
+    bool MemoryManager::AcquireThreadCache(uint64_t& iCache)
+    {
+        for (uint64_t iFirstCache = 0; iFirstCache < m_nThreadCaches; iFirstCache += BITS_PER_WORD)
+        {
+            std::atomic<uint64_t>& usedCaches = m_pUsedThreadCaches[iFirstCache / BITS_PER_WORD];
+
+            uint64_t used = usedCaches.load(std::memory_order_relaxed);
+            for (uint64_t iBit = 0; iBit < BITS_PER_WORD && iFirstCache + iBit < m_nThreadCaches; ++iBit)
+            {
+                uint64_t bit = uint64_t(1) << iBit;
+                if ((used & bit) == 0 && (usedCaches.fetch_or(bit, std::memory_order_acquire) & bit) == 0)
+                {
+                    iCache = iFirstCache + iBit;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void MemoryManager::ReleaseThreadCache(uint64_t iCache)
+    {
+        MutatorScope scope(*this);
+
+        // Return the cached Blocks, which would otherwise be stranded until the next StopTheWorld.
+        ThreadCache& cache = m_pThreadCaches[iCache];
+        FlushThreadCache(cache, cache.iFreeBlocks.size());
+
+        uint64_t bit = uint64_t(1) << (iCache % BITS_PER_WORD);
+        m_pUsedThreadCaches[iCache / BITS_PER_WORD].fetch_and(~bit, std::memory_order_release);
+    }
+
+    void MemoryManager::RefillThreadCache(ThreadCache& cache)
+    {
+        uint64_t iBlock = IMemoryManager::INVALID_ID;
+        while (cache.iFreeBlocks.size() < THREAD_CACHE_BATCH_SIZE && PopFreeBlock(iBlock))
+        {
+            cache.iFreeBlocks.push_back(static_cast<uint32_t>(iBlock));
+        }
+
+        if (cache.iFreeBlocks.empty())
+        {
+            // Global free list is exhausted, create a full batch of new Blocks.
+            uint64_t iFirstBlock = CreateBlocks(THREAD_CACHE_BATCH_SIZE);
+            for (uint64_t i = THREAD_CACHE_BATCH_SIZE; i > 0; --i)
+            {
+                cache.iFreeBlocks.push_back(static_cast<uint32_t>(iFirstBlock + i - 1));
+            }
+        }
+    }
+
+    void MemoryManager::FlushThreadCache(ThreadCache& cache, size_t nBlocks)
+    {
+        for (size_t i = 0; i < nBlocks && !cache.iFreeBlocks.empty(); ++i)
+        {
+            PushFreeBlock(cache.iFreeBlocks.back());
+            cache.iFreeBlocks.pop_back();
+        }
+    }
+
+    void MemoryManager::AddSharedRef(uint64_t id)
+    {
+        BlockHeader* pHeader = GetLiveBlockHeader(id);
+        if (pHeader != nullptr)
+        {
+            pHeader->nSharedRefs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    bool MemoryManager::ReleaseSharedRef(uint64_t id)
+    {
+        BlockHeader* pHeader = GetLiveBlockHeader(id);
+        if (pHeader == nullptr)
+        {
+            return false;
+        }
+
+        return pHeader->nSharedRefs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    bool MemoryManager::TryAddSharedRef(uint64_t id)
+    {
+        BlockHeader* pHeader = GetLiveBlockHeader(id);
+        if (pHeader == nullptr)
+        {
+            return false;
+        }
+
+        // Never resurrect an object whose last SharedRef is being released.
+        uint32_t nSharedRefs = pHeader->nSharedRefs.load();
+        do
+        {
+            if (nSharedRefs == 0)
+            {
+                return false;
+            }
+        } while (!pHeader->nSharedRefs.compare_exchange_weak(nSharedRefs, nSharedRefs + 1));
+
+        // Another thread may have freed and recycled the Block in the meantime, in which case the
+        // count that was just incremented belongs to another object.
+        if (GetLiveBlockHeader(id) != pHeader)
+        {
+            pHeader->nSharedRefs.fetch_sub(1);
+            return false;
+        }
+
+        return true;
+    }
+
+    uint32_t MemoryManager::GetNumSharedRefs(uint64_t id)
+    {
+        BlockHeader* pHeader = GetLiveBlockHeader(id);
+        if (pHeader == nullptr)
+        {
+            return 0;
+        }
+
+        return pHeader->nSharedRefs.load();
+    }
+
+    MemoryManager::BlockHeader* MemoryManager::GetLiveBlockHeader(uint64_t id)
+    {
+        if (id == IMemoryManager::INVALID_ID || id == IMemoryManager::MEMORY_MANAGER_ID)
+        {
+            return nullptr;
+        }
+
+        // The header is located through the allocation rather than the object's memory, so
+        // that it can be found while the object is being swapped.
+        uint64_t iBlock = GetBlockIndex(id);
+        const Block& block = GetBlock(iBlock);
+
+        if (GetBlockGeneration(iBlock).load() != GetGeneration(id) || block.pAllocation == nullptr)
+        {
+            return nullptr;
+        }
+
+        return GetBlockHeader(block);
+    }
+
+    MemoryManager::BlockHeader* MemoryManager::GetBlockHeader(const Block& block)
+    {
+        return reinterpret_cast<BlockHeader*>(block.pAllocation + block.headerSize - sizeof(BlockHeader));
+    }
+
+    uint32_t MemoryManager::RegisterTypeKey(const char* pKey)
+    {
+        std::lock_guard<std::mutex> lock(m_TypeKeys.mutex);
+
+        auto typeKeyIt = m_TypeKeys.iKeysByKey.find(pKey);
+        if (typeKeyIt != m_TypeKeys.iKeysByKey.end())
+        {
+            return typeKeyIt->second;
+        }
+
+        if (m_TypeKeys.keys.size() >= MAX_TYPE_KEYS)
+        {
+            return UNKNOWN_TYPE_KEY;
+        }
+
+        uint32_t iTypeKey = static_cast<uint32_t>(m_TypeKeys.keys.size());
+        m_TypeKeys.keys.push_back(pKey);
+        m_TypeKeys.iKeysByKey[pKey] = iTypeKey;
+
+        return iTypeKey;
+    }
+
+    MemoryManager::ThreadState& MemoryManager::GetThreadState()
+    {
+        if (!m_bConcurrent)
+        {
+            return m_ThreadState;
+        }
+
+        thread_local ThreadCacheGuard guard;
+
+        ThreadCacheGuard::Entry* pEntry = nullptr;
+        for (ThreadCacheGuard::Entry& entry : guard.entries)
+        {
+            if (entry.pOwner == m_pThreadCacheOwner)
+            {
+                pEntry = &entry;
+                break;
+            }
+        }
+
+        if (pEntry == nullptr)
+        {
+            // Forget MemoryManagers that have been destroyed since.
+            guard.entries.remove_if([](const ThreadCacheGuard::Entry& entry) {
+                std::lock_guard<std::mutex> lock(entry.pOwner->mutex);
+                return entry.pOwner->pMemoryManager == nullptr;
+            });
+
+            guard.entries.emplace_back();
+            pEntry = &guard.entries.back();
+            pEntry->pOwner = m_pThreadCacheOwner;
+        }
+
+        // Every ThreadCache may be taken. Try again on each use, until one is given back.
+        if (pEntry->state.pCache == nullptr && AcquireThreadCache(pEntry->iCache))
+        {
+            pEntry->state.pCache = &m_pThreadCaches[pEntry->iCache];
+        }
+
+        return pEntry->state;
+    }
+
+    void MemoryManager::SetPendingTypeKey(uint32_t iTypeKey)
+    {
+        GetThreadState().iPendingTypeKey = iTypeKey;
+    }
+
+    uint32_t MemoryManager::TakePendingTypeKey()
+    {
+        // Consume the key, so that allocations made by the object's constructor are not
+        // attributed to it.
+        ThreadState& state = GetThreadState();
+
+        uint32_t iTypeKey = state.iPendingTypeKey;
+        state.iPendingTypeKey = UNKNOWN_TYPE_KEY;
+
+        return iTypeKey;
+    }
+
+    // Raise a high-water mark, if it has been exceeded.
+    static void UpdateHighWater(std::atomic<uint64_t>& highWater, uint64_t value)
+    {
+        uint64_t previous = highWater.load(std::memory_order_relaxed);
+        while (value > previous
+            && !highWater.compare_exchange_weak(previous, value, std::memory_order_relaxed))
+        {}
+    }
+
+    void MemoryManager::RecordAllocation(uint32_t iTypeKey, uint64_t size)
+    {
+        TypeCounters& counters = m_pTypeCounters[iTypeKey];
+        counters.nAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t nLiveBlocks = counters.nLiveBlocks.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint64_t liveBytes = counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+
+        UpdateHighWater(counters.highWaterBlocks, nLiveBlocks);
+        UpdateHighWater(counters.highWaterBytes, liveBytes);
+    }
+
+    void MemoryManager::RecordFree(uint32_t iTypeKey, uint64_t size)
+    {
+        TypeCounters& counters = m_pTypeCounters[iTypeKey];
+        counters.nFrees.fetch_add(1, std::memory_order_relaxed);
+        counters.nLiveBlocks.fetch_sub(1, std::memory_order_relaxed);
+        counters.liveBytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    void MemoryManager::RecordSwap(uint32_t iTypeKey, uint64_t previousSize, uint64_t size)
+    {
+        TypeCounters& counters = m_pTypeCounters[iTypeKey];
+        counters.nSwaps.fetch_add(1, std::memory_order_relaxed);
+
+        // Unsigned arithmetic wraps, so this also handles an object that shrank.
+        uint64_t liveBytes = counters.liveBytes.fetch_add(size - previousSize, std::memory_order_relaxed)
+            + (size - previousSize);
+        UpdateHighWater(counters.highWaterBytes, liveBytes);
+    }
+
+    void MemoryManager::ThrowNullRef(const char* pMessage)
+    {
+        throw std::runtime_error(pMessage);
+    }
+
+    uint64_t MemoryManager::GetAlignment(uint64_t size)
+    {
+        // hscpp only passes the object size. Since sizeof(T) is a multiple of alignof(T), the
+        // lowest set bit of the size is a safe upper bound on the object's alignment.
+        uint64_t alignment = size & (~size + 1);
+        if (alignment == 0 || alignment > SlabAllocator::MAX_ALIGNMENT)
+        {
+            alignment = SlabAllocator::MAX_ALIGNMENT;
+        }
+
+        return alignment;
+    }
+
+    uint64_t MemoryManager::GetHeaderSize(uint64_t alignment)
+    {
+        return (sizeof(BlockHeader) + alignment - 1) & ~(alignment - 1);
+    }
+
+    MemoryManager::BulkAllocationScope::BulkAllocationScope(
+        MemoryManager& memoryManager, uint64_t count, uint32_t iTypeKey)
+        : m_MemoryManager(memoryManager)
+    {
+        m_BulkAllocation.iTypeKey = iTypeKey;
+        m_BulkAllocation.batch.nInstances = count;
+
+        // Bulk allocations may nest, ex. if a constructor calls AllocateN.
+        ThreadState& state = m_MemoryManager.GetThreadState();
+        m_pPreviousBulkAllocation = state.pBulkAllocation;
+        state.pBulkAllocation = &m_BulkAllocation;
+    }
+
+    MemoryManager::BulkAllocationScope::~BulkAllocationScope()
+    {
+        m_MemoryManager.GetThreadState().pBulkAllocation = m_pPreviousBulkAllocation;
+        m_MemoryManager.FinishRegionBatch(m_BulkAllocation.batch);
+    }
+
+    MemoryManager::MutatorScope::MutatorScope(MemoryManager& memoryManager)
+        : m_MemoryManager(memoryManager)
+    {
+        if (!m_MemoryManager.m_bConcurrent)
+        {
+            return;
+        }
+
+        // The thread that stopped the world is free to allocate, ex. during a runtime swap.
+        if (m_MemoryManager.m_bWorldStopped.load()
+            && m_MemoryManager.m_WorldOwner.load() == std::this_thread::get_id())
+        {
+            return;
+        }
+
+        while (true)
+        {
+            // Announce the mutator before checking the flag. StopTheWorld sets the flag before
+            // waiting for mutators, so at least one side is guaranteed to see the other.
+            m_MemoryManager.m_nActiveMutators.fetch_add(1);
+            if (!m_MemoryManager.m_bWorldStopped.load())
+            {
+                m_bEntered = true;
+                return;
+            }
+
+            m_MemoryManager.m_nActiveMutators.fetch_sub(1);
+            while (m_MemoryManager.m_bWorldStopped.load())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    MemoryManager::MutatorScope::~MutatorScope()
+    {
+        if (m_bEntered)
+        {
+            m_MemoryManager.m_nActiveMutators.fetch_sub(1);
+        }
+    }
+
+    MemoryManager::Config::Config()
+    {
+        // AllocateCb and FreeCb are left empty, so that the built-in SlabAllocator is used.
     }
-}}
\ No newline at end of file
+}}
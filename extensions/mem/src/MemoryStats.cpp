@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include "hscpp/mem/MemoryStats.h"
+
+namespace hscpp { namespace mem {
+
+    std::vector<TypeStatsDiff> MemoryStatsDiff::GetLeaks() const
+    {
+        std::vector<TypeStatsDiff> leaks;
+        for (const auto& typeDiff : types)
+        {
+            if (typeDiff.liveBlocksDelta > 0)
+            {
+                leaks.push_back(typeDiff);
+            }
+        }
+
+        return leaks;
+    }
+
+    const TypeStats* MemoryStats::Find(const std::string& key) const
+    {
+        auto typeIt = std::lower_bound(types.begin(), types.end(), key,
+            [](const TypeStats& typeStats, const std::string& key) {
+                return typeStats.key < key;
+            });
+
+        if (typeIt == types.end() || typeIt->key != key)
+        {
+            return nullptr;
+        }
+
+        return &*typeIt;
+    }
+
+    MemoryStatsDiff MemoryStats::Diff(const MemoryStats& previous) const
+    {
+        MemoryStatsDiff diff;
+        diff.seconds = std::chrono::duration<double>(time - previous.time).count();
+
+        for (const auto& typeStats : types)
+        {
+            // A type missing from the earlier snapshot had not been allocated yet.
+            TypeStats previousTypeStats;
+            const TypeStats* pPreviousTypeStats = previous.Find(typeStats.key);
+            if (pPreviousTypeStats != nullptr)
+            {
+                previousTypeStats = *pPreviousTypeStats;
+            }
+
+            TypeStatsDiff typeDiff;
+            typeDiff.key = typeStats.key;
+            typeDiff.liveBlocksDelta = static_cast<int64_t>(typeStats.nLiveBlocks)
+                - static_cast<int64_t>(previousTypeStats.nLiveBlocks);
+            typeDiff.liveBytesDelta = static_cast<int64_t>(typeStats.liveBytes)
+                - static_cast<int64_t>(previousTypeStats.liveBytes);
+            typeDiff.nAllocations = typeStats.nAllocations - previousTypeStats.nAllocations;
+            typeDiff.nFrees = typeStats.nFrees - previousTypeStats.nFrees;
+            typeDiff.nSwaps = typeStats.nSwaps - previousTypeStats.nSwaps;
+
+            if (diff.seconds > 0)
+            {
+                typeDiff.allocationsPerSecond = typeDiff.nAllocations / diff.seconds;
+                typeDiff.freesPerSecond = typeDiff.nFrees / diff.seconds;
+            }
+
+            diff.types.push_back(typeDiff);
+        }
+
+        return diff;
+    }
+
+}}
@@ -0,0 +1,172 @@
+#include <cassert>
+
+#include "hscpp/mem/SlabAllocator.h"
+
+namespace hscpp { namespace mem {
+
+    // Sizes up to SMALL_SLOT_SIZE are spaced SMALL_STEP apart. After that, each doubling of size
+    // is split into N_CLASSES_PER_GROUP evenly spaced classes, which bounds internal fragmentation
+    // to roughly 25%. Every step is a power of two, which guarantees slot alignment.
+    const static uint64_t SMALL_STEP = 16;
+    const static uint64_t SMALL_SLOT_SIZE = 128;
+    const static size_t N_SMALL_CLASSES = SMALL_SLOT_SIZE / SMALL_STEP;
+    const static size_t N_CLASSES_PER_GROUP = 4;
+
+    SlabAllocator::SlabAllocator(uint64_t slabSize /* = 64 * 1024 */)
+        : m_SlabSize(slabSize)
+    {
+        // A slab must fit at least one slot of the largest size class.
+        if (m_SlabSize < MAX_SLOT_SIZE)
+        {
+            m_SlabSize = MAX_SLOT_SIZE;
+        }
+    }
+
+    SlabAllocator::~SlabAllocator()
+    {
+        for (uint8_t* pSlab : m_Slabs)
+        {
+            AlignedFree(pSlab);
+        }
+    }
+
+    uint8_t* SlabAllocator::Allocate(uint64_t size)
+    {
+        if (size > MAX_SLOT_SIZE)
+        {
+            return AlignedAllocate(size);
+        }
+
+        size_t iSizeClass = GetSizeClassIndex(size);
+        SizeClass& sizeClass = m_SizeClasses.at(iSizeClass);
+
+        // Prefer recycling a freed slot, as it is likely to still be in cache.
+        if (sizeClass.pFreeList != nullptr)
+        {
+            FreeSlot* pSlot = sizeClass.pFreeList;
+            sizeClass.pFreeList = pSlot->pNext;
+
+            return reinterpret_cast<uint8_t*>(pSlot);
+        }
+
+        uint64_t slotSize = GetSizeClassSize(iSizeClass);
+        if (sizeClass.pNextSlot == nullptr
+            || static_cast<uint64_t>(sizeClass.pSlabEnd - sizeClass.pNextSlot) < slotSize)
+        {
+            // Current slab is exhausted. The tail end of the old slab is abandoned, which wastes
+            // less than one slot.
+            uint8_t* pSlab = AlignedAllocate(m_SlabSize);
+            m_Slabs.push_back(pSlab);
+
+            sizeClass.pNextSlot = pSlab;
+            sizeClass.pSlabEnd = pSlab + m_SlabSize;
+        }
+
+        uint8_t* pMemory = sizeClass.pNextSlot;
+        sizeClass.pNextSlot += slotSize;
+
+        return pMemory;
+    }
+
+    void SlabAllocator::Free(uint8_t* pMemory, uint64_t size)
+    {
+        if (pMemory == nullptr)
+        {
+            return;
+        }
+
+        if (size > MAX_SLOT_SIZE)
+        {
+            AlignedFree(pMemory);
+            return;
+        }
+
+        SizeClass& sizeClass = m_SizeClasses.at(GetSizeClassIndex(size));
+
+        FreeSlot* pSlot = reinterpret_cast<FreeSlot*>(pMemory);
+        pSlot->pNext = sizeClass.pFreeList;
+        sizeClass.pFreeList = pSlot;
+    }
+
+    uint64_t SlabAllocator::GetSizeClass(uint64_t size)
+    {
+        if (size > MAX_SLOT_SIZE)
+        {
+            return size;
+        }
+
+        return GetSizeClassSize(GetSizeClassIndex(size));
+    }
+
+    uint64_t SlabAllocator::GetNumSlabs() const
+    {
+        return m_Slabs.size();
+    }
+
+    size_t SlabAllocator::GetSizeClassIndex(uint64_t size)
+    {
+        assert(size <= MAX_SLOT_SIZE);
+
+        if (size == 0)
+        {
+            size = 1;
+        }
+
+        if (size <= SMALL_SLOT_SIZE)
+        {
+            return static_cast<size_t>((size + SMALL_STEP - 1) / SMALL_STEP) - 1;
+        }
+
+        // Find the group for which groupBase < size <= 2 * groupBase.
+        size_t iGroup = 0;
+        uint64_t groupBase = SMALL_SLOT_SIZE;
+        while (size > 2 * groupBase)
+        {
+            groupBase *= 2;
+            ++iGroup;
+        }
+
+        uint64_t step = groupBase / N_CLASSES_PER_GROUP;
+        size_t iInGroup = static_cast<size_t>((size - groupBase + step - 1) / step) - 1;
+
+        return N_SMALL_CLASSES + iGroup * N_CLASSES_PER_GROUP + iInGroup;
+    }
+
+    uint64_t SlabAllocator::GetSizeClassSize(size_t iSizeClass)
+    {
+        if (iSizeClass < N_SMALL_CLASSES)
+        {
+            return (iSizeClass + 1) * SMALL_STEP;
+        }
+
+        size_t iGroup = (iSizeClass - N_SMALL_CLASSES) / N_CLASSES_PER_GROUP;
+        size_t iInGroup = (iSizeClass - N_SMALL_CLASSES) % N_CLASSES_PER_GROUP;
+
+        uint64_t groupBase = SMALL_SLOT_SIZE << iGroup;
+        uint64_t step = groupBase / N_CLASSES_PER_GROUP;
+
+        return groupBase + (iInGroup + 1) * step;
+    }
+
+    uint8_t* SlabAllocator::AlignedAllocate(uint64_t size)
+    {
+        // Over-allocate, and store the distance to the start of the allocation in the byte
+        // preceding the aligned pointer. This avoids relying on C++17 aligned new.
+        uint8_t* pRaw = new uint8_t[size + MAX_ALIGNMENT];
+
+        uintptr_t address = reinterpret_cast<uintptr_t>(pRaw) + 1;
+        address = (address + MAX_ALIGNMENT - 1) & ~static_cast<uintptr_t>(MAX_ALIGNMENT - 1);
+
+        uint8_t* pAligned = reinterpret_cast<uint8_t*>(address);
+        pAligned[-1] = static_cast<uint8_t>(pAligned - pRaw);
+
+        return pAligned;
+    }
+
+    void SlabAllocator::AlignedFree(uint8_t* pMemory)
+    {
+        uint8_t* pRaw = pMemory - pMemory[-1];
+        delete[] pRaw;
+    }
+
+}}
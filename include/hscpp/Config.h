@@ -2,6 +2,8 @@
 
 #include <chrono>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "hscpp/Filesystem.h"
 #include "hscpp/compiler/ICompiler.h"
@@ -25,7 +27,55 @@ namespace hscpp
 
     struct FileWatcherConfig
     {
+        // Maximum time to gather events after the first one arrives, before they are reported.
         std::chrono::milliseconds latency = std::chrono::milliseconds(100);
+
+        // Events are reported early once every modified file has been closed for writing, and no
+        // event has arrived for this long. Each time events resume within this window, it is
+        // doubled for the current batch, up to latency. Currently Linux only.
+        std::chrono::milliseconds quietPeriod = std::chrono::milliseconds(5);
+
+        // Also watch the subdirectories of each watched directory, including those created later.
+        bool bRecursive = false;
+
+        // Subdirectories with these names are skipped when watching recursively. On Linux, every
+        // watched directory uses up one of the fs.inotify.max_user_watches shared by the user.
+        std::vector<std::string> ignoredDirectoryNames = { ".git", ".hg", ".svn" };
+
+        // Maximum number of directories to watch, or 0 to only be limited by the OS.
+        size_t maxWatchedDirectories = 0;
+
+        // Read and gather events on a dedicated thread, which hands them over to PollChanges in
+        // batches. PollChanges then costs a single atomic load when idle. Currently Linux only.
+        bool bUseWatcherThread = false;
+
+        // Detect changes by periodically scanning watched directories, rather than through OS
+        // notifications. Use this on network, FUSE, or bind-mounted filesystems, where
+        // notifications may be missing.
+        bool bUsePolling = false;
+
+        // Time between polling scans.
+        std::chrono::milliseconds pollingInterval = std::chrono::milliseconds(500);
+
+        // Threads used to stat files during a polling scan, or 0 for one per hardware thread.
+        size_t nPollingThreads = 0;
+    };
+
+    struct PreprocessorConfig
+    {
+        // Threads used to lex, parse, and interpret files, or 0 for one per hardware thread. Small
+        // batches of files are always processed on the calling thread.
+        size_t nThreads = 0;
+
+        // Leave out of the dependency graph #includes that are known not to be compiled, such as
+        // those within #ifdef _WIN32 on other platforms. Conditions are evaluated against the
+        // preprocessor definitions and the platform; those that cannot be are assumed to hold.
+        bool bEvaluateConditionalIncludes = true;
+
+        // With Feature::DependentCompilation, compile only the dependents that include a class
+        // marked with HSCPP_TRACK, since others have no effect after a swap. Files that share an
+        // hscpp_module with a compiled file are still compiled, so that the module links.
+        bool bCompileOnlyTrackedDependents = false;
     };
 
     struct Config
@@ -41,6 +91,11 @@ namespace hscpp
 
         CompilerConfig compiler;
         FileWatcherConfig fileWatcher;
+        PreprocessorConfig preprocessor;
+
+        // If set, the dependency graph is saved to this file and reloaded on startup, so that
+        // files which have not changed since need not be preprocessed again.
+        fs::path dependencyGraphCachePath;
 
         Flag flags = Flag::None;
     };
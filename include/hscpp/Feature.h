@@ -18,6 +18,11 @@ namespace hscpp
         // Do not automatically trigger compilation on file changes. User must call the
         // hscpp::Hotswapper's TriggerManualBuild method.
         ManualCompilationOnly,
+
+        // Do not compile files whose changes only touch comments and whitespace. Such headers
+        // do not trigger compilation of their dependents either. Line numbers in the running
+        // code, such as those of __LINE__ or a debugger, may be stale until the next compile.
+        IgnoreCommentAndWhitespaceChanges,
     };
 
     class FeatureHasher
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <string>
+#include <chrono>
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
 #include <map>
 
 #include "hscpp/Platform.h"
 #include "hscpp/file-watcher/IFileWatcher.h"
+#include "hscpp/file-watcher/FileHashCache.h"
 #include "hscpp/compiler/ICompiler.h"
 #include "hscpp/ModuleManager.h"
 #include "hscpp/module/AllocationResolver.h"
@@ -35,6 +38,17 @@ namespace hscpp
             FailedSwap,
         };
 
+        // Cost of compiling a source file as part of a rebuild.
+        struct CompileCost
+        {
+            fs::path sourceFilePath;
+
+            // Time taken by the last successful compile of the file. A file that has not yet been
+            // compiled is unmeasured.
+            bool bMeasured = false;
+            std::chrono::milliseconds lastCompileDuration = std::chrono::milliseconds(0);
+        };
+
         Hotswapper();
         explicit Hotswapper(std::unique_ptr<Config> pConfig);
         Hotswapper(std::unique_ptr<Config> pConfig,
@@ -57,6 +71,10 @@ namespace hscpp
         bool IsCompiling();
         bool IsCompilerInitialized();
 
+        // Source files that would be compiled if the given file changed, with the most expensive
+        // first. Useful to warn about, or defer, expensive rebuilds.
+        std::vector<CompileCost> QueryRebuildImpact(const fs::path& filePath);
+
         void SetCallbacks(const Callbacks& callbacks);
         void DoProtectedCall(const std::function<void()>& cb);
 
@@ -149,6 +167,16 @@ namespace hscpp
         std::unique_ptr<IFileWatcher> m_pFileWatcher;
         std::vector<IFileWatcher::Event> m_FileEvents;
 
+        // Saves that do not change a file's content are dropped, rather than triggering a compile.
+        // If a compile fails, its files are invalidated so that saving them again retries it.
+        FileHashCache m_FileHashCache;
+        std::vector<fs::path> m_CompilingFilePaths;
+
+        // Compile time of each source file, measured on the last successful compile that included it.
+        std::unordered_map<fs::path, std::chrono::milliseconds, FsPathHasher> m_CompileDurationsByFilePath;
+        std::vector<fs::path> m_CompilingSourceFilePaths;
+        std::chrono::steady_clock::time_point m_CompileStartTime;
+
         std::unique_ptr<ICompiler> m_pCompiler;
         std::unique_ptr<IPreprocessor> m_pPreprocessor;
 
@@ -156,6 +184,7 @@ namespace hscpp
         FeatureManager m_FeatureManager;
 
         bool m_bDependencyGraphNeedsRefresh = true;
+        bool m_bDependencyGraphCacheLoaded = false;
 
         AllocationResolver m_AllocationResolver;
         Callbacks m_Callbacks;
@@ -171,9 +200,13 @@ namespace hscpp
         bool CreateHscppTempDirectory();
         bool CreateBuildDirectory();
 
+        void InvalidateFileHashes(const std::vector<fs::path>& filePaths);
+        void RecordCompileDurations();
+
         void UpdateDependencyGraph(const std::vector<fs::path>& canonicalModifiedFilePaths,
                 const std::vector<fs::path>& canonicalRemovedFilePaths);
         void RefreshDependencyGraph();
+        void SaveDependencyGraphCache();
 
         template <typename T>
         void AppendDirectoryFiles(const std::map<int, fs::path>& directoryPathsByHandle,
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+#include "hscpp/Platform.h"
+
+namespace hscpp
+{
+
+    // Read-only view of a file's contents, mapped into memory rather than copied.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile& rhs) = delete;
+        MappedFile& operator=(const MappedFile& rhs) = delete;
+
+        bool Open(const fs::path& filePath);
+        void Close();
+
+        const char* GetData() const;
+        size_t GetSize() const;
+
+    private:
+        const char* m_pData = nullptr;
+        size_t m_Size = 0;
+
+#if defined(HSCPP_PLATFORM_WIN32)
+        HANDLE m_hFile = INVALID_HANDLE_VALUE;
+        HANDLE m_hMapping = NULL;
+#endif
+    };
+
+}
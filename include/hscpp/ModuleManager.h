@@ -2,17 +2,19 @@
 
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 
 #include "hscpp/Platform.h"
 #include "hscpp/module/ITracker.h"
 #include "hscpp/module/IAllocator.h"
 #include "hscpp/module/Constructors.h"
 #include "hscpp/module/ModuleInterface.h"
+#include "hscpp/module/ITrackedObjectRebuilder.h"
 
 namespace hscpp
 {
 
-    class ModuleManager
+    class ModuleManager : public ITrackedObjectRebuilder
     {
     public:
 
@@ -23,9 +25,13 @@ namespace hscpp
 
         bool PerformRuntimeSwap(const fs::path& modulePath);
 
+        void RebuildTrackedObjects(const std::string& key) override;
+        std::vector<std::string> GetTrackedKeys(bool bRequireSwapHandler) override;
+
     private:
         bool m_bSwapping = false;
         std::unordered_map<std::string, std::vector<ITracker*>> m_TrackersByKey;
+        std::recursive_mutex m_TrackersMutex;
         
         // The library user owns this memory.
         IAllocator* m_pAllocator = nullptr;
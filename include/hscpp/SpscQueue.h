@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace hscpp
+{
+
+    // Bounded, lock-free queue with a single producer thread and a single consumer thread. Both
+    // sides only ever wait on their own operations, and checking an empty queue costs a single
+    // atomic load.
+    template <typename T>
+    class SpscQueue
+    {
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+    public:
+        // Capacity is rounded up to a power of two.
+        explicit SpscQueue(size_t capacity)
+        {
+            size_t nSlots = 1;
+            while (nSlots < capacity)
+            {
+                nSlots <<= 1;
+            }
+
+            m_Slots.resize(nSlots);
+            m_Mask = nSlots - 1;
+        }
+
+        // Producer only. Returns false, leaving value untouched, if the queue is full.
+        bool TryPush(T&& value)
+        {
+            size_t tail = m_Tail.load(std::memory_order_relaxed);
+            if (tail - m_Head.load(std::memory_order_acquire) == m_Slots.size())
+            {
+                return false;
+            }
+
+            m_Slots[tail & m_Mask] = std::move(value);
+            m_Tail.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // Consumer only. Returns false if the queue is empty.
+        bool TryPop(T& value)
+        {
+            size_t head = m_Head.load(std::memory_order_relaxed);
+            if (head == m_Tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            value = std::move(m_Slots[head & m_Mask]);
+            m_Head.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        size_t GetCapacity() const
+        {
+            return m_Slots.size();
+        }
+
+    private:
+        std::vector<T> m_Slots;
+        size_t m_Mask = 0;
+
+        // Keep the consumer and producer indices on different cache lines.
+        std::atomic<size_t> m_Head = { 0 };
+        uint8_t m_HeadPadding[64 - sizeof(std::atomic<size_t>)] = {};
+
+        std::atomic<size_t> m_Tail = { 0 };
+    };
+
+}
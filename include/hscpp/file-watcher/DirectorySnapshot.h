@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "hscpp/Platform.h"
+#include "hscpp/Config.h"
+#include "hscpp/file-watcher/IFileWatcher.h"
+
+namespace hscpp
+{
+
+    // Compact record of the modification time, size, and inode of every file in a directory.
+    // Comparing two snapshots yields the files that changed between them.
+    class DirectorySnapshot
+    {
+    public:
+        // Scan a directory, following config.bRecursive and config.ignoredDirectoryNames. Files
+        // are stat'ed across config.nPollingThreads threads.
+        bool Scan(const fs::path& directoryPath, const FileWatcherConfig& config);
+
+        // Append an event for each file that was created, modified, or removed since previous.
+        void Diff(const DirectorySnapshot& previous, std::vector<IFileWatcher::Event>& events) const;
+
+        // Restat the files named by events that have already been reported, so that a later Diff
+        // only yields changes that were missed. Paths outside the scanned directory are ignored.
+        void Update(const std::vector<IFileWatcher::Event>& events);
+
+        size_t GetFileCount() const;
+
+    private:
+        struct FileEntry
+        {
+            fs::path::string_type path;
+            int64_t modificationTime = 0;
+            uint64_t size = 0;
+            uint64_t inode = 0;
+        };
+
+        fs::path::string_type m_DirectoryPath;
+
+        // Sorted by path.
+        std::vector<FileEntry> m_Files;
+
+        void UpdateFile(const fs::path& filePath);
+
+        static bool StatFile(FileEntry& entry);
+        static void StatFiles(std::vector<FileEntry>& files, size_t nThreads);
+    };
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "hscpp/Platform.h"
+#include "hscpp/Config.h"
+#include "hscpp/FsPathHasher.h"
+#include "hscpp/file-watcher/IFileWatcher.h"
+
+namespace hscpp
+{
+
+    // Remembers a content hash for each source and header file, so that events for files which
+    // were saved without being changed can be dropped.
+    class FileHashCache
+    {
+    public:
+        enum class HashMode
+        {
+            // Hash every byte of a file.
+            Content,
+
+            // Hash the significant token stream of a file, ignoring comments and whitespace
+            // between tokens.
+            Tokens,
+        };
+
+        // Changing the mode rehashes every recorded file.
+        void SetHashMode(HashMode mode);
+
+        // Record the hashes of the source and header files within a directory, following
+        // config.bRecursive and config.ignoredDirectoryNames.
+        void AddDirectory(const fs::path& directoryPath, const FileWatcherConfig& config);
+
+        // Forget the hashes of all files within a directory and its subdirectories.
+        void RemoveDirectory(const fs::path& directoryPath);
+
+        // Remove events of files whose content matches the last recorded hash, and record the
+        // hashes of the remaining files. Events for removed and non-source files are kept.
+        void RemoveUnchangedEvents(std::vector<IFileWatcher::Event>& events);
+
+        // Forget a file's hash, so that its next event is kept even if its content is unchanged.
+        void Invalidate(const fs::path& filePath);
+        void Clear();
+
+        static bool HashFile(const fs::path& filePath, HashMode mode, uint64_t& hash);
+        static uint64_t HashContent(const char* pContent, size_t size);
+
+    private:
+        HashMode m_HashMode = HashMode::Content;
+        std::unordered_map<fs::path, uint64_t, FsPathHasher> m_HashesByPath;
+
+        void AddFile(const fs::path& filePath);
+        static fs::path GetCanonicalPath(const fs::path& filePath);
+
+        static uint64_t HashTokens(const std::vector<char>& content);
+    };
+
+}
@@ -5,12 +5,19 @@
 
 #include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include <array>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 #include "hscpp/Platform.h"
 #include "hscpp/file-watcher/IFileWatcher.h"
+#include "hscpp/file-watcher/DirectorySnapshot.h"
 #include "hscpp/Config.h"
+#include "hscpp/FsPathHasher.h"
+#include "hscpp/SpscQueue.h"
 
 namespace hscpp
 {
@@ -19,6 +26,7 @@ namespace hscpp
     {
     public:
         FileWatcher(FileWatcherConfig* pConfig);
+        ~FileWatcher() override;
 
         bool AddWatch(const fs::path& directoryPath) override;
         bool RemoveWatch(const fs::path& directoryPath) override;
@@ -29,26 +37,80 @@ namespace hscpp
     private:
         struct DirectoryWatch
         {
-            int wd;
             fs::path directoryPath;
+
+            // Resolved once when the watch is added, so that events need not canonicalize paths.
+            fs::path canonicalDirectoryPath;
+
+            // Watch of the directory passed to AddWatch. Subdirectories watched recursively are
+            // removed along with it.
+            int rootWd = -1;
         };
 
         FileWatcherConfig* m_pConfig = nullptr;
 
         std::chrono::steady_clock::time_point m_LastPollTime = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point m_LastEventTime = std::chrono::steady_clock::now();
+        std::chrono::milliseconds m_QuietPeriod = std::chrono::milliseconds(0);
         bool m_bGatheringEvents = false;
 
+        // Files that were modified, but have not yet been closed for writing.
+        std::unordered_set<fs::path, FsPathHasher> m_OpenForWritePaths;
+
         int m_NotifyFd = -1;
-        std::unordered_map<int, fs::path> m_DirectoryPathsByWd;
+
+        // Guards the watches, which are updated by the watcher thread as directories are created.
+        std::mutex m_WatchesMutex;
+        std::unordered_map<int, DirectoryWatch> m_DirectoryWatchesByWd;
+
+        // Snapshot of each directory passed to AddWatch, used to recover events lost when the
+        // inotify queue overflows. Updated with each batch of events that is handed out.
+        std::unordered_map<int, DirectorySnapshot> m_SnapshotsByRootWd;
+        bool m_bQueueOverflowed = false;
+
+        // Maximum number of watches this FileWatcher may hold, or 0 if unlimited.
+        size_t m_MaxWatches = 0;
+        bool m_bWarnedWatchLimit = false;
 
         std::vector<Event> m_PendingEvents;
 
+        // Pending events of files moved away, by inotify cookie. When the matching IN_MOVED_TO
+        // arrives, the event becomes a rename.
+        std::unordered_map<uint32_t, size_t> m_iMovedFromEventsByCookie;
+
+        // With a watcher thread, gathered events are handed to PollChanges in batches. The
+        // eventfd wakes the thread up, so that it can exit.
+        std::thread m_WatcherThread;
+        std::atomic<bool> m_bStopWatcherThread = { false };
+        int m_WakeFd = -1;
+        SpscQueue<std::vector<Event>> m_EventBatches;
+
         std::array<char, 32 * (sizeof(struct inotify_event) + NAME_MAX + 1)> m_NotifyBuffer;
 
+        bool InitializeNotifyFd();
+
         void PollChanges();
-        void HandleNotifyEvent(struct inotify_event* pNotifyEvent);
+        void ReadNotifyEvents();
+        void HandleNotifyEvent(struct inotify_event* pNotifyEvent,
+            std::chrono::steady_clock::time_point time);
+        void RescanAfterOverflow();
+        bool GatherPendingEvents(std::vector<Event>& events);
+        std::chrono::milliseconds GetGatherTimeout();
+
+        void StartWatcherThread();
+        void StopWatcherThread();
+        void RunWatcherThread();
+
+        int AddDirectoryWatch(const fs::path& directoryPath, int rootWd);
+        void AddSubdirectoryWatches(const fs::path& directoryPath, int rootWd, bool bReportFiles);
+        void RemoveDirectoryWatches(const fs::path& directoryPath);
+        bool IsIgnoredDirectory(const fs::path& directoryPath);
+        bool HasReachedWatchLimit();
+        void WarnWatchLimit();
 
         void CloseWatch(int wd);
+
+        static size_t GetMaxUserWatches();
     };
 
 }
\ No newline at end of file
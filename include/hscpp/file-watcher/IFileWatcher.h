@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <chrono>
 
 #include "hscpp/Filesystem.h"
 
@@ -12,7 +13,29 @@ namespace hscpp
     public:
         struct Event
         {
+            enum class Type
+            {
+                // The watcher does not know what happened, so the file must be checked on disk.
+                Unknown,
+
+                Created,
+                Modified,
+                Removed,
+
+                // The file was renamed from oldFilePath to filePath.
+                Renamed,
+            };
+
+            Type type = Type::Unknown;
+
             fs::path filePath;
+            fs::path oldFilePath;
+
+            // Whether filePath and oldFilePath are already canonical.
+            bool bCanonical = false;
+
+            // When the watcher received the event, or zero if unknown.
+            std::chrono::steady_clock::time_point time;
         };
 
         virtual ~IFileWatcher() = default;
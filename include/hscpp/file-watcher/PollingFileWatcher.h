@@ -0,0 +1,50 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "hscpp/Platform.h"
+#include "hscpp/file-watcher/IFileWatcher.h"
+#include "hscpp/file-watcher/DirectorySnapshot.h"
+#include "hscpp/Config.h"
+#include "hscpp/FsPathHasher.h"
+#include "hscpp/SpscQueue.h"
+
+namespace hscpp
+{
+
+    // Detects changes by scanning each watched directory every pollingInterval on a background
+    // thread, and comparing the result with the previous scan.
+    class PollingFileWatcher : public IFileWatcher
+    {
+    public:
+        PollingFileWatcher(FileWatcherConfig* pConfig);
+        ~PollingFileWatcher() override;
+
+        bool AddWatch(const fs::path& directoryPath) override;
+        bool RemoveWatch(const fs::path& directoryPath) override;
+        void ClearAllWatches() override;
+
+        void PollChanges(std::vector<Event>& events) override;
+
+    private:
+        FileWatcherConfig* m_pConfig = nullptr;
+
+        std::mutex m_SnapshotsMutex;
+        std::unordered_map<fs::path, DirectorySnapshot, FsPathHasher> m_SnapshotsByDirectoryPath;
+
+        std::thread m_ScanThread;
+        std::mutex m_ScanThreadMutex;
+        std::condition_variable m_ScanThreadCondition;
+        bool m_bStopScanThread = false;
+
+        SpscQueue<std::vector<Event>> m_EventBatches;
+
+        void RunScanThread();
+        void ScanDirectories(std::vector<Event>& events);
+    };
+
+}
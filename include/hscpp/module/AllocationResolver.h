@@ -3,10 +3,14 @@
 #include <iostream>
 #include <cstdint>
 #include <type_traits>
+#include <typeinfo>
+#include <string>
+#include <vector>
 
 #include "hscpp/module/IAllocator.h"
 #include "hscpp/module/ModuleSharedState.h"
 #include "hscpp/module/Constructors.h"
+#include "hscpp/module/ITrackedObjectRebuilder.h"
 
 namespace hscpp
 {
@@ -50,6 +54,12 @@ namespace hscpp
     class AllocationResolver
     {
     public:
+        AllocationResolver() = default;
+
+        explicit AllocationResolver(ITrackedObjectRebuilder* pTrackedObjectRebuilder)
+            : m_pTrackedObjectRebuilder(pTrackedObjectRebuilder)
+        {}
+
         template <typename T>
         typename std::enable_if<IsTracked<T>::yes, void>::type
         Allocate(AllocationInfo& info)
@@ -58,6 +68,12 @@ namespace hscpp
             // with HSCPP_TRACK. Allocate it using an hscpp Constructor.
             const char* pKey = decltype(T::hscpp_ClassKey)().ToString();
 
+            // Hold the lock until the object is constructed and its tracker registered. Otherwise,
+            // a runtime swap could run in between, and leave behind an object built from the old
+            // module's constructor. Allocators that block allocations must take this lock before
+            // blocking them, as MemoryManager::StopTheWorld does.
+            auto trackersLock = ModuleSharedState::LockTrackers();
+
             auto constructorIt = ModuleSharedState::s_pConstructorsByKey->find(pKey);
             if (constructorIt != ModuleSharedState::s_pConstructorsByKey->end())
             {
@@ -88,6 +104,22 @@ namespace hscpp
             }
         }
 
+        // Get the key a type was registered with in HSCPP_TRACK. Other types are identified by
+        // their typeid name.
+        template <typename T>
+        static typename std::enable_if<IsTracked<T>::yes, const char*>::type
+        GetTypeKey()
+        {
+            return decltype(T::hscpp_ClassKey)().ToString();
+        }
+
+        template <typename T>
+        static typename std::enable_if<IsTracked<T>::no, const char*>::type
+        GetTypeKey()
+        {
+            return typeid(T).name();
+        }
+
         template <typename T>
         T* Allocate()
         {
@@ -96,6 +128,30 @@ namespace hscpp
 
             return reinterpret_cast<T*>(info.pMemory);
         }
+
+        // Free and reconstruct all tracked objects of a type, as though it had been swapped. This
+        // lets an allocator move objects without invalidating their ids.
+        void RebuildTrackedObjects(const std::string& key)
+        {
+            if (m_pTrackedObjectRebuilder != nullptr)
+            {
+                m_pTrackedObjectRebuilder->RebuildTrackedObjects(key);
+            }
+        }
+
+        // Get the keys of types with tracked instances. See ITrackedObjectRebuilder::GetTrackedKeys.
+        std::vector<std::string> GetTrackedKeys(bool bRequireSwapHandler = false)
+        {
+            if (m_pTrackedObjectRebuilder == nullptr)
+            {
+                return {};
+            }
+
+            return m_pTrackedObjectRebuilder->GetTrackedKeys(bRequireSwapHandler);
+        }
+
+    private:
+        ITrackedObjectRebuilder* m_pTrackedObjectRebuilder = nullptr;
     };
 
 }
\ No newline at end of file
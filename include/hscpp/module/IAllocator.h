@@ -25,6 +25,17 @@ namespace hscpp
 
         // Called when an object is freed during a runtime swap, and should return the old object's id.
         virtual uint64_t Hscpp_FreeSwap(uint8_t* pMemory) = 0;
+
+        // Called before and after all nInstances tracked objects with the given key are freed and
+        // reallocated, during a runtime swap or a rebuild. Implementing these is optional.
+        virtual void Hscpp_BeginSwapBatch(const char* pKey, uint64_t nInstances)
+        {
+            (void)pKey;
+            (void)nInstances;
+        }
+
+        virtual void Hscpp_EndSwapBatch()
+        {}
     };
 
     template <typename T>
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace hscpp
+{
+    // Lets an allocator relocate tracked objects, without depending on module internals.
+    // Implemented by the ModuleManager, and exposed through the AllocationResolver.
+    class ITrackedObjectRebuilder
+    {
+    public:
+        virtual ~ITrackedObjectRebuilder() = default;
+
+        // Free and reconstruct all tracked objects of a type, as though it had been swapped.
+        virtual void RebuildTrackedObjects(const std::string& key) = 0;
+
+        // Get the keys of all types that currently have tracked instances. With
+        // bRequireSwapHandler, only types whose every instance has a swap handler are returned;
+        // the state of other types would be lost by a rebuild.
+        virtual std::vector<std::string> GetTrackedKeys(bool bRequireSwapHandler) = 0;
+    };
+}
@@ -13,5 +13,6 @@ namespace hscpp
         virtual uint64_t FreeTrackedObject() = 0;
         virtual std::string GetKey() = 0;
         virtual void CallSwapHandler(SwapInfo& info) = 0;
+        virtual bool HasSwapHandler() = 0;
     };
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
 #include <assert.h>
 
 #include "hscpp/module/ModuleSharedState.h"
@@ -38,6 +39,11 @@ namespace hscpp
             ModuleSharedState::s_pTrackersByKey = pTrackersByKey;
         }
 
+        virtual void SetTrackersMutex(std::recursive_mutex* pTrackersMutex)
+        {
+            ModuleSharedState::s_pTrackersMutex = pTrackersMutex;
+        }
+
         virtual void SetConstructorsByKey(std::unordered_map<std::string, IConstructor*>* pConstructorsByKey)
         {
             ModuleSharedState::s_pConstructorsByKey = pConstructorsByKey;
@@ -69,6 +75,10 @@ namespace hscpp
 
         virtual void PerformRuntimeSwap()
         {
+            // Hold off other threads from registering or unregistering trackers during the swap.
+            // Trackers created by the swap itself will re-enter the lock.
+            auto trackersLock = ModuleSharedState::LockTrackers();
+
             *ModuleSharedState::s_pbSwapping = true;
 
             // Get constructors registered within this module.
@@ -80,62 +90,141 @@ namespace hscpp
                 // Patch our global constructors to include the new constructors from this module.
                 (*ModuleSharedState::s_pConstructorsByKey)[key] = Constructors::GetConstructor(key);
 
-                // Find tracked objects corresponding to this constructor. If not found, this must
-                // be a new class, so no instances have been created yet.
-                auto trackersIt = ModuleSharedState::s_pTrackersByKey->find(key);
-                if (trackersIt != ModuleSharedState::s_pTrackersByKey->end())
-                {
-                    // Get tracked objects, and make a copy. As objects are freed, their tracker
-                    // will be erased from the trackedObjects vector.
-                    std::vector<ITracker*>& trackedObjects = trackersIt->second;
-                    std::vector<ITracker*> oldTrackedObjects = trackedObjects;
-
-                    size_t nInstances = trackedObjects.size();
+                // Find tracked objects corresponding to this constructor, and swap them out with
+                // instances built from the new constructor.
+                SwapTrackedObjects(key, Constructors::GetConstructor(key));
+            }
 
-                    std::vector<SwapInfo> swapInfos(nInstances);
-                    std::vector<uint64_t> memoryIds(nInstances);
+            *ModuleSharedState::s_pbSwapping = false;
+        }
 
-                    // Free the old objects; they will be swapped out with new instances.
-                    for (size_t i = 0; i < nInstances; ++i)
-                    {
-                        swapInfos.at(i).m_Id = i;
-                        swapInfos.at(i).m_Phase = SwapPhase::BeforeSwap;
+        // Free and reconstruct every tracked object of the given type with its current
+        // constructor, exactly as a runtime swap would. Allocators may use this to relocate objects.
+        virtual void RebuildTrackedObjects(const std::string& key)
+        {
+            // Shared state is unset if hscpp is disabled, in which case nothing is tracked.
+            if (ModuleSharedState::s_pConstructorsByKey == nullptr)
+            {
+                return;
+            }
 
-                        ITracker* pTracker = oldTrackedObjects.at(i);
+            auto trackersLock = ModuleSharedState::LockTrackers();
 
-                        pTracker->CallSwapHandler(swapInfos.at(i));
-                        memoryIds.at(i) = pTracker->FreeTrackedObject();
-                    }
+            auto constructorIt = ModuleSharedState::s_pConstructorsByKey->find(key);
+            if (constructorIt == ModuleSharedState::s_pConstructorsByKey->end())
+            {
+                return;
+            }
 
-                    // Freeing the tracked objects should have also deleted their tracker, so this
-                    // list should now be empty.
-                    assert(trackedObjects.empty());
+            *ModuleSharedState::s_pbSwapping = true;
+            SwapTrackedObjects(key, constructorIt->second);
+            *ModuleSharedState::s_pbSwapping = false;
+        }
 
-                    // Create new instances from the new constructors. These will have automatically
-                    // registered themselves into the m_pTrackersByKey map.
-                    IConstructor* pConstructor = Constructors::GetConstructor(key);
+        // Get the keys of all types that currently have tracked instances. With bRequireSwapHandler,
+        // types with an instance that has no swap handler are left out.
+        virtual std::vector<std::string> GetTrackedKeys(bool bRequireSwapHandler)
+        {
+            std::vector<std::string> keys;
+            if (ModuleSharedState::s_pTrackersByKey == nullptr)
+            {
+                return keys;
+            }
 
-                    for (size_t i = 0; i < nInstances; ++i)
-                    {
-                        pConstructor->AllocateSwap(memoryIds.at(i));
+            auto trackersLock = ModuleSharedState::LockTrackers();
 
-                        // After construction, a new tracker should have been added to trackedObjects.
-                        ITracker* pTracker = trackedObjects.at(i);
+            for (const auto& key__trackers : *ModuleSharedState::s_pTrackersByKey)
+            {
+                const std::vector<ITracker*>& trackers = key__trackers.second;
+                if (trackers.empty())
+                {
+                    continue;
+                }
 
-                        swapInfos.at(i).m_Phase = SwapPhase::AfterSwap;
-                        pTracker->CallSwapHandler(swapInfos.at(i));
-                        swapInfos.at(i).TriggerInitCb();
-                    }
+                if (bRequireSwapHandler && std::any_of(trackers.begin(), trackers.end(),
+                    [](ITracker* pTracker) { return !pTracker->HasSwapHandler(); }))
+                {
+                    continue;
                 }
+
+                keys.push_back(key__trackers.first);
             }
 
-            *ModuleSharedState::s_pbSwapping = false;
+            return keys;
         }
 
         virtual std::vector<Constructors::DuplicateKey> GetDuplicateKeys()
         {
             return Constructors::GetDuplicateKeys();
         }
+
+    protected:
+        // Must be called with the trackers lock held.
+        virtual void SwapTrackedObjects(const std::string& key, IConstructor* pConstructor)
+        {
+            // If not found, this must be a new class, so no instances have been created yet.
+            auto trackersIt = ModuleSharedState::s_pTrackersByKey->find(key);
+            if (trackersIt == ModuleSharedState::s_pTrackersByKey->end())
+            {
+                return;
+            }
+
+            // Get tracked objects, and make a copy. As objects are freed, their tracker
+            // will be erased from the trackedObjects vector.
+            std::vector<ITracker*>& trackedObjects = trackersIt->second;
+            std::vector<ITracker*> oldTrackedObjects = trackedObjects;
+
+            size_t nInstances = trackedObjects.size();
+            if (nInstances == 0)
+            {
+                return;
+            }
+
+            std::vector<SwapInfo> swapInfos(nInstances);
+            std::vector<uint64_t> memoryIds(nInstances);
+
+            // Let the allocator know that all instances of this type are about to be reallocated.
+            IAllocator* pAllocator = ModuleSharedState::s_pAllocator;
+            if (pAllocator != nullptr)
+            {
+                pAllocator->Hscpp_BeginSwapBatch(key.c_str(), nInstances);
+            }
+
+            // Free the old objects; they will be swapped out with new instances.
+            for (size_t i = 0; i < nInstances; ++i)
+            {
+                swapInfos.at(i).m_Id = i;
+                swapInfos.at(i).m_Phase = SwapPhase::BeforeSwap;
+
+                ITracker* pTracker = oldTrackedObjects.at(i);
+
+                pTracker->CallSwapHandler(swapInfos.at(i));
+                memoryIds.at(i) = pTracker->FreeTrackedObject();
+            }
+
+            // Freeing the tracked objects should have also deleted their tracker, so this
+            // list should now be empty.
+            assert(trackedObjects.empty());
+
+            // Create new instances from the new constructors. These will have automatically
+            // registered themselves into the m_pTrackersByKey map.
+            for (size_t i = 0; i < nInstances; ++i)
+            {
+                pConstructor->AllocateSwap(memoryIds.at(i));
+
+                // After construction, a new tracker should have been added to trackedObjects.
+                ITracker* pTracker = trackedObjects.at(i);
+
+                swapInfos.at(i).m_Phase = SwapPhase::AfterSwap;
+                pTracker->CallSwapHandler(swapInfos.at(i));
+                swapInfos.at(i).TriggerInitCb();
+            }
+
+            if (pAllocator != nullptr)
+            {
+                pAllocator->Hscpp_EndSwapBatch();
+            }
+        }
     };
 }
 
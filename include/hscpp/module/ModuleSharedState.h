@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <string>
+#include <mutex>
 
 #include "hscpp/module/IAllocator.h"
 
@@ -19,6 +20,20 @@ namespace hscpp
         static std::unordered_map<std::string, std::vector<ITracker*>>* s_pTrackersByKey;
         static std::unordered_map<std::string, IConstructor*>* s_pConstructorsByKey;
         static IAllocator* s_pAllocator;
+
+        // Guards s_pTrackersByKey and s_pConstructorsByKey, so that tracked objects may be created
+        // and destroyed from multiple threads. Held for the duration of a runtime swap.
+        static std::recursive_mutex* s_pTrackersMutex;
+
+        static std::unique_lock<std::recursive_mutex> LockTrackers()
+        {
+            if (s_pTrackersMutex == nullptr)
+            {
+                return std::unique_lock<std::recursive_mutex>();
+            }
+
+            return std::unique_lock<std::recursive_mutex>(*s_pTrackersMutex);
+        }
     };
 
 }
@@ -57,6 +57,7 @@ namespace hscpp
 
             // Register self.
             const char* pKey = CompileTimeKey().ToString();
+            auto trackersLock = ModuleSharedState::LockTrackers();
             (*ModuleSharedState::s_pTrackersByKey)[pKey].push_back(this);
         }
 
@@ -64,6 +65,7 @@ namespace hscpp
         {
             // Unregister self.
             const char* pKey = CompileTimeKey().ToString();
+            auto trackersLock = ModuleSharedState::LockTrackers();
             std::vector<ITracker*>& trackers = (*ModuleSharedState::s_pTrackersByKey)[pKey];
 
             auto trackerIt = std::find(trackers.begin(), trackers.end(), this);
@@ -96,6 +98,11 @@ namespace hscpp
             }
         }
 
+        bool HasSwapHandler() override
+        {
+            return SwapHandler != nullptr;
+        }
+
         std::string GetKey() override
         {
             return CompileTimeKey().ToString();
@@ -62,6 +62,10 @@ namespace hscpp
         void Accept(IAstVisitor& visitor) const override;
 
         std::string path;
+
+        // Conditions of the enclosing #if blocks, all of which must hold for the include to be
+        // compiled.
+        std::vector<std::string> conditions;
     };
 
     struct HscppIfStmt : public Stmt
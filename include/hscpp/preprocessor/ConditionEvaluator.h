@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace hscpp
+{
+
+    // Evaluates the conditions of #if, #ifdef, and #elif directives against known macros. A macro
+    // is known if it was passed as a preprocessor definition, or if it identifies an operating
+    // system (ex. _WIN32, __linux__), in which case it is known whether or not it is defined on
+    // this platform. Any other macro may be defined in code, so conditions that depend on it, as
+    // well as those that cannot be parsed, evaluate to Unknown.
+    class ConditionEvaluator
+    {
+    public:
+        enum class Result
+        {
+            True,
+            False,
+            Unknown,
+        };
+
+        ConditionEvaluator();
+
+        // Definitions are of the form "NAME" or "NAME=VALUE", as passed to the compiler.
+        void SetDefinitions(const std::vector<std::string>& definitions);
+
+        Result Evaluate(const std::string& condition) const;
+
+        // String that uniquely identifies the definitions, in a stable order.
+        std::string GetKey() const;
+
+    private:
+        struct Value
+        {
+            bool bKnown = false;
+            int64_t value = 0;
+        };
+
+        struct State
+        {
+            std::vector<std::string> tokens;
+            size_t iToken = 0;
+            bool bError = false;
+        };
+
+        std::unordered_map<std::string, std::string> m_ValuesByMacro;
+        std::unordered_set<std::string> m_UndefinedMacros;
+
+        std::vector<std::string> m_Definitions;
+
+        Value ParseExpr(State& state, int precedence) const;
+        Value ParseUnaryExpr(State& state) const;
+        Value ParsePrimaryExpr(State& state) const;
+        Value ParseDefined(State& state) const;
+
+        Value GetMacroValue(const std::string& name) const;
+
+        static Value ApplyInfix(const std::string& op, const Value& lhs, const Value& rhs);
+
+        static bool Tokenize(const std::string& condition, std::vector<std::string>& tokens);
+        static int GetInfixPrecedence(const std::string& op);
+        static bool ParseNumber(const std::string& str, int64_t& value);
+
+        static bool IsIdentifierStart(char c);
+        static bool IsIdentifierChar(char c);
+    };
+
+}
@@ -3,8 +3,6 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
-#include <functional>
 
 #include "hscpp/Platform.h"
 #include "hscpp/FsPathHasher.h"
@@ -17,6 +15,16 @@ namespace hscpp
     public:
         std::vector<fs::path> ResolveGraph(const fs::path& filePath);
 
+        // Resolve the graph for several files in a single traversal. The result is the union of
+        // calling ResolveGraph on each file.
+        std::vector<fs::path> ResolveGraph(const std::vector<fs::path>& filePaths);
+
+        // Only compile dependents that include a class marked with HSCPP_TRACK, directly or through
+        // other headers. Other dependents have no effect after a swap, since the code already
+        // running keeps being used. Files resolved directly, and files linked to a compiled file
+        // by a module, are always compiled.
+        void SetCompileOnlyTrackedDependents(bool bCompileOnlyTrackedDependents);
+
         void SetLinkedModules(const fs::path& filePath, const std::vector<std::string>& modules);
         void SetFileDependencies(const fs::path& filePath, const std::vector<fs::path>& dependencies);
         void RemoveFile(const fs::path& filePath);
@@ -25,42 +33,75 @@ namespace hscpp
 
     private:
         // Map integers to filepaths to avoid storing a large number of duplicated paths, and to
-        // increase the speed of lookups.
+        // increase the speed of lookups. Handles are dense, so per-file data is stored in vectors
+        // indexed by handle. Edge lists are kept sorted.
         struct Node
         {
-            std::unordered_set<int> dependencyHandles;
-            std::unordered_set<int> dependentHandles;
+            std::vector<int> dependencyHandles;
+            std::vector<int> dependentHandles;
+            std::vector<int> moduleHandles;
+
+            bool bSourceFile = false;
         };
 
-        std::unordered_map<std::string, std::unordered_set<int>> m_HandlesByModule;
-        std::unordered_map<int, std::unordered_set<std::string>> m_ModulesByHandle;
+        // Edges packed in compressed sparse row form, so that traversal walks contiguous memory.
+        // The edges of handle i are edgeHandles[offsets[i]] up to edgeHandles[offsets[i + 1]].
+        struct CompressedEdges
+        {
+            std::vector<int> offsets;
+            std::vector<int> edgeHandles;
+        };
 
-        std::unordered_map<int, fs::path> m_FilePathByHandle;
+        // Collection state for one traversal, marking handles and modules in dense bitsets.
+        struct Traversal
+        {
+            std::vector<int> stack;
+            std::vector<bool> bCollected;
+            std::vector<bool> bCollectedModules;
+            std::vector<int> collectedHandles;
+
+            // Expand the modules of every collected file, rather than only those of files reached
+            // directly through an edge.
+            bool bExpandAllModules = false;
+        };
+
+        std::vector<Node> m_Nodes;
+        std::vector<fs::path> m_FilePathByHandle;
         std::unordered_map<fs::path, int, FsPathHasher> m_HandleByFilePath;
 
-        std::unordered_map<int, std::unique_ptr<Node>> m_NodeByHandle;
+        std::vector<std::vector<int>> m_HandlesByModuleHandle;
+        std::vector<bool> m_bTrackedModules;
+        std::unordered_map<std::string, int> m_ModuleHandleByModule;
 
-        int m_NextHandle = 0;
+        bool m_bCompileOnlyTrackedDependents = false;
 
-        void Collect(int handle, std::unordered_set<int>& collectedHandles, const std::function<void(Node*)>& cb);
-        void CollectDependencies(int handle, std::unordered_set<int>& collectedHandles);
-        void CollectDependents(int handle, std::unordered_set<int>& collectedHandles);
+        // Marks files that include a tracked class, rebuilt after the graph has been modified.
+        std::vector<bool> m_bIncludesTrackedClass;
+        bool m_bTrackedClassesStale = true;
 
-        bool IsModule(int handle);
-        std::vector<int> GetLinkedModuleHandles(int handle);
-        void RemoveLinkedModule(int handle);
+        // Rebuilt from m_Nodes on the next traversal after the graph has been modified.
+        CompressedEdges m_Dependencies;
+        CompressedEdges m_Dependents;
+        bool m_bCompressedEdgesStale = true;
 
-        int CreateHandle(const fs::path& filePath);
-        int GetHandle(const fs::path& filePath);
+        void Collect(const CompressedEdges& edges, Traversal& traversal);
+        void Visit(int handle, Traversal& traversal);
+        void Push(int handle, Traversal& traversal);
+        void ExpandModules(int handle, Traversal& traversal);
+        Traversal CreateTraversal(bool bExpandAllModules);
 
-        Node* CreateNode(const fs::path& filePath);
-        Node* CreateNode(int handle);
-        Node* GetNode(int handle);
+        void CompressEdges();
+        void FindTrackedClasses();
+        void CompressEdges(std::vector<int> Node::* pEdgeHandles, CompressedEdges& edges);
 
-        fs::path GetFilepath(int handle);
+        bool IsTracked(int handle);
 
-        std::unordered_set<int> AsHandleSet(const std::vector<fs::path>& paths);
+        void RemoveLinkedModule(int handle);
+        void RemoveDependencies(int handle);
+
+        int GetHandle(const fs::path& filePath);
+        int GetModuleHandle(const std::string& module);
 
     };
 
-}
\ No newline at end of file
+}
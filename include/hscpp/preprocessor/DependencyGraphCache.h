@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "hscpp/Platform.h"
+#include "hscpp/FsPathHasher.h"
+
+namespace hscpp
+{
+
+    // Remembers what each file contributed to the DependencyGraph, so that unchanged files need
+    // not be lexed, parsed, and interpreted again. Can be saved to disk, to speed up startup.
+    class DependencyGraphCache
+    {
+    public:
+        struct FileStamp
+        {
+            int64_t modificationTime = 0;
+            uint64_t size = 0;
+        };
+
+        struct Entry
+        {
+            FileStamp stamp;
+
+            std::vector<std::string> modules;
+            std::vector<std::string> includes;
+            std::vector<fs::path> includeDirectoryPaths;
+        };
+
+        // Loading fails if the file is missing, corrupt, or was saved with a different varsKey.
+        bool Load(const fs::path& cachePath, const std::string& varsKey);
+        bool Save(const fs::path& cachePath, const std::string& varsKey);
+
+        // Returns nullptr if there is no entry for the file, or if its stamp does not match.
+        const Entry* Find(const fs::path& filePath, const FileStamp& stamp) const;
+
+        void Set(const fs::path& filePath, const Entry& entry);
+        void Remove(const fs::path& filePath);
+        void Clear();
+
+        static bool GetFileStamp(const fs::path& filePath, FileStamp& stamp);
+
+    private:
+        std::unordered_map<fs::path, Entry, FsPathHasher> m_EntriesByPath;
+    };
+
+}
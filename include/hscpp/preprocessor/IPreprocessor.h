@@ -4,6 +4,7 @@
 #include <string>
 
 #include "hscpp/Platform.h"
+#include "hscpp/Util.h"
 #include "hscpp/preprocessor/Variant.h"
 
 namespace hscpp
@@ -28,10 +29,35 @@ namespace hscpp
         virtual void SetVar(const std::string& name, const Variant& val) = 0;
         virtual bool RemoveVar(const std::string& name) = 0;
 
+        // Definitions the module is compiled with, used to tell which conditionally compiled
+        // #includes take effect.
+        virtual void SetPreprocessorDefinitions(const std::vector<std::string>& /* definitions */) {}
+
         virtual void ClearDependencyGraph() = 0;
         virtual void UpdateDependencyGraph(const std::vector<fs::path>& canonicalModifiedFiles,
                 const std::vector<fs::path>& canonicalRemovedFiles,
                 const std::vector<fs::path>& includeDirectories) = 0;
+
+        // Source files that must be compiled when the given files change, as found by walking the
+        // dependency graph. Given files that are source files are included.
+        virtual std::vector<fs::path> ResolveDependencyGraph(const std::vector<fs::path>& canonicalFilePaths)
+        {
+            std::vector<fs::path> sourceFilePaths;
+            for (const auto& filePath : canonicalFilePaths)
+            {
+                if (util::IsSourceFile(filePath))
+                {
+                    sourceFilePaths.push_back(filePath);
+                }
+            }
+
+            return sourceFilePaths;
+        }
+
+        // Persist the information used to build the dependency graph, so that files unchanged
+        // since the last run need not be processed again.
+        virtual bool LoadDependencyGraphCache(const fs::path& /* cachePath */) { return false; }
+        virtual bool SaveDependencyGraphCache(const fs::path& /* cachePath */) { return false; }
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "hscpp/Platform.h"
+#include "hscpp/FsPathHasher.h"
+
+namespace hscpp
+{
+
+    // Memoizes which file an #include refers to within an include directory. Directories are
+    // listed once, rather than probing the filesystem for every include, in every directory.
+    // Misses are confirmed against the filesystem, as include directories may not be watched.
+    // Safe to call from multiple threads.
+    class IncludeResolver
+    {
+    public:
+        // Find include within includeDirectoryPath, returning false if it is not there.
+        bool Resolve(const fs::path& includeDirectoryPath, const std::string& include, fs::path& canonicalPath);
+
+        // Forget what is known about a file, after it was created, modified, or removed.
+        void Invalidate(const fs::path& canonicalFilePath, bool bExists);
+        void Clear();
+
+    private:
+        struct Resolution
+        {
+            bool bFound = false;
+            fs::path canonicalPath;
+        };
+
+        std::mutex m_Mutex;
+
+        // Keyed by include directory and include. Each key is also indexed by the include's file
+        // name, so that it can be invalidated when a file with that name changes.
+        std::unordered_map<std::string, Resolution> m_ResolutionsByKey;
+        std::unordered_map<std::string, std::vector<std::string>> m_KeysByFileName;
+
+        std::unordered_map<fs::path, fs::path, FsPathHasher> m_CanonicalDirectoryPaths;
+        std::unordered_map<fs::path, std::unordered_set<std::string>, FsPathHasher> m_NamesByDirectoryPath;
+
+        bool ResolveUncached(const fs::path& includeDirectoryPath, const fs::path& includePath, fs::path& canonicalPath);
+        bool GetCanonicalDirectoryPath(const fs::path& directoryPath, fs::path& canonicalDirectoryPath);
+        bool DirectoryContains(const fs::path& canonicalDirectoryPath, const std::string& name);
+
+        static std::string FoldName(const std::string& name);
+    };
+
+}
@@ -4,6 +4,7 @@
 #include <stack>
 
 #include "hscpp/preprocessor/Ast.h"
+#include "hscpp/preprocessor/ConditionEvaluator.h"
 #include "hscpp/preprocessor/HscppRequire.h"
 #include "hscpp/preprocessor/Variant.h"
 #include "hscpp/preprocessor/LangError.h"
@@ -24,6 +25,11 @@ namespace hscpp
         };
 
         bool Evaluate(const Stmt& rootStmt, const VarStore& varStore, Result& result);
+
+        // As above, but omit includes within #if blocks that conditionEvaluator determines are not
+        // compiled. Includes whose conditions cannot be evaluated are kept.
+        bool Evaluate(const Stmt& rootStmt, const VarStore& varStore,
+            const ConditionEvaluator& conditionEvaluator, Result& result);
         LangError GetLastError();
 
     private:
@@ -32,13 +38,15 @@ namespace hscpp
         {};
 
         const VarStore* m_pVarStore = nullptr;
+        const ConditionEvaluator* m_pConditionEvaluator = nullptr;
         Result* m_pResult = nullptr;
 
         LangError m_Error = LangError(LangError::Code::Success);
 
         std::stack<Variant> m_VariantStack;
 
-        void Reset(const VarStore& varStore, Result& result);
+        void Reset(const VarStore& varStore, const ConditionEvaluator* pConditionEvaluator, Result& result);
+        bool Evaluate(const Stmt& rootStmt);
 
         void Visit(const BlockStmt& blockStmt) override;
         void Visit(const IncludeStmt& includeStmt) override;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "hscpp/preprocessor/Token.h"
 #include "hscpp/preprocessor/LangError.h"
@@ -13,27 +14,46 @@ namespace hscpp
     {
     public:
         bool Lex(const std::string& content, std::vector<Token>& tokens);
+
+        // Lex only the tokens the Parser acts on: #includes, and hscpp statements along with their
+        // arguments. Other code is skipped over with a vectorized scan, which still honors comments
+        // and strings. Errors are reported as with Lex.
+        bool LexRelevant(const char* pContent, size_t size, std::vector<Token>& tokens);
+
         LangError GetLastError();
 
     private:
-        std::string m_Content;
+        const char* m_pContent = nullptr;
+        size_t m_ContentSize = 0;
         size_t m_iChar = 0;
         size_t m_Column = 0;
         size_t m_Line = 1;
 
         std::vector<Token>* m_pTokens = nullptr;
 
+        bool m_bRelevantOnly = false;
+        bool m_bInStatement = false;
+        int m_StatementDepth = 0;
+
         LangError m_Error = LangError(LangError::Code::Success);
 
-        void Reset(const std::string& content, std::vector<Token>& tokens);
+        void Reset(const char* pContent, size_t size, std::vector<Token>& tokens);
         bool Lex();
 
+        void SkipIrrelevant();
+        void SkipString(char endChar);
+        bool IsTokenStart(size_t iChar);
+
+        void LexConditionalDirective();
+        std::string LexDirectiveLine();
         void LexString(char endChar);
+        size_t FindStringEnd(char endChar, bool& bHasEscapes);
         void LexIdentifier();
         void LexNumber();
-        void PushToken(const std::string& value, Token::Type tokenType);
+        void PushToken(std::string value, Token::Type tokenType);
 
         bool Match(const std::string& str);
+        bool MatchWord(const std::string& str);
         void SkipWhitespace();
         void SkipComment();
 
@@ -44,6 +64,7 @@ namespace hscpp
         char Peek();
         char PeekNext();
         void Advance();
+        void AdvanceTo(size_t iChar);
 
         void ThrowError(const LangError& error);
     };
@@ -16,7 +16,16 @@ namespace hscpp
         LangError GetLastError();
 
     private:
+        // An #if block enclosing the current token, in which branchConditions are the conditions
+        // of the branches seen so far.
+        struct ConditionalBlock
+        {
+            std::vector<std::string> branchConditions;
+            bool bElse = false;
+        };
+
         std::stack<std::unique_ptr<BlockStmt>> m_Scopes;
+        std::vector<ConditionalBlock> m_ConditionalBlocks;
 
         const std::vector<Token>* m_pTokens = nullptr;
         size_t m_iToken = 0;
@@ -44,6 +53,7 @@ namespace hscpp
 
         std::unique_ptr<BlockStmt> ParseBlockStmt();
         std::unique_ptr<Stmt> ParseIncludeStmt();
+        void ParseConditionalDirective();
         std::unique_ptr<Stmt> ParseHscppIfStmt();
         std::unique_ptr<Stmt> ParseHscppReturnStmt();
         std::unique_ptr<Stmt> ParseHscppRequireStmt();
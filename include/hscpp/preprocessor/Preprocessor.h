@@ -1,9 +1,15 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <functional>
 #include <unordered_set>
 
 #include "hscpp/preprocessor/IPreprocessor.h"
+#include "hscpp/preprocessor/ConditionEvaluator.h"
 #include "hscpp/preprocessor/DependencyGraph.h"
+#include "hscpp/preprocessor/DependencyGraphCache.h"
+#include "hscpp/preprocessor/IncludeResolver.h"
 #include "hscpp/preprocessor/VarStore.h"
 #include "hscpp/preprocessor/Token.h"
 #include "hscpp/preprocessor/Lexer.h"
@@ -12,6 +18,7 @@
 #include "hscpp/preprocessor/HscppRequire.h"
 #include "hscpp/preprocessor/Variant.h"
 #include "hscpp/FsPathHasher.h"
+#include "hscpp/Config.h"
 
 namespace hscpp
 {
@@ -19,26 +26,58 @@ namespace hscpp
     class Preprocessor : public IPreprocessor
     {
     public:
+        Preprocessor();
+        explicit Preprocessor(const PreprocessorConfig& config);
+
         bool Preprocess(const std::vector<fs::path>& canonicalFilePaths, Output& output) override;
 
         void SetVar(const std::string& name, const Variant& value) override;
         bool RemoveVar(const std::string& name) override;
 
+        void SetPreprocessorDefinitions(const std::vector<std::string>& definitions) override;
+
         void ClearDependencyGraph() override;
         void UpdateDependencyGraph(const std::vector<fs::path>& canonicalModifiedFilePaths,
                 const std::vector<fs::path>& canonicalRemovedFilePaths,
                 const std::vector<fs::path>& includeDirectoryPaths) override;
+        std::vector<fs::path> ResolveDependencyGraph(const std::vector<fs::path>& canonicalFilePaths) override;
+
+        bool LoadDependencyGraphCache(const fs::path& cachePath) override;
+        bool SaveDependencyGraphCache(const fs::path& cachePath) override;
 
         bool FormCanonical(const fs::path& sourceFilePath, const std::string& value, fs::path & canonicalPath);
 
     private:
-        std::vector<Token> m_Tokens;
-
-        Lexer m_Lexer;
-        Parser m_Parser;
-        Interpreter m_Interpreter;
+        // Each thread processes files with its own Worker. The first is used by the calling thread.
+        struct Worker
+        {
+            std::string buffer;
+            std::vector<Token> tokens;
+
+            Lexer lexer;
+            Parser parser;
+            Interpreter interpreter;
+        };
+
+        // Result of processing a file, which is reused while the file's content and the variables
+        // are unchanged.
+        struct CachedResult
+        {
+            uint64_t contentHash = 0;
+            uint64_t varsVersion = 0;
+            Interpreter::Result result;
+        };
+
+        PreprocessorConfig m_Config;
+        std::vector<std::unique_ptr<Worker>> m_Workers;
 
         DependencyGraph m_DependencyGraph;
+        DependencyGraphCache m_DependencyGraphCache;
+        IncludeResolver m_IncludeResolver;
+        ConditionEvaluator m_ConditionEvaluator;
+
+        std::mutex m_CachedResultsMutex;
+        std::unordered_map<fs::path, CachedResult, FsPathHasher> m_CachedResultsByPath;
         VarStore m_VarStore;
 
         std::unordered_set<fs::path, FsPathHasher> m_SourceFilePaths;
@@ -50,10 +89,20 @@ namespace hscpp
         void Reset(Output& output);
         void CreateOutput(Output& output);
 
+        std::string GetDependencyGraphCacheKey();
+
+        bool CreateDependencyGraphEntry(Worker& worker, const fs::path& filePath,
+                DependencyGraphCache::Entry& entry);
+        std::vector<fs::path> ResolveIncludes(const fs::path& filePath,
+                const DependencyGraphCache::Entry& entry,
+                const std::vector<fs::path>& includeDirectoryPaths);
+
+        void ForEachFile(size_t nFiles, const std::function<void(Worker& worker, size_t iFile)>& cb);
+
         void AddDependentFilePaths(std::unordered_set<fs::path, FsPathHasher>& filePaths);
 
         bool Preprocess(const std::unordered_set<fs::path, FsPathHasher>& filePaths);
-        bool Process(const fs::path& filePath, Interpreter::Result& result);
+        bool Process(Worker& worker, const fs::path& filePath, Interpreter::Result& result);
 
         bool AddHscppRequire(const fs::path& sourceFilePath, const HscppRequire& hscppRequire);
     };
@@ -36,6 +36,10 @@ namespace hscpp
             Bool,
 
             Include,
+            If,                 // #if, #ifdef, #ifndef
+            Elif,               // #elif, #elifdef, #elifndef
+            Else,               // #else
+            Endif,              // #endif
 
             HscppRequireSource,
             HscppRequireIncludeDir,
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -18,8 +19,15 @@ namespace hscpp
 
         std::string Interpolate(const std::string& str) const;
 
+        // String that uniquely identifies the variables and their values, in a stable order.
+        std::string GetKey() const;
+
+        // Incremented whenever a variable is set or removed.
+        uint64_t GetVersion() const;
+
     private:
         std::unordered_map<std::string, Variant> m_Vars;
+        uint64_t m_Version = 0;
     };
 
 }
\ No newline at end of file
@@ -61,6 +61,11 @@ namespace hscpp
         return true;
     }
 
+    std::vector<Hotswapper::CompileCost> Hotswapper::QueryRebuildImpact(const fs::path&)
+    {
+        return {};
+    }
+
     void Hotswapper::SetCallbacks(const Callbacks&)
     {}
 
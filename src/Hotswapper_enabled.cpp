@@ -29,6 +29,7 @@ namespace hscpp
                            std::unique_ptr<ICompiler> pCompiler,
                            std::unique_ptr<IPreprocessor> pPreprocessor)
        : m_pConfig(std::move(pConfig))
+       , m_AllocationResolver(&m_ModuleManager)
     {
         if (pFileWatcher != nullptr)
         {
@@ -54,7 +55,7 @@ namespace hscpp
         }
         else
         {
-            m_pPreprocessor = std::unique_ptr<IPreprocessor>(new Preprocessor());
+            m_pPreprocessor = std::unique_ptr<IPreprocessor>(new Preprocessor(m_pConfig->preprocessor));
         }
 
         if (!(m_pConfig->flags & Config::Flag::NoDefaultCompileOptions))
@@ -134,6 +135,7 @@ namespace hscpp
 
                     if (m_pCompiler->HasCompiledModule())
                     {
+                        RecordCompileDurations();
                         PerformRuntimeSwap();
                     }
                 }
@@ -158,6 +160,9 @@ namespace hscpp
 
         if (m_pCompiler->HasCompiledModule())
         {
+            m_CompilingFilePaths.clear();
+            RecordCompileDurations();
+
             if (PerformRuntimeSwap())
             {
                 return UpdateResult::PerformedSwap;
@@ -168,9 +173,23 @@ namespace hscpp
             }
         }
 
+        if (!m_CompilingFilePaths.empty())
+        {
+            // The last compile failed.
+            InvalidateFileHashes(m_CompilingFilePaths);
+            m_CompilingFilePaths.clear();
+        }
+
         if (!IsFeatureEnabled(Feature::ManualCompilationOnly))
         {
             m_pFileWatcher->PollChanges(m_FileEvents);
+
+            // Dropped events never reach the dependency graph, so unchanged headers do not
+            // trigger compilation of their dependents.
+            m_FileHashCache.SetHashMode(IsFeatureEnabled(Feature::IgnoreCommentAndWhitespaceChanges)
+                ? FileHashCache::HashMode::Tokens
+                : FileHashCache::HashMode::Content);
+            m_FileHashCache.RemoveUnchangedEvents(m_FileEvents);
         }
 
         if (!m_FileEvents.empty())
@@ -190,9 +209,12 @@ namespace hscpp
                     {
                         if (StartCompile(compilerInput))
                         {
+                            m_CompilingFilePaths = canonicalModifiedFilePaths;
                             return UpdateResult::StartedCompiling;
                         }
                     }
+
+                    InvalidateFileHashes(canonicalModifiedFilePaths);
                 }
             }
         }
@@ -210,6 +232,56 @@ namespace hscpp
         return m_pCompiler->IsInitialized();
     }
 
+    std::vector<Hotswapper::CompileCost> Hotswapper::QueryRebuildImpact(const fs::path& filePath)
+    {
+        std::error_code error;
+        fs::path canonicalFilePath = fs::canonical(filePath, error);
+
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to get canonical path of "
+                << filePath << ". " << log::OsError(error) << log::End();
+            return {};
+        }
+
+        if (m_bDependencyGraphNeedsRefresh)
+        {
+            RefreshDependencyGraph();
+        }
+
+        std::vector<fs::path> sourceFilePaths;
+        if (IsFeatureEnabled(Feature::DependentCompilation))
+        {
+            sourceFilePaths = m_pPreprocessor->ResolveDependencyGraph({ canonicalFilePath });
+        }
+        else if (util::IsSourceFile(canonicalFilePath))
+        {
+            sourceFilePaths.push_back(canonicalFilePath);
+        }
+
+        std::vector<CompileCost> costs;
+        for (const auto& sourceFilePath : sourceFilePaths)
+        {
+            CompileCost cost;
+            cost.sourceFilePath = sourceFilePath;
+
+            auto it = m_CompileDurationsByFilePath.find(sourceFilePath);
+            if (it != m_CompileDurationsByFilePath.end())
+            {
+                cost.bMeasured = true;
+                cost.lastCompileDuration = it->second;
+            }
+
+            costs.push_back(cost);
+        }
+
+        std::stable_sort(costs.begin(), costs.end(), [](const CompileCost& lhs, const CompileCost& rhs){
+            return lhs.lastCompileDuration > rhs.lastCompileDuration;
+        });
+
+        return costs;
+    }
+
     void Hotswapper::SetCallbacks(const Callbacks& callbacks)
     {
         m_Callbacks = callbacks;
@@ -276,6 +348,8 @@ namespace hscpp
         m_bDependencyGraphNeedsRefresh = true;
 
         m_pFileWatcher->AddWatch(directoryPath);
+        m_FileHashCache.AddDirectory(directoryPath, m_pConfig->fileWatcher);
+
         return Add(directoryPath, m_NextSourceDirectoryHandle, m_SourceDirectoryPathsByHandle);
     }
 
@@ -285,6 +359,7 @@ namespace hscpp
         if (it != m_SourceDirectoryPathsByHandle.end())
         {
             m_pFileWatcher->RemoveWatch(it->second);
+            m_FileHashCache.RemoveDirectory(it->second);
         }
 
         bool bRemoved = Remove(handle, m_SourceDirectoryPathsByHandle);
@@ -304,6 +379,7 @@ namespace hscpp
     void Hotswapper::ClearSourceDirectories()
     {
         m_SourceDirectoryPathsByHandle.clear();
+        m_FileHashCache.Clear();
     }
 
     int Hotswapper::AddForceCompiledSourceFile(const fs::path& filePath)
@@ -375,12 +451,20 @@ namespace hscpp
 
     int Hotswapper::AddPreprocessorDefinition(const std::string& definition)
     {
+        // Definitions decide which conditionally compiled #includes are dependencies.
+        m_bDependencyGraphNeedsRefresh = true;
         return Add(definition, m_NextPreprocessorDefinitionHandle, m_PreprocessorDefinitionsByHandle);
     }
 
     bool Hotswapper::RemovePreprocessorDefinition(int handle)
     {
-        return Remove(handle, m_PreprocessorDefinitionsByHandle);
+        bool bRemoved = Remove(handle, m_PreprocessorDefinitionsByHandle);
+        if (bRemoved)
+        {
+            m_bDependencyGraphNeedsRefresh = true;
+        }
+
+        return bRemoved;
     }
 
     void Hotswapper::EnumeratePreprocessorDefinitions(const std::function<void(int handle, const std::string& definition)>& cb)
@@ -390,6 +474,7 @@ namespace hscpp
 
     void Hotswapper::ClearPreprocessorDefinitions()
     {
+        m_bDependencyGraphNeedsRefresh = true;
         m_PreprocessorDefinitionsByHandle.clear();
     }
 
@@ -471,6 +556,9 @@ namespace hscpp
         {
             if (m_pCompiler->StartBuild(compilerInput))
             {
+                m_CompilingSourceFilePaths = compilerInput.sourceFilePaths;
+                m_CompileStartTime = std::chrono::steady_clock::now();
+
                 return true;
             }
         }
@@ -623,6 +711,36 @@ namespace hscpp
         return true;
     }
 
+    void Hotswapper::InvalidateFileHashes(const std::vector<fs::path>& filePaths)
+    {
+        for (const auto& filePath : filePaths)
+        {
+            m_FileHashCache.Invalidate(filePath);
+        }
+    }
+
+    void Hotswapper::RecordCompileDurations()
+    {
+        if (m_CompilingSourceFilePaths.empty())
+        {
+            return;
+        }
+
+        // All source files are built by a single compiler invocation, so their individual compile
+        // times are unknown. Split the build time evenly between them. A file that is saved on its
+        // own is then measured individually.
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - m_CompileStartTime);
+        auto durationPerFile = duration / static_cast<int>(m_CompilingSourceFilePaths.size());
+
+        for (const auto& sourceFilePath : m_CompilingSourceFilePaths)
+        {
+            m_CompileDurationsByFilePath[sourceFilePath] = durationPerFile;
+        }
+
+        m_CompilingSourceFilePaths.clear();
+    }
+
     void Hotswapper::UpdateDependencyGraph(const std::vector<fs::path>& canonicalModifiedFilePaths,
             const std::vector<fs::path>& canonicalRemovedFilePaths)
     {
@@ -630,6 +748,8 @@ namespace hscpp
         {
             m_pPreprocessor->UpdateDependencyGraph(canonicalModifiedFilePaths, canonicalRemovedFilePaths,
                     AsVector(m_IncludeDirectoryPathsByHandle));
+
+            SaveDependencyGraphCache();
         }
     }
 
@@ -638,6 +758,14 @@ namespace hscpp
         if (IsFeatureEnabled(Feature::DependentCompilation))
         {
             m_pPreprocessor->ClearDependencyGraph();
+            m_pPreprocessor->SetPreprocessorDefinitions(AsVector(m_PreprocessorDefinitionsByHandle));
+
+            // Files unchanged since the cache was saved will not need to be processed again.
+            if (!m_bDependencyGraphCacheLoaded && !m_pConfig->dependencyGraphCachePath.empty())
+            {
+                m_pPreprocessor->LoadDependencyGraphCache(m_pConfig->dependencyGraphCachePath);
+                m_bDependencyGraphCacheLoaded = true;
+            }
 
             // Header and source directories may overlap, so collect unique files using a set.
             std::unordered_set<fs::path, FsPathHasher> uniqueSourceFilePaths;
@@ -655,9 +783,19 @@ namespace hscpp
             m_pPreprocessor->UpdateDependencyGraph(
                     std::vector<fs::path>(uniqueSourceFilePaths.begin(), uniqueSourceFilePaths.end()),
                     {}, AsVector(m_IncludeDirectoryPathsByHandle));
+
+            SaveDependencyGraphCache();
         }
 
         m_bDependencyGraphNeedsRefresh = false;
     }
 
+    void Hotswapper::SaveDependencyGraphCache()
+    {
+        if (!m_pConfig->dependencyGraphCachePath.empty())
+        {
+            m_pPreprocessor->SaveDependencyGraphCache(m_pConfig->dependencyGraphCachePath);
+        }
+    }
+
 }
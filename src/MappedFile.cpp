@@ -0,0 +1,166 @@
+#include "hscpp/MappedFile.h"
+#include "hscpp/Log.h"
+
+#if defined(HSCPP_PLATFORM_UNIX)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace hscpp
+{
+
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+#if defined(HSCPP_PLATFORM_WIN32)
+
+    bool MappedFile::Open(const fs::path& filePath)
+    {
+        Close();
+
+        m_hFile = CreateFileW(filePath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_hFile == INVALID_HANDLE_VALUE)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to open file "
+                << filePath << ". " << log::LastOsError() << log::End();
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_hFile, &size))
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to get size of file "
+                << filePath << ". " << log::LastOsError() << log::End();
+            Close();
+            return false;
+        }
+
+        m_Size = static_cast<size_t>(size.QuadPart);
+        if (m_Size == 0)
+        {
+            // Empty files cannot be mapped.
+            return true;
+        }
+
+        m_hMapping = CreateFileMappingW(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_hMapping == NULL)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to map file "
+                << filePath << ". " << log::LastOsError() << log::End();
+            Close();
+            return false;
+        }
+
+        m_pData = static_cast<const char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_pData == nullptr)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to map view of file "
+                << filePath << ". " << log::LastOsError() << log::End();
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_pData != nullptr)
+        {
+            UnmapViewOfFile(m_pData);
+        }
+
+        if (m_hMapping != NULL)
+        {
+            CloseHandle(m_hMapping);
+        }
+
+        if (m_hFile != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_hFile);
+        }
+
+        m_pData = nullptr;
+        m_Size = 0;
+        m_hMapping = NULL;
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+
+#elif defined(HSCPP_PLATFORM_UNIX)
+
+    bool MappedFile::Open(const fs::path& filePath)
+    {
+        Close();
+
+        int fd = open(filePath.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to open file "
+                << filePath << ". " << log::LastOsError() << log::End();
+            return false;
+        }
+
+        struct stat fileStat = {};
+        if (fstat(fd, &fileStat) == -1)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to get size of file "
+                << filePath << ". " << log::LastOsError() << log::End();
+            close(fd);
+            return false;
+        }
+
+        size_t size = static_cast<size_t>(fileStat.st_size);
+        if (size == 0)
+        {
+            // Empty files cannot be mapped.
+            close(fd);
+            return true;
+        }
+
+        void* pData = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // The mapping remains valid once the descriptor is closed.
+        close(fd);
+
+        if (pData == MAP_FAILED)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to map file "
+                << filePath << ". " << log::LastOsError() << log::End();
+            return false;
+        }
+
+        m_pData = static_cast<const char*>(pData);
+        m_Size = size;
+
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (m_pData != nullptr)
+        {
+            munmap(const_cast<char*>(m_pData), m_Size);
+        }
+
+        m_pData = nullptr;
+        m_Size = 0;
+    }
+
+#endif
+
+    const char* MappedFile::GetData() const
+    {
+        return m_pData;
+    }
+
+    size_t MappedFile::GetSize() const
+    {
+        return m_Size;
+    }
+
+}
@@ -7,6 +7,7 @@ hscpp::ModuleManager::ModuleManager()
 {
     Hscpp_GetModuleInterface()->SetIsSwapping(&m_bSwapping);
     Hscpp_GetModuleInterface()->SetTrackersByKey(&m_TrackersByKey);
+    Hscpp_GetModuleInterface()->SetTrackersMutex(&m_TrackersMutex);
     Hscpp_GetModuleInterface()->SetConstructorsByKey(&m_ConstructorsByKey);
 
     m_ConstructorsByKey = Hscpp_GetModuleInterface()->GetModuleConstructorsByKey();
@@ -53,6 +54,7 @@ bool hscpp::ModuleManager::PerformRuntimeSwap(const fs::path& modulePath)
 
     pModuleInterface->SetIsSwapping(&m_bSwapping);
     pModuleInterface->SetTrackersByKey(&m_TrackersByKey);
+    pModuleInterface->SetTrackersMutex(&m_TrackersMutex);
     pModuleInterface->SetConstructorsByKey(&m_ConstructorsByKey);
     pModuleInterface->SetAllocator(m_pAllocator);
     pModuleInterface->SetGlobalUserData(m_pGlobalUserData);
@@ -65,6 +67,17 @@ bool hscpp::ModuleManager::PerformRuntimeSwap(const fs::path& modulePath)
     return true;
 }
 
+void hscpp::ModuleManager::RebuildTrackedObjects(const std::string& key)
+{
+    // Swapping uses the latest constructors, which are shared by every loaded module.
+    Hscpp_GetModuleInterface()->RebuildTrackedObjects(key);
+}
+
+std::vector<std::string> hscpp::ModuleManager::GetTrackedKeys(bool bRequireSwapHandler)
+{
+    return Hscpp_GetModuleInterface()->GetTrackedKeys(bRequireSwapHandler);
+}
+
 void hscpp::ModuleManager::WarnDuplicateKeys(ModuleInterface* pModuleInterface)
 {
     auto duplicateKeys = pModuleInterface->GetDuplicateKeys();
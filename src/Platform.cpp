@@ -22,6 +22,9 @@
     #include "hscpp/cmd-shell/CmdShell_unix.h"
 #endif
 
+// Polling file watcher is cross-platform.
+#include "hscpp/file-watcher/PollingFileWatcher.h"
+
 // Compiler and GCC interface is cross-platform. MSVC interface is Win32-only.
 #include "hscpp/compiler/Compiler.h"
 #include "hscpp/compiler/CompilerInitializeTask_gcc.h"
@@ -41,6 +44,11 @@ namespace hscpp { namespace platform
 
     std::unique_ptr<IFileWatcher> CreateFileWatcher(FileWatcherConfig* pConfig)
     {
+        if (pConfig->bUsePolling)
+        {
+            return std::unique_ptr<IFileWatcher>(new PollingFileWatcher(pConfig));
+        }
+
         return std::unique_ptr<IFileWatcher>(new FileWatcher(pConfig));
     }
 
@@ -184,10 +192,17 @@ namespace hscpp { namespace platform
     std::vector<std::string> GetDefaultPreprocessorDefinitions()
     {
 #if defined(HSCPP_PLATFORM_WIN32)
-        return GetDefaultPreprocessorDefinitions_win32();
+        std::vector<std::string> definitions = GetDefaultPreprocessorDefinitions_win32();
 #else
-        return {};
+        std::vector<std::string> definitions;
 #endif
+
+#ifdef HSCPP_MEM_DISABLE_REF_CHECKS
+        // Ref dereferencing is inlined, and must match between the program and its modules.
+        definitions.push_back("HSCPP_MEM_DISABLE_REF_CHECKS");
+#endif
+
+        return definitions;
     }
 
     //============================================================================
@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <array>
 #include <unordered_set>
+#include <unordered_map>
 
 #include "hscpp/Util.h"
 #include "hscpp/Log.h"
@@ -135,17 +136,23 @@ namespace hscpp { namespace util
         canonicalModifiedFilePaths.clear();
         canonicalRemovedFilePaths.clear();
 
-        // A file may have duplicate events, compress these into a single event.
-        std::unordered_set<fs::path, FsPathHasher> dedupedModifiedFilePaths;
-        std::unordered_set<fs::path, FsPathHasher> dedupedRemovedFilePaths;
+        // A file may have several events, compress these into a single event. Later events take
+        // precedence, as with a temporary file that is created and then removed while saving.
+        std::unordered_map<fs::path, bool, FsPathHasher> bExistsByCanonicalFilePath;
+
+        auto GetCanonicalFilePath = [](const IFileWatcher::Event& event, const fs::path& filePath,
+                fs::path& canonicalFilePath) {
+            if (event.bCanonical)
+            {
+                canonicalFilePath = filePath;
+                return true;
+            }
 
-        for (const auto& event : events)
-        {
             // If the file was removed, we cannot get its canonical filename through the relative
             // filename. However, we can get the canonical path of its parent directory, and use
             // that to construct the canonical path of the file.
             std::error_code error;
-            fs::path directoryPath = event.filePath.parent_path();
+            fs::path directoryPath = filePath.parent_path();
             fs::path canonicalDirectoryPath = fs::canonical(directoryPath, error);
 
             if (error.value() == HSCPP_ERROR_FILE_NOT_FOUND)
@@ -153,32 +160,73 @@ namespace hscpp { namespace util
                 // Entire directory was removed. Hscpp does not support this use case.
                 log::Warning() << "Directory " << directoryPath << " was removed; hscpp does not support "
                     << "removing directories at runtime." << log::End();
-                continue;
+                return false;
             }
 
             // Construct the canonical path of the file. Note that this also works for deleted files.
-            fs::path canonicalFilePath = canonicalDirectoryPath / event.filePath.filename();
+            canonicalFilePath = canonicalDirectoryPath / filePath.filename();
+            return true;
+        };
+
+        for (const auto& event : events)
+        {
+            fs::path canonicalFilePath;
+            if (!GetCanonicalFilePath(event, event.filePath, canonicalFilePath))
+            {
+                continue;
+            }
 
-            if (fs::exists(canonicalFilePath))
+            switch (event.type)
             {
-                // Make sure this isn't a directory.
-                if (fs::is_regular_file(canonicalFilePath))
+                case IFileWatcher::Event::Type::Unknown:
+                    // The watcher did not say what happened, so check the file on disk.
+                    if (fs::exists(canonicalFilePath))
+                    {
+                        // Make sure this isn't a directory.
+                        if (fs::is_regular_file(canonicalFilePath))
+                        {
+                            // Had a file event and the file exists; it must have been added or modified.
+                            bExistsByCanonicalFilePath[canonicalFilePath] = true;
+                        }
+                    }
+                    else
+                    {
+                        // Had a file event and the file no longer exists; it must have been deleted.
+                        bExistsByCanonicalFilePath[canonicalFilePath] = false;
+                    }
+                    break;
+                case IFileWatcher::Event::Type::Created:
+                case IFileWatcher::Event::Type::Modified:
+                    bExistsByCanonicalFilePath[canonicalFilePath] = true;
+                    break;
+                case IFileWatcher::Event::Type::Removed:
+                    bExistsByCanonicalFilePath[canonicalFilePath] = false;
+                    break;
+                case IFileWatcher::Event::Type::Renamed:
                 {
-                    // Had a file event and the file exists; it must have been added or modified.
-                    dedupedModifiedFilePaths.insert(canonicalFilePath);
+                    fs::path canonicalOldFilePath;
+                    if (GetCanonicalFilePath(event, event.oldFilePath, canonicalOldFilePath))
+                    {
+                        bExistsByCanonicalFilePath[canonicalOldFilePath] = false;
+                    }
+
+                    bExistsByCanonicalFilePath[canonicalFilePath] = true;
+                    break;
                 }
             }
+        }
+
+        for (const auto& filePath__bExists : bExistsByCanonicalFilePath)
+        {
+            if (filePath__bExists.second)
+            {
+                canonicalModifiedFilePaths.push_back(filePath__bExists.first);
+            }
             else
             {
-                // Had a file event and the file no longer exists; it must have been deleted.
-                dedupedRemovedFilePaths.insert(canonicalFilePath);
+                canonicalRemovedFilePaths.push_back(filePath__bExists.first);
             }
         }
-
-        canonicalModifiedFilePaths = std::vector<fs::path>(
-                dedupedModifiedFilePaths.begin(), dedupedModifiedFilePaths.end());
-        canonicalRemovedFilePaths = std::vector<fs::path>(
-                dedupedRemovedFilePaths.begin(), dedupedRemovedFilePaths.end());
     }
 
     fs::path FindFile(const fs::path& rootPath, const fs::path& name)
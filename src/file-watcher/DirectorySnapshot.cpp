@@ -0,0 +1,280 @@
+#if defined(HSCPP_PLATFORM_UNIX)
+    #include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <thread>
+
+#include "hscpp/file-watcher/DirectorySnapshot.h"
+#include "hscpp/Log.h"
+
+namespace hscpp
+{
+
+    // Spawning a thread is not worth it for fewer files than this.
+    const static size_t MIN_FILES_PER_THREAD = 512;
+
+    bool DirectorySnapshot::Scan(const fs::path& directoryPath, const FileWatcherConfig& config)
+    {
+        m_DirectoryPath = directoryPath.native();
+        m_Files.clear();
+
+        std::vector<fs::path> directoryPaths = { directoryPath };
+        while (!directoryPaths.empty())
+        {
+            fs::path currentPath = directoryPaths.back();
+            directoryPaths.pop_back();
+
+            std::error_code error;
+            fs::directory_iterator directoryIt(currentPath, error);
+            if (error.value() != HSCPP_ERROR_SUCCESS)
+            {
+                if (currentPath == directoryPath)
+                {
+                    log::Error() << HSCPP_LOG_PREFIX << "Failed to scan directory "
+                        << directoryPath << ". " << log::OsError(error) << log::End();
+                    return false;
+                }
+
+                // Subdirectory was removed during the scan.
+                continue;
+            }
+
+            for (; directoryIt != fs::directory_iterator(); directoryIt.increment(error))
+            {
+                if (error.value() != HSCPP_ERROR_SUCCESS)
+                {
+                    break;
+                }
+
+                const fs::directory_entry& entry = *directoryIt;
+                if (!entry.is_symlink(error) && entry.is_directory(error))
+                {
+                    const std::vector<std::string>& ignoredNames = config.ignoredDirectoryNames;
+                    bool bIgnored = std::find(ignoredNames.begin(), ignoredNames.end(),
+                        entry.path().filename().u8string()) != ignoredNames.end();
+
+                    if (config.bRecursive && !bIgnored)
+                    {
+                        directoryPaths.push_back(entry.path());
+                    }
+
+                    continue;
+                }
+
+                FileEntry fileEntry;
+                fileEntry.path = entry.path().native();
+                m_Files.push_back(std::move(fileEntry));
+            }
+        }
+
+        size_t nThreads = config.nPollingThreads;
+        if (nThreads == 0)
+        {
+            nThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        StatFiles(m_Files, nThreads);
+
+        std::sort(m_Files.begin(), m_Files.end(), [](const FileEntry& lhs, const FileEntry& rhs) {
+            return lhs.path < rhs.path;
+        });
+
+        return true;
+    }
+
+    void DirectorySnapshot::Diff(const DirectorySnapshot& previous, std::vector<IFileWatcher::Event>& events) const
+    {
+        auto time = std::chrono::steady_clock::now();
+
+        auto AddEvent = [&events, time](const FileEntry& entry, IFileWatcher::Event::Type type) {
+            IFileWatcher::Event event;
+            event.type = type;
+            event.filePath = fs::path(entry.path);
+            event.time = time;
+            events.push_back(event);
+        };
+
+        // Both snapshots are sorted, so walk them side by side.
+        auto currentIt = m_Files.begin();
+        auto previousIt = previous.m_Files.begin();
+
+        while (currentIt != m_Files.end() || previousIt != previous.m_Files.end())
+        {
+            if (previousIt == previous.m_Files.end()
+                || (currentIt != m_Files.end() && currentIt->path < previousIt->path))
+            {
+                AddEvent(*currentIt, IFileWatcher::Event::Type::Created);
+                ++currentIt;
+            }
+            else if (currentIt == m_Files.end() || previousIt->path < currentIt->path)
+            {
+                AddEvent(*previousIt, IFileWatcher::Event::Type::Removed);
+                ++previousIt;
+            }
+            else
+            {
+                if (currentIt->modificationTime != previousIt->modificationTime
+                    || currentIt->size != previousIt->size
+                    || currentIt->inode != previousIt->inode)
+                {
+                    AddEvent(*currentIt, IFileWatcher::Event::Type::Modified);
+                }
+
+                ++currentIt;
+                ++previousIt;
+            }
+        }
+    }
+
+    void DirectorySnapshot::Update(const std::vector<IFileWatcher::Event>& events)
+    {
+        for (const auto& event : events)
+        {
+            if (event.type == IFileWatcher::Event::Type::Renamed)
+            {
+                UpdateFile(event.oldFilePath);
+            }
+
+            UpdateFile(event.filePath);
+        }
+    }
+
+    size_t DirectorySnapshot::GetFileCount() const
+    {
+        return m_Files.size();
+    }
+
+    void DirectorySnapshot::UpdateFile(const fs::path& filePath)
+    {
+        FileEntry entry;
+        entry.path = filePath.native();
+
+        bool bWithinDirectory = entry.path.size() > m_DirectoryPath.size()
+            && entry.path.compare(0, m_DirectoryPath.size(), m_DirectoryPath) == 0
+            && entry.path[m_DirectoryPath.size()] == fs::path::preferred_separator;
+
+        if (!bWithinDirectory)
+        {
+            return;
+        }
+
+        auto entryIt = std::lower_bound(m_Files.begin(), m_Files.end(), entry,
+            [](const FileEntry& lhs, const FileEntry& rhs) {
+                return lhs.path < rhs.path;
+            });
+
+        bool bRecorded = entryIt != m_Files.end() && entryIt->path == entry.path;
+
+        // A file that cannot be stat'ed has been removed.
+        if (StatFile(entry))
+        {
+            if (bRecorded)
+            {
+                *entryIt = std::move(entry);
+            }
+            else
+            {
+                m_Files.insert(entryIt, std::move(entry));
+            }
+        }
+        else if (bRecorded)
+        {
+            m_Files.erase(entryIt);
+        }
+    }
+
+    bool DirectorySnapshot::StatFile(FileEntry& entry)
+    {
+#if defined(HSCPP_PLATFORM_UNIX)
+        struct stat fileStat;
+        if (stat(entry.path.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+        {
+            return false;
+        }
+
+    #if defined(HSCPP_PLATFORM_APPLE)
+        const struct timespec& modificationTime = fileStat.st_mtimespec;
+    #else
+        const struct timespec& modificationTime = fileStat.st_mtim;
+    #endif
+
+        entry.modificationTime = static_cast<int64_t>(modificationTime.tv_sec) * 1000000000
+            + modificationTime.tv_nsec;
+        entry.size = static_cast<uint64_t>(fileStat.st_size);
+        entry.inode = static_cast<uint64_t>(fileStat.st_ino);
+#else
+        fs::path filePath(entry.path);
+
+        std::error_code error;
+        if (!fs::is_regular_file(filePath, error))
+        {
+            return false;
+        }
+
+        auto modificationTime = fs::last_write_time(filePath, error);
+        uint64_t size = fs::file_size(filePath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            return false;
+        }
+
+        entry.modificationTime = static_cast<int64_t>(modificationTime.time_since_epoch().count());
+        entry.size = size;
+        entry.inode = 0;
+#endif
+
+        return true;
+    }
+
+    void DirectorySnapshot::StatFiles(std::vector<FileEntry>& files, size_t nThreads)
+    {
+        nThreads = std::max<size_t>(1, std::min(nThreads, files.size() / MIN_FILES_PER_THREAD));
+
+        // Entries that could not be stat'ed, such as directories reached through symlinks or
+        // files removed during the scan, are marked for removal.
+        std::vector<uint8_t> valid(files.size(), 0);
+
+        auto StatRange = [&files, &valid](size_t iBegin, size_t iEnd) {
+            for (size_t i = iBegin; i < iEnd; ++i)
+            {
+                valid[i] = StatFile(files[i]) ? 1 : 0;
+            }
+        };
+
+        size_t nFilesPerThread = (files.size() + nThreads - 1) / nThreads;
+
+        std::vector<std::thread> threads;
+        for (size_t iThread = 1; iThread < nThreads; ++iThread)
+        {
+            size_t iBegin = std::min(iThread * nFilesPerThread, files.size());
+            size_t iEnd = std::min(iBegin + nFilesPerThread, files.size());
+            threads.emplace_back(StatRange, iBegin, iEnd);
+        }
+
+        // The calling thread handles the first range.
+        StatRange(0, std::min(nFilesPerThread, files.size()));
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        size_t iValid = 0;
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            if (valid[i] != 0)
+            {
+                if (iValid != i)
+                {
+                    files[iValid] = std::move(files[i]);
+                }
+
+                ++iValid;
+            }
+        }
+
+        files.resize(iValid);
+    }
+
+}
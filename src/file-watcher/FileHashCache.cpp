@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <cctype>
+#include <string>
+
+#include "hscpp/file-watcher/FileHashCache.h"
+#include "hscpp/Util.h"
+#include "hscpp/Log.h"
+
+namespace hscpp
+{
+
+    // 64-bit FNV-1a.
+    const static uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    const static uint64_t FNV_PRIME = 1099511628211ull;
+
+    static void MixHash(uint64_t& hash, char c)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= FNV_PRIME;
+    }
+
+    static bool IsWithinDirectory(const fs::path& filePath, const fs::path& directoryPath)
+    {
+        auto fileIt = filePath.begin();
+        for (const auto& directoryComponent : directoryPath)
+        {
+            if (fileIt == filePath.end() || *fileIt != directoryComponent)
+            {
+                return false;
+            }
+
+            ++fileIt;
+        }
+
+        return true;
+    }
+
+    void FileHashCache::SetHashMode(HashMode mode)
+    {
+        if (mode == m_HashMode)
+        {
+            return;
+        }
+
+        m_HashMode = mode;
+
+        // Hashes of different modes cannot be compared, so rehash each recorded file.
+        for (auto it = m_HashesByPath.begin(); it != m_HashesByPath.end();)
+        {
+            if (HashFile(it->first, m_HashMode, it->second))
+            {
+                ++it;
+            }
+            else
+            {
+                it = m_HashesByPath.erase(it);
+            }
+        }
+    }
+
+    void FileHashCache::AddDirectory(const fs::path& directoryPath, const FileWatcherConfig& config)
+    {
+        // Unreadable subdirectories are skipped. Files that are not hashed simply have their next
+        // event kept.
+        std::error_code error;
+        auto directoryIt = fs::recursive_directory_iterator(directoryPath,
+            fs::directory_options::skip_permission_denied, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            log::Warning() << HSCPP_LOG_PREFIX << "Unable to iterate directory "
+                << directoryPath << log::End(".");
+            return;
+        }
+
+        const std::vector<std::string>& ignoredNames = config.ignoredDirectoryNames;
+
+        for (; directoryIt != fs::recursive_directory_iterator(); directoryIt.increment(error))
+        {
+            if (error.value() != HSCPP_ERROR_SUCCESS)
+            {
+                log::Warning() << HSCPP_LOG_PREFIX << "Failed to iterate directory "
+                    << directoryPath << log::End(".");
+                return;
+            }
+
+            const fs::directory_entry& entry = *directoryIt;
+            if (entry.is_directory(error))
+            {
+                bool bIgnored = std::find(ignoredNames.begin(), ignoredNames.end(),
+                    entry.path().filename().u8string()) != ignoredNames.end();
+
+                if (!config.bRecursive || bIgnored)
+                {
+                    directoryIt.disable_recursion_pending();
+                }
+
+                continue;
+            }
+
+            AddFile(entry.path());
+        }
+    }
+
+    void FileHashCache::RemoveDirectory(const fs::path& directoryPath)
+    {
+        std::error_code error;
+        fs::path canonicalDirectoryPath = fs::canonical(directoryPath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            canonicalDirectoryPath = directoryPath;
+        }
+
+        for (auto it = m_HashesByPath.begin(); it != m_HashesByPath.end();)
+        {
+            if (IsWithinDirectory(it->first, canonicalDirectoryPath))
+            {
+                it = m_HashesByPath.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void FileHashCache::RemoveUnchangedEvents(std::vector<IFileWatcher::Event>& events)
+    {
+        events.erase(std::remove_if(events.begin(), events.end(), [this](IFileWatcher::Event& event) {
+            if (!util::IsSourceFile(event.filePath) && !util::IsHeaderFile(event.filePath))
+            {
+                return false;
+            }
+
+            fs::path canonicalFilePath = event.bCanonical ? event.filePath : GetCanonicalPath(event.filePath);
+
+            if (event.type == IFileWatcher::Event::Type::Renamed)
+            {
+                m_HashesByPath.erase(event.bCanonical ? event.oldFilePath : GetCanonicalPath(event.oldFilePath));
+            }
+
+            uint64_t hash = 0;
+            if (event.type == IFileWatcher::Event::Type::Removed
+                || !HashFile(canonicalFilePath, m_HashMode, hash))
+            {
+                // The file was removed, or could not be read.
+                m_HashesByPath.erase(canonicalFilePath);
+                return false;
+            }
+
+            auto hashIt = m_HashesByPath.find(canonicalFilePath);
+            if (hashIt != m_HashesByPath.end() && hashIt->second == hash)
+            {
+                if (event.type == IFileWatcher::Event::Type::Renamed)
+                {
+                    // Editors often save by renaming a temporary file over the original. Only
+                    // the removal of the old path remains.
+                    event.type = IFileWatcher::Event::Type::Removed;
+                    event.filePath = event.oldFilePath;
+                    event.oldFilePath.clear();
+                    return false;
+                }
+
+                return true;
+            }
+
+            m_HashesByPath[canonicalFilePath] = hash;
+            return false;
+        }), events.end());
+    }
+
+    void FileHashCache::Invalidate(const fs::path& filePath)
+    {
+        m_HashesByPath.erase(GetCanonicalPath(filePath));
+    }
+
+    void FileHashCache::Clear()
+    {
+        m_HashesByPath.clear();
+    }
+
+    bool FileHashCache::HashFile(const fs::path& filePath, HashMode mode, uint64_t& hash)
+    {
+        std::ifstream file(filePath.u8string(), std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (file.bad())
+        {
+            return false;
+        }
+
+        switch (mode)
+        {
+            case HashMode::Content:
+                hash = HashContent(content.data(), content.size());
+                break;
+            case HashMode::Tokens:
+                hash = HashTokens(content);
+                break;
+        }
+
+        return true;
+    }
+
+    void FileHashCache::AddFile(const fs::path& filePath)
+    {
+        if (!util::IsSourceFile(filePath) && !util::IsHeaderFile(filePath))
+        {
+            return;
+        }
+
+        fs::path canonicalFilePath = GetCanonicalPath(filePath);
+
+        uint64_t hash = 0;
+        if (HashFile(canonicalFilePath, m_HashMode, hash))
+        {
+            m_HashesByPath[canonicalFilePath] = hash;
+        }
+    }
+
+    fs::path FileHashCache::GetCanonicalPath(const fs::path& filePath)
+    {
+        // As in util::SortFileEvents, canonicalize the parent directory, since the file itself
+        // may have been removed.
+        std::error_code error;
+        fs::path canonicalDirectoryPath = fs::canonical(filePath.parent_path(), error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            return filePath;
+        }
+
+        return canonicalDirectoryPath / filePath.filename();
+    }
+
+    uint64_t FileHashCache::HashContent(const char* pContent, size_t size)
+    {
+        uint64_t hash = FNV_OFFSET_BASIS;
+        for (size_t i = 0; i < size; ++i)
+        {
+            MixHash(hash, pContent[i]);
+        }
+
+        return hash;
+    }
+
+    uint64_t FileHashCache::HashTokens(const std::vector<char>& content)
+    {
+        // Rather than fully tokenizing the file, hash its characters with comments removed and
+        // each run of whitespace collapsed into a single separator. This keeps "a - -b" distinct
+        // from "a--b", at the cost of treating "a+b" and "a + b" as different. String literals
+        // are hashed verbatim, and the newline ending a preprocessor directive is significant.
+        uint64_t hash = FNV_OFFSET_BASIS;
+
+        size_t nChars = content.size();
+        size_t i = 0;
+
+        bool bPendingSeparator = false;
+        bool bSuppressSeparator = true;
+        bool bAtLineStart = true;
+        bool bInDirective = false;
+
+        auto Peek = [&content, nChars](size_t iChar) {
+            return iChar < nChars ? content[iChar] : '\0';
+        };
+
+        while (i < nChars)
+        {
+            char c = content[i];
+
+            if (c == '\\' && (Peek(i + 1) == '\n' || (Peek(i + 1) == '\r' && Peek(i + 2) == '\n')))
+            {
+                // Line splice.
+                i += (Peek(i + 1) == '\r') ? 3 : 2;
+            }
+            else if (c == '\n')
+            {
+                if (bInDirective)
+                {
+                    MixHash(hash, '\n');
+                    bInDirective = false;
+                    bSuppressSeparator = true;
+                }
+                else
+                {
+                    bPendingSeparator = true;
+                }
+
+                bAtLineStart = true;
+                ++i;
+            }
+            else if (std::isspace(static_cast<unsigned char>(c)))
+            {
+                bPendingSeparator = true;
+                ++i;
+            }
+            else if (c == '/' && Peek(i + 1) == '/')
+            {
+                while (i < nChars && content[i] != '\n')
+                {
+                    ++i;
+                }
+
+                bPendingSeparator = true;
+            }
+            else if (c == '/' && Peek(i + 1) == '*')
+            {
+                i += 2;
+                while (i < nChars && !(content[i] == '*' && Peek(i + 1) == '/'))
+                {
+                    ++i;
+                }
+
+                i = std::min(i + 2, nChars);
+                bPendingSeparator = true;
+            }
+            else
+            {
+                if (bPendingSeparator && !bSuppressSeparator)
+                {
+                    MixHash(hash, ' ');
+                }
+
+                if (bAtLineStart && c == '#')
+                {
+                    bInDirective = true;
+                }
+
+                bPendingSeparator = false;
+                bSuppressSeparator = false;
+                bAtLineStart = false;
+
+                size_t iEnd = i + 1;
+                if (c == '"' && i > 0 && content[i - 1] == 'R')
+                {
+                    // Raw string literal, R"delimiter(...)delimiter".
+                    size_t iParen = i + 1;
+                    while (iParen < nChars && content[iParen] != '(' && content[iParen] != '\n')
+                    {
+                        ++iParen;
+                    }
+
+                    std::string terminator = ")" + std::string(content.begin() + i + 1,
+                        content.begin() + iParen) + "\"";
+                    auto endIt = std::search(content.begin() + iParen, content.end(),
+                        terminator.begin(), terminator.end());
+
+                    iEnd = (endIt == content.end())
+                        ? nChars
+                        : static_cast<size_t>(endIt - content.begin()) + terminator.size();
+                }
+                else if (c == '"' || (c == '\'' && !(i > 0 && std::isdigit(static_cast<unsigned char>(content[i - 1])))))
+                {
+                    // String or character literal. A quote following a digit is a digit separator.
+                    while (iEnd < nChars && content[iEnd] != c && content[iEnd] != '\n')
+                    {
+                        iEnd += (content[iEnd] == '\\') ? 2 : 1;
+                    }
+
+                    iEnd = std::min(iEnd + 1, nChars);
+                }
+
+                for (; i < iEnd; ++i)
+                {
+                    MixHash(hash, content[i]);
+                }
+            }
+        }
+
+        return hash;
+    }
+
+}
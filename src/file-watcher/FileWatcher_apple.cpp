@@ -395,8 +395,8 @@ namespace hscpp
                 continue;
             }
 
-            // FSEventStreams are recursive, but the hscpp API is not. Validate that the change
-            // happened within the watched directory, and not one of its subdirectories.
+            // FSEventStreams are recursive, but hscpp watches are not by default. Validate that the
+            // change happened within the watched directory, and not one of its subdirectories.
             fs::path filePath = fs::u8path(static_cast<char**>(pEventPaths)[i]);
 
             fs::path canonicalDirectoryPath;
@@ -405,8 +405,21 @@ namespace hscpp
                 continue;
             }
 
-            if (pThis->m_CanonicalDirectoryPaths.find(canonicalDirectoryPath)
-                == pThis->m_CanonicalDirectoryPaths.end())
+            bool bWatched = false;
+            while (!bWatched)
+            {
+                bWatched = pThis->m_CanonicalDirectoryPaths.find(canonicalDirectoryPath)
+                    != pThis->m_CanonicalDirectoryPaths.end();
+
+                if (!pThis->m_pConfig->bRecursive || canonicalDirectoryPath == canonicalDirectoryPath.root_path())
+                {
+                    break;
+                }
+
+                canonicalDirectoryPath = canonicalDirectoryPath.parent_path();
+            }
+
+            if (!bWatched)
             {
                 // Skip change that occurred in subdirectory.
                 continue;
@@ -1,179 +1,698 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/eventfd.h>
+
+#include <cerrno>
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
 
 #include "hscpp/file-watcher/FileWatcher_unix.h"
 #include "hscpp/Log.h"
+#include "hscpp/FsPathHasher.h"
 
 namespace hscpp
 {
 
     FileWatcher::FileWatcher(FileWatcherConfig* pConfig)
         : m_pConfig(pConfig)
+        , m_EventBatches(64)
     {}
 
+    FileWatcher::~FileWatcher()
+    {
+        StopWatcherThread();
+
+        if (m_NotifyFd != -1)
+        {
+            close(m_NotifyFd);
+        }
+    }
+
     bool FileWatcher::AddWatch(const fs::path& directoryPath)
     {
-        // Create the inotify fd, if it is not already initialized.
-        if (m_NotifyFd == -1)
+        if (!InitializeNotifyFd())
         {
-            m_NotifyFd = inotify_init();
-            if (m_NotifyFd == -1)
-            {
-                log::Error() << HSCPP_LOG_PREFIX << "Failed inotify_init call."
-                    << log::LastOsError() << log::End();
-                return false;
-            }
+            return false;
+        }
 
-            int flags = fcntl(m_NotifyFd, F_GETFL, 0);
-            if (flags == -1)
-            {
-                log::Error() << HSCPP_LOG_PREFIX << "Failed to get flags from directory watch fd. "
-                    << log::LastOsError() << log::End();
-                return false;
-            }
+        std::lock_guard<std::mutex> lock(m_WatchesMutex);
 
-            if (fcntl(m_NotifyFd, F_SETFL, flags | O_NONBLOCK) == -1)
-            {
-                log::Error() << HSCPP_LOG_PREFIX << "Failed to set directory watch fd to nonblocking. "
-                    << log::LastOsError() << log::End();
-                return false;
-            }
-        }
+        m_bWarnedWatchLimit = false;
 
-        int mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO;
-        int wd = inotify_add_watch(m_NotifyFd, directoryPath.u8string().c_str(), mask);
+        int wd = AddDirectoryWatch(directoryPath, -1);
         if (wd == -1)
         {
             log::Error() << HSCPP_LOG_PREFIX << "Failed to add directory "
-                 << directoryPath << " to watch. " << log::LastOsError() << log::End();
+                 << directoryPath << " to watch." << log::End();
             return false;
         }
 
-        m_DirectoryPathsByWd[wd] = directoryPath;
+        if (m_pConfig->bRecursive)
+        {
+            AddSubdirectoryWatches(directoryPath, wd, false);
+        }
+
+        // Scan the canonical path, which events are reported under.
+        DirectorySnapshot snapshot;
+        if (snapshot.Scan(m_DirectoryWatchesByWd.at(wd).canonicalDirectoryPath, *m_pConfig))
+        {
+            m_SnapshotsByRootWd[wd] = std::move(snapshot);
+        }
 
         return true;
     }
 
     bool FileWatcher::RemoveWatch(const fs::path& directoryPath)
     {
-        auto watchIt = std::find_if(m_DirectoryPathsByWd.begin(), m_DirectoryPathsByWd.end(),
-            [directoryPath](const std::pair<int, fs::path>& pair) {
-                return directoryPath == pair.second;
+        std::lock_guard<std::mutex> lock(m_WatchesMutex);
+
+        auto watchIt = std::find_if(m_DirectoryWatchesByWd.begin(), m_DirectoryWatchesByWd.end(),
+            [directoryPath](const std::pair<const int, DirectoryWatch>& wd__watch) {
+                return directoryPath == wd__watch.second.directoryPath
+                    && wd__watch.first == wd__watch.second.rootWd;
             });
 
-        if (watchIt == m_DirectoryPathsByWd.end())
+        if (watchIt == m_DirectoryWatchesByWd.end())
         {
             log::Error() << HSCPP_LOG_PREFIX << "Directory " << directoryPath << "could not be found." << log::End();
             return false;
         }
 
-        CloseWatch(watchIt->first);
+        // Remove the directory, along with any subdirectories that were watched recursively.
+        int rootWd = watchIt->first;
+        m_SnapshotsByRootWd.erase(rootWd);
+
+        for (auto it = m_DirectoryWatchesByWd.begin(); it != m_DirectoryWatchesByWd.end();)
+        {
+            if (it->second.rootWd == rootWd)
+            {
+                CloseWatch(it->first);
+                it = m_DirectoryWatchesByWd.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
 
-        m_DirectoryPathsByWd.erase(watchIt);
         return true;
     }
 
     void FileWatcher::ClearAllWatches()
     {
-        for (const auto& wd__path : m_DirectoryPathsByWd)
+        std::lock_guard<std::mutex> lock(m_WatchesMutex);
+
+        for (const auto& wd__watch : m_DirectoryWatchesByWd)
         {
-            CloseWatch(wd__path.first);
+            CloseWatch(wd__watch.first);
         }
 
-        m_DirectoryPathsByWd.clear();
+        m_DirectoryWatchesByWd.clear();
+        m_SnapshotsByRootWd.clear();
     }
 
     void FileWatcher::PollChanges(std::vector<Event>& events)
     {
         events.clear();
 
+        if (m_WatcherThread.joinable())
+        {
+            // The watcher thread has already gathered the events.
+            std::vector<Event> batch;
+            while (m_EventBatches.TryPop(batch))
+            {
+                events.insert(events.end(), batch.begin(), batch.end());
+            }
+
+            return;
+        }
+
         // Check for changes and update m_PendingEvents.
         PollChanges();
 
-        // We will gather the events that occur over the next m_PollFrequency ms. This makes it
-        // easier to deal with temporary files that occur during saving, as one can be reasonably
-        // confident that these files have been created and removed within a sufficiently long
-        // m_PollFrequency period.
-        if (!m_bGatheringEvents && m_PendingEvents.size() > 0)
+        GatherPendingEvents(events);
+    }
+
+    void FileWatcher::PollChanges()
+    {
+        const int nFds = 1;
+
+        struct pollfd fds[nFds];
+        fds->fd = m_NotifyFd;
+        fds->events = POLLIN;
+
+        int ret = poll(fds, nFds, 0);
+        if (ret > 0)
         {
-            // Begin gathering events.
-            m_bGatheringEvents = true;
-            m_LastPollTime = std::chrono::steady_clock::now();
+            ReadNotifyEvents();
+        }
+    }
 
+    void FileWatcher::ReadNotifyEvents()
+    {
+        ssize_t nBytes = read(m_NotifyFd, m_NotifyBuffer.data(), m_NotifyBuffer.size());
+        if (nBytes <= 0)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to read notify fd. "
+                << log::LastOsError() << log::End();
             return;
         }
-        else
+
+        std::lock_guard<std::mutex> lock(m_WatchesMutex);
+
+        // inotify events are not timestamped, so use the time they were read.
+        auto time = std::chrono::steady_clock::now();
+
+        for (char* pData = m_NotifyBuffer.data(); pData < m_NotifyBuffer.data() + nBytes;)
+        {
+            struct inotify_event* pNotifyEvent = reinterpret_cast<inotify_event*>(pData);
+            HandleNotifyEvent(pNotifyEvent, time);
+
+            pData += sizeof(struct inotify_event) + pNotifyEvent->len;
+        }
+
+        if (m_bQueueOverflowed)
+        {
+            RescanAfterOverflow();
+        }
+
+        m_LastEventTime = time;
+    }
+
+    void FileWatcher::RescanAfterOverflow()
+    {
+        log::Warning() << HSCPP_LOG_PREFIX << "File event queue overflowed; rescanning watched "
+            << "directories. Consider increasing fs.inotify.max_queued_events." << log::End();
+
+        m_bQueueOverflowed = false;
+
+        // The kernel does not say which watches lost events, so compare every watched directory
+        // against its snapshot. Snapshots are kept up to date with the events that were handed out,
+        // and the events still pending are applied first, so that only lost changes are reported.
+        for (auto& rootWd__snapshot : m_SnapshotsByRootWd)
         {
-            // Currently gathering events. Return if not enough time has passed yet.
-            auto now = std::chrono::steady_clock::now();
-            auto dt = now - m_LastPollTime;
-            if (dt < m_pConfig->latency)
+            auto watchIt = m_DirectoryWatchesByWd.find(rootWd__snapshot.first);
+            if (watchIt == m_DirectoryWatchesByWd.end())
             {
-                return;
+                continue;
+            }
+
+            if (m_pConfig->bRecursive)
+            {
+                // Directories created during the overflow are not yet watched.
+                AddSubdirectoryWatches(watchIt->second.directoryPath, rootWd__snapshot.first, false);
+            }
+
+            rootWd__snapshot.second.Update(m_PendingEvents);
+
+            DirectorySnapshot snapshot;
+            if (snapshot.Scan(watchIt->second.canonicalDirectoryPath, *m_pConfig))
+            {
+                snapshot.Diff(rootWd__snapshot.second, m_PendingEvents);
+                rootWd__snapshot.second = std::move(snapshot);
             }
         }
+    }
+
+    bool FileWatcher::GatherPendingEvents(std::vector<Event>& events)
+    {
+        // We will gather the events that occur over a short period. This makes it easier to deal
+        // with temporary files that occur during saving. Events are reported once every modified
+        // file has been closed for writing and things have gone quiet, or after latency at most.
+        if (m_PendingEvents.empty())
+        {
+            return false;
+        }
+
+        if (!m_bGatheringEvents)
+        {
+            // Begin gathering events.
+            m_bGatheringEvents = true;
+            m_LastPollTime = std::chrono::steady_clock::now();
+            m_QuietPeriod = std::min(m_pConfig->quietPeriod, m_pConfig->latency);
+        }
+
+        if (GetGatherTimeout().count() > 0)
+        {
+            return false;
+        }
 
         // Done gathering events.
         m_bGatheringEvents = false;
+        m_OpenForWritePaths.clear();
+        m_iMovedFromEventsByCookie.clear();
+
+        // Once reported, these changes must not be reported again by a rescan after an overflow.
+        {
+            std::lock_guard<std::mutex> lock(m_WatchesMutex);
+            for (auto& rootWd__snapshot : m_SnapshotsByRootWd)
+            {
+                rootWd__snapshot.second.Update(m_PendingEvents);
+            }
+        }
 
         events = m_PendingEvents;
         m_PendingEvents.clear();
+
+        return true;
     }
 
-    void FileWatcher::PollChanges()
+    std::chrono::milliseconds FileWatcher::GetGatherTimeout()
     {
-        const int nFds = 1;
+        auto now = std::chrono::steady_clock::now();
 
-        struct pollfd fds[nFds];
-        fds->fd = m_NotifyFd;
-        fds->events = POLLIN;
+        auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+            m_pConfig->latency - (now - m_LastPollTime));
 
-        int ret = poll(fds, nFds, 0);
-        if (ret > 0)
+        if (m_OpenForWritePaths.empty())
+        {
+            auto quietTimeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+                m_QuietPeriod - (now - m_LastEventTime));
+            timeout = std::min(timeout, quietTimeout);
+        }
+
+        return std::max(timeout, std::chrono::milliseconds(0));
+    }
+
+    void FileWatcher::StartWatcherThread()
+    {
+        m_WakeFd = eventfd(0, EFD_NONBLOCK);
+        if (m_WakeFd == -1)
         {
-            for (int i = 0; i < nFds; ++i)
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to create watcher thread eventfd. "
+                << log::LastOsError() << log::End();
+            return;
+        }
+
+        m_bStopWatcherThread = false;
+        m_WatcherThread = std::thread(&FileWatcher::RunWatcherThread, this);
+    }
+
+    void FileWatcher::StopWatcherThread()
+    {
+        if (m_WatcherThread.joinable())
+        {
+            m_bStopWatcherThread = true;
+
+            uint64_t value = 1;
+            if (write(m_WakeFd, &value, sizeof(value)) != sizeof(value))
+            {
+                log::Error() << HSCPP_LOG_PREFIX << "Failed to wake watcher thread. "
+                    << log::LastOsError() << log::End();
+            }
+
+            m_WatcherThread.join();
+        }
+
+        if (m_WakeFd != -1)
+        {
+            close(m_WakeFd);
+            m_WakeFd = -1;
+        }
+    }
+
+    void FileWatcher::RunWatcherThread()
+    {
+        // Batch that is waiting to be handed over, kept while the queue is full.
+        std::vector<Event> batch;
+
+        while (!m_bStopWatcherThread)
+        {
+            // Sleep until an event arrives, waking up early to finish gathering or to retry a
+            // handover.
+            int timeoutMs = -1;
+            if (m_bGatheringEvents)
+            {
+                timeoutMs = static_cast<int>(GetGatherTimeout().count() + 1);
+            }
+            else if (!batch.empty())
+            {
+                timeoutMs = static_cast<int>(m_pConfig->latency.count());
+            }
+
+            const int nFds = 2;
+
+            struct pollfd fds[nFds];
+            fds[0].fd = m_NotifyFd;
+            fds[0].events = POLLIN;
+            fds[1].fd = m_WakeFd;
+            fds[1].events = POLLIN;
+
+            int ret = poll(fds, nFds, timeoutMs);
+            if (ret < 0)
             {
-                ssize_t nBytes = read(fds[i].fd, m_NotifyBuffer.data(), m_NotifyBuffer.size());
-                if (nBytes <= 0)
+                if (errno == EINTR)
                 {
-                    log::Error() << HSCPP_LOG_PREFIX << "Failed to read notify fd. "
-                        << log::LastOsError() << log::End();
-                    return;
+                    continue;
                 }
 
-                for (char* pData = m_NotifyBuffer.data(); pData < m_NotifyBuffer.data() + nBytes;)
-                {
-                    struct inotify_event* pNotifyEvent = reinterpret_cast<inotify_event*>(pData);
-                    HandleNotifyEvent(pNotifyEvent);
+                log::Error() << HSCPP_LOG_PREFIX << "Failed to poll notify fd. "
+                    << log::LastOsError() << log::End();
+                return;
+            }
 
-                    pData += sizeof(struct inotify_event) + pNotifyEvent->len;
-                }
+            if (fds[1].revents & POLLIN)
+            {
+                // Woken up to exit.
+                continue;
+            }
+
+            if (fds[0].revents & POLLIN)
+            {
+                ReadNotifyEvents();
+            }
+
+            std::vector<Event> events;
+            if (GatherPendingEvents(events))
+            {
+                batch.insert(batch.end(), events.begin(), events.end());
+            }
+
+            if (batch.empty())
+            {
+                continue;
+            }
+
+            // A file is typically modified several times per save, so drop repeated modifications.
+            std::unordered_set<fs::path, FsPathHasher> modifiedPaths;
+            batch.erase(std::remove_if(batch.begin(), batch.end(), [&modifiedPaths](const Event& event) {
+                return event.type == Event::Type::Modified && !modifiedPaths.insert(event.filePath).second;
+            }), batch.end());
+
+            if (m_EventBatches.TryPush(std::move(batch)))
+            {
+                batch = std::vector<Event>();
             }
         }
     }
 
-    void FileWatcher::HandleNotifyEvent(struct inotify_event *pNotifyEvent)
+    void FileWatcher::HandleNotifyEvent(struct inotify_event *pNotifyEvent,
+        std::chrono::steady_clock::time_point time)
     {
+        if (pNotifyEvent->mask & IN_Q_OVERFLOW)
+        {
+            // Events were dropped. Rescan once the rest of the buffer has been handled.
+            m_bQueueOverflowed = true;
+            return;
+        }
+
+        auto watchIt = m_DirectoryWatchesByWd.find(pNotifyEvent->wd);
+        if (watchIt == m_DirectoryWatchesByWd.end())
+        {
+            // Event arrived for a watch that has already been removed.
+            return;
+        }
+
+        if (pNotifyEvent->mask & IN_IGNORED)
+        {
+            // The kernel removed the watch, as its directory was deleted.
+            m_DirectoryWatchesByWd.erase(watchIt);
+            return;
+        }
+
+        fs::path filePath = watchIt->second.directoryPath / fs::u8path(pNotifyEvent->name);
+        int rootWd = watchIt->second.rootWd;
+
         if (pNotifyEvent->mask & IN_ISDIR)
         {
-            // Ignore directories.
+            if (!m_pConfig->bRecursive)
+            {
+                // Ignore directories.
+                return;
+            }
+
+            if (pNotifyEvent->mask & IN_CREATE || pNotifyEvent->mask & IN_MOVED_TO)
+            {
+                // Files may have been added to the directory before it could be watched, so
+                // report every file found within it.
+                if (!IsIgnoredDirectory(filePath) && AddDirectoryWatch(filePath, rootWd) != -1)
+                {
+                    AddSubdirectoryWatches(filePath, rootWd, true);
+                }
+            }
+            else if (pNotifyEvent->mask & IN_MOVED_FROM)
+            {
+                // Unlike deleted directories, moved directories keep their watches.
+                RemoveDirectoryWatches(filePath);
+            }
+
+            return;
+        }
+
+        if (pNotifyEvent->mask & IN_CLOSE_WRITE)
+        {
+            // The file has been fully written.
+            m_OpenForWritePaths.erase(filePath);
             return;
         }
 
-        fs::path directoryPath = m_DirectoryPathsByWd[pNotifyEvent->wd];
+        if (m_bGatheringEvents && m_OpenForWritePaths.empty()
+            && std::chrono::steady_clock::now() - m_LastEventTime < m_QuietPeriod)
+        {
+            // Events resumed shortly after the batch appeared complete, as editors often save in
+            // several steps. Wait longer before reporting this batch.
+            m_QuietPeriod = std::min(m_QuietPeriod * 2, m_pConfig->latency);
+        }
 
         Event event;
-        event.filePath = directoryPath / fs::u8path(pNotifyEvent->name);
+        event.filePath = watchIt->second.canonicalDirectoryPath / fs::u8path(pNotifyEvent->name);
+        event.bCanonical = true;
+        event.time = time;
 
         if (pNotifyEvent->mask & IN_CREATE
-            || pNotifyEvent->mask & IN_MOVED_TO
-            || pNotifyEvent->mask & IN_MODIFY
-            || pNotifyEvent->mask & IN_DELETE
-            || pNotifyEvent->mask & IN_MOVED_FROM)
+            || pNotifyEvent->mask & IN_MODIFY)
         {
+            event.type = (pNotifyEvent->mask & IN_CREATE) ? Event::Type::Created : Event::Type::Modified;
+
+            m_OpenForWritePaths.insert(filePath);
             m_PendingEvents.push_back(event);
         }
+        else if (pNotifyEvent->mask & IN_DELETE)
+        {
+            event.type = Event::Type::Removed;
+
+            m_OpenForWritePaths.erase(filePath);
+            m_PendingEvents.push_back(event);
+        }
+        else if (pNotifyEvent->mask & IN_MOVED_FROM)
+        {
+            // Treated as a removal, unless the file reappears within a watched directory.
+            event.type = Event::Type::Removed;
+
+            m_OpenForWritePaths.erase(filePath);
+            m_iMovedFromEventsByCookie[pNotifyEvent->cookie] = m_PendingEvents.size();
+            m_PendingEvents.push_back(event);
+        }
+        else if (pNotifyEvent->mask & IN_MOVED_TO)
+        {
+            m_OpenForWritePaths.erase(filePath);
+
+            auto movedFromIt = m_iMovedFromEventsByCookie.find(pNotifyEvent->cookie);
+            if (movedFromIt != m_iMovedFromEventsByCookie.end())
+            {
+                Event& movedFromEvent = m_PendingEvents.at(movedFromIt->second);
+                movedFromEvent.type = Event::Type::Renamed;
+                movedFromEvent.oldFilePath = movedFromEvent.filePath;
+                movedFromEvent.filePath = event.filePath;
+                movedFromEvent.time = time;
+
+                m_iMovedFromEventsByCookie.erase(movedFromIt);
+            }
+            else
+            {
+                // Moved in from an unwatched directory.
+                event.type = Event::Type::Created;
+                m_PendingEvents.push_back(event);
+            }
+        }
+    }
+
+    bool FileWatcher::InitializeNotifyFd()
+    {
+        // Create the inotify fd, if it is not already initialized.
+        if (m_NotifyFd != -1)
+        {
+            return true;
+        }
+
+        m_NotifyFd = inotify_init();
+        if (m_NotifyFd == -1)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed inotify_init call."
+                << log::LastOsError() << log::End();
+            return false;
+        }
+
+        int flags = fcntl(m_NotifyFd, F_GETFL, 0);
+        if (flags == -1)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to get flags from directory watch fd. "
+                << log::LastOsError() << log::End();
+            return false;
+        }
+
+        if (fcntl(m_NotifyFd, F_SETFL, flags | O_NONBLOCK) == -1)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to set directory watch fd to nonblocking. "
+                << log::LastOsError() << log::End();
+            return false;
+        }
+
+        // Watches are shared by every process of the user, so this is only an upper bound.
+        m_MaxWatches = GetMaxUserWatches();
+        if (m_pConfig->maxWatchedDirectories != 0
+            && (m_MaxWatches == 0 || m_pConfig->maxWatchedDirectories < m_MaxWatches))
+        {
+            m_MaxWatches = m_pConfig->maxWatchedDirectories;
+        }
+
+        if (m_pConfig->bUseWatcherThread)
+        {
+            StartWatcherThread();
+        }
+
+        return true;
+    }
+
+    int FileWatcher::AddDirectoryWatch(const fs::path& directoryPath, int rootWd)
+    {
+        if (HasReachedWatchLimit())
+        {
+            WarnWatchLimit();
+            return -1;
+        }
+
+        int mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO;
+        int wd = inotify_add_watch(m_NotifyFd, directoryPath.u8string().c_str(), mask);
+        if (wd == -1)
+        {
+            if (errno == ENOSPC)
+            {
+                WarnWatchLimit();
+            }
+            else
+            {
+                log::Error() << HSCPP_LOG_PREFIX << "Failed to add directory "
+                    << directoryPath << " to watch. " << log::LastOsError() << log::End();
+            }
+
+            return -1;
+        }
+
+        // Watching the same directory twice returns the same wd. Keep the original owner.
+        if (m_DirectoryWatchesByWd.find(wd) == m_DirectoryWatchesByWd.end())
+        {
+            DirectoryWatch watch;
+            watch.directoryPath = directoryPath;
+
+            std::error_code error;
+            watch.canonicalDirectoryPath = fs::canonical(directoryPath, error);
+            if (error.value() != HSCPP_ERROR_SUCCESS)
+            {
+                // Directory was removed before it could be resolved. Its events will not arrive.
+                watch.canonicalDirectoryPath = directoryPath;
+            }
+            watch.rootWd = (rootWd == -1) ? wd : rootWd;
+
+            m_DirectoryWatchesByWd[wd] = watch;
+        }
+
+        return wd;
+    }
+
+    void FileWatcher::AddSubdirectoryWatches(const fs::path& directoryPath, int rootWd, bool bReportFiles)
+    {
+        // Walk the tree once. Symlinks are not followed, to avoid watching a directory twice.
+        std::error_code error;
+        auto directoryIt = fs::recursive_directory_iterator(directoryPath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            log::Warning() << HSCPP_LOG_PREFIX << "Unable to iterate directory "
+                << directoryPath << log::End(".");
+            return;
+        }
+
+        for (; directoryIt != fs::recursive_directory_iterator(); directoryIt.increment(error))
+        {
+            if (error.value() != HSCPP_ERROR_SUCCESS)
+            {
+                log::Warning() << HSCPP_LOG_PREFIX << "Failed to iterate directory "
+                    << directoryPath << log::End(".");
+                return;
+            }
+
+            const fs::directory_entry& entry = *directoryIt;
+
+            if (entry.is_symlink(error) || !entry.is_directory(error))
+            {
+                if (bReportFiles && entry.is_regular_file(error))
+                {
+                    Event event;
+                    event.type = Event::Type::Created;
+                    event.filePath = entry.path();
+                    event.time = std::chrono::steady_clock::now();
+                    m_PendingEvents.push_back(event);
+                }
+
+                continue;
+            }
+
+            if (IsIgnoredDirectory(entry.path()) || AddDirectoryWatch(entry.path(), rootWd) == -1)
+            {
+                directoryIt.disable_recursion_pending();
+            }
+        }
+    }
+
+    void FileWatcher::RemoveDirectoryWatches(const fs::path& directoryPath)
+    {
+        std::string directoryPrefix = (directoryPath / "").u8string();
+
+        for (auto it = m_DirectoryWatchesByWd.begin(); it != m_DirectoryWatchesByWd.end();)
+        {
+            const fs::path& watchedPath = it->second.directoryPath;
+
+            bool bWithinDirectory = watchedPath == directoryPath
+                || watchedPath.u8string().compare(0, directoryPrefix.size(), directoryPrefix) == 0;
+
+            // Directories passed to AddWatch are only removed through RemoveWatch.
+            if (bWithinDirectory && it->first != it->second.rootWd)
+            {
+                CloseWatch(it->first);
+                it = m_DirectoryWatchesByWd.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    bool FileWatcher::IsIgnoredDirectory(const fs::path& directoryPath)
+    {
+        const std::vector<std::string>& ignoredNames = m_pConfig->ignoredDirectoryNames;
+        return std::find(ignoredNames.begin(), ignoredNames.end(),
+            directoryPath.filename().u8string()) != ignoredNames.end();
+    }
+
+    bool FileWatcher::HasReachedWatchLimit()
+    {
+        return m_MaxWatches != 0 && m_DirectoryWatchesByWd.size() >= m_MaxWatches;
+    }
+
+    void FileWatcher::WarnWatchLimit()
+    {
+        if (!m_bWarnedWatchLimit)
+        {
+            log::Warning() << HSCPP_LOG_PREFIX << "Reached the limit of watched directories, so some "
+                "directories will not be watched. Add unneeded directories to "
+                "FileWatcherConfig::ignoredDirectoryNames, or raise fs.inotify.max_user_watches."
+                << log::End();
+
+            m_bWarnedWatchLimit = true;
+        }
     }
 
     void FileWatcher::CloseWatch(int wd)
@@ -185,4 +704,17 @@ namespace hscpp
         }
     }
 
+    size_t FileWatcher::GetMaxUserWatches()
+    {
+        std::ifstream file("/proc/sys/fs/inotify/max_user_watches");
+
+        size_t maxUserWatches = 0;
+        if (!(file >> maxUserWatches))
+        {
+            return 0;
+        }
+
+        return maxUserWatches;
+    }
+
 }
\ No newline at end of file
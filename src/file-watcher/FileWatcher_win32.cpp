@@ -189,7 +189,7 @@ namespace hscpp
             pWatch->hDirectory,
             pWatch->buffer,
             sizeof(pWatch->buffer),
-            false,
+            pWatch->pFileWatcher->m_pConfig->bRecursive,
             FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_CREATION | FILE_NOTIFY_CHANGE_SIZE,
             NULL,
             &pWatch->overlapped,
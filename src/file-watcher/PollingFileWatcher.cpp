@@ -0,0 +1,143 @@
+#include "hscpp/file-watcher/PollingFileWatcher.h"
+#include "hscpp/Log.h"
+
+namespace hscpp
+{
+
+    PollingFileWatcher::PollingFileWatcher(FileWatcherConfig* pConfig)
+        : m_pConfig(pConfig)
+        , m_EventBatches(64)
+    {}
+
+    PollingFileWatcher::~PollingFileWatcher()
+    {
+        if (m_ScanThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_ScanThreadMutex);
+                m_bStopScanThread = true;
+            }
+
+            m_ScanThreadCondition.notify_one();
+            m_ScanThread.join();
+        }
+    }
+
+    bool PollingFileWatcher::AddWatch(const fs::path& directoryPath)
+    {
+        // Take the initial snapshot right away, so that changes made after AddWatch returns are
+        // detected.
+        DirectorySnapshot snapshot;
+        if (!snapshot.Scan(directoryPath, *m_pConfig))
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to add directory "
+                << directoryPath << " to watch." << log::End();
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_SnapshotsMutex);
+            m_SnapshotsByDirectoryPath[directoryPath] = std::move(snapshot);
+        }
+
+        if (!m_ScanThread.joinable())
+        {
+            m_ScanThread = std::thread(&PollingFileWatcher::RunScanThread, this);
+        }
+
+        return true;
+    }
+
+    bool PollingFileWatcher::RemoveWatch(const fs::path& directoryPath)
+    {
+        std::lock_guard<std::mutex> lock(m_SnapshotsMutex);
+
+        if (m_SnapshotsByDirectoryPath.erase(directoryPath) == 0)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Directory " << directoryPath << " could not be found." << log::End();
+            return false;
+        }
+
+        return true;
+    }
+
+    void PollingFileWatcher::ClearAllWatches()
+    {
+        std::lock_guard<std::mutex> lock(m_SnapshotsMutex);
+        m_SnapshotsByDirectoryPath.clear();
+    }
+
+    void PollingFileWatcher::PollChanges(std::vector<Event>& events)
+    {
+        events.clear();
+
+        std::vector<Event> batch;
+        while (m_EventBatches.TryPop(batch))
+        {
+            events.insert(events.end(), batch.begin(), batch.end());
+        }
+    }
+
+    void PollingFileWatcher::RunScanThread()
+    {
+        // Batch that is waiting to be handed over, kept while the queue is full.
+        std::vector<Event> batch;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_ScanThreadMutex);
+                m_ScanThreadCondition.wait_for(lock, m_pConfig->pollingInterval, [this]() {
+                    return m_bStopScanThread;
+                });
+
+                if (m_bStopScanThread)
+                {
+                    return;
+                }
+            }
+
+            ScanDirectories(batch);
+
+            if (!batch.empty() && m_EventBatches.TryPush(std::move(batch)))
+            {
+                batch = std::vector<Event>();
+            }
+        }
+    }
+
+    void PollingFileWatcher::ScanDirectories(std::vector<Event>& events)
+    {
+        std::vector<fs::path> directoryPaths;
+        {
+            std::lock_guard<std::mutex> lock(m_SnapshotsMutex);
+            for (const auto& directoryPath__snapshot : m_SnapshotsByDirectoryPath)
+            {
+                directoryPaths.push_back(directoryPath__snapshot.first);
+            }
+        }
+
+        for (const auto& directoryPath : directoryPaths)
+        {
+            // Scan without holding the lock, as this may take a while on large trees.
+            DirectorySnapshot snapshot;
+            if (!snapshot.Scan(directoryPath, *m_pConfig))
+            {
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(m_SnapshotsMutex);
+
+            auto snapshotIt = m_SnapshotsByDirectoryPath.find(directoryPath);
+            if (snapshotIt == m_SnapshotsByDirectoryPath.end())
+            {
+                // Watch was removed during the scan.
+                continue;
+            }
+
+            snapshot.Diff(snapshotIt->second, events);
+            snapshotIt->second = std::move(snapshot);
+        }
+    }
+
+}
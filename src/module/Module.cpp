@@ -18,6 +18,7 @@ namespace hscpp
     std::unordered_map<std::string, std::vector<ITracker*>>* ModuleSharedState::s_pTrackersByKey = nullptr;
     std::unordered_map<std::string, IConstructor*>* ModuleSharedState::s_pConstructorsByKey = nullptr;
     IAllocator* ModuleSharedState::s_pAllocator = nullptr;
+    std::recursive_mutex* ModuleSharedState::s_pTrackersMutex = nullptr;
 
 }
 
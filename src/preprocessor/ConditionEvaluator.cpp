@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+
+#include "hscpp/preprocessor/ConditionEvaluator.h"
+
+namespace hscpp
+{
+
+    // Macros that identify an operating system. Modules are compiled for the same platform as the
+    // running program, so whether these are defined is known.
+    static const std::vector<std::string> PLATFORM_MACROS = {
+        "_WIN32",
+        "_WIN64",
+        "__APPLE__",
+        "__MACH__",
+        "__linux__",
+        "__unix__",
+        "__ANDROID__",
+        "__FreeBSD__",
+        "__CYGWIN__",
+    };
+
+    static std::vector<std::string> GetDefinedPlatformMacros()
+    {
+        return {
+#ifdef _WIN32
+            "_WIN32",
+#endif
+#ifdef _WIN64
+            "_WIN64",
+#endif
+#ifdef __APPLE__
+            "__APPLE__",
+#endif
+#ifdef __MACH__
+            "__MACH__",
+#endif
+#ifdef __linux__
+            "__linux__",
+#endif
+#ifdef __unix__
+            "__unix__",
+#endif
+#ifdef __ANDROID__
+            "__ANDROID__",
+#endif
+#ifdef __FreeBSD__
+            "__FreeBSD__",
+#endif
+#ifdef __CYGWIN__
+            "__CYGWIN__",
+#endif
+        };
+    }
+
+    ConditionEvaluator::ConditionEvaluator()
+    {
+        SetDefinitions({});
+    }
+
+    void ConditionEvaluator::SetDefinitions(const std::vector<std::string>& definitions)
+    {
+        m_ValuesByMacro.clear();
+        m_UndefinedMacros = std::unordered_set<std::string>(PLATFORM_MACROS.begin(), PLATFORM_MACROS.end());
+
+        for (const auto& macro : GetDefinedPlatformMacros())
+        {
+            m_ValuesByMacro[macro] = "1";
+            m_UndefinedMacros.erase(macro);
+        }
+
+        for (const auto& definition : definitions)
+        {
+            size_t iEquals = definition.find('=');
+
+            std::string name = definition.substr(0, iEquals);
+            std::string value = (iEquals == std::string::npos) ? "1" : definition.substr(iEquals + 1);
+
+            m_ValuesByMacro[name] = value;
+            m_UndefinedMacros.erase(name);
+        }
+
+        m_Definitions = definitions;
+        std::sort(m_Definitions.begin(), m_Definitions.end());
+    }
+
+    ConditionEvaluator::Result ConditionEvaluator::Evaluate(const std::string& condition) const
+    {
+        State state;
+        if (!Tokenize(condition, state.tokens) || state.tokens.empty())
+        {
+            return Result::Unknown;
+        }
+
+        Value value = ParseExpr(state, 0);
+        if (state.bError || state.iToken != state.tokens.size() || !value.bKnown)
+        {
+            return Result::Unknown;
+        }
+
+        return (value.value != 0) ? Result::True : Result::False;
+    }
+
+    std::string ConditionEvaluator::GetKey() const
+    {
+        std::string key;
+        for (const auto& definition : m_Definitions)
+        {
+            key += definition + '\0';
+        }
+
+        return key;
+    }
+
+    ConditionEvaluator::Value ConditionEvaluator::ParseExpr(State& state, int precedence) const
+    {
+        Value lhs = ParseUnaryExpr(state);
+
+        while (!state.bError && state.iToken < state.tokens.size())
+        {
+            std::string op = state.tokens.at(state.iToken);
+
+            int opPrecedence = GetInfixPrecedence(op);
+            if (opPrecedence <= precedence)
+            {
+                break;
+            }
+
+            ++state.iToken;
+            Value rhs = ParseExpr(state, opPrecedence);
+
+            lhs = ApplyInfix(op, lhs, rhs);
+        }
+
+        return lhs;
+    }
+
+    ConditionEvaluator::Value ConditionEvaluator::ParseUnaryExpr(State& state) const
+    {
+        if (state.iToken >= state.tokens.size())
+        {
+            state.bError = true;
+            return Value();
+        }
+
+        std::string op = state.tokens.at(state.iToken);
+        if (op != "!" && op != "-" && op != "+" && op != "~")
+        {
+            return ParsePrimaryExpr(state);
+        }
+
+        ++state.iToken;
+        Value value = ParseUnaryExpr(state);
+
+        if (value.bKnown)
+        {
+            switch (op.front())
+            {
+                case '!':
+                    value.value = (value.value == 0) ? 1 : 0;
+                    break;
+                case '-':
+                    value.value = -value.value;
+                    break;
+                case '~':
+                    value.value = ~value.value;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        return value;
+    }
+
+    ConditionEvaluator::Value ConditionEvaluator::ParsePrimaryExpr(State& state) const
+    {
+        if (state.iToken >= state.tokens.size())
+        {
+            state.bError = true;
+            return Value();
+        }
+
+        std::string token = state.tokens.at(state.iToken);
+        ++state.iToken;
+
+        if (token == "(")
+        {
+            Value value = ParseExpr(state, 0);
+            if (state.iToken >= state.tokens.size() || state.tokens.at(state.iToken) != ")")
+            {
+                state.bError = true;
+                return Value();
+            }
+
+            ++state.iToken;
+            return value;
+        }
+
+        if (token == "defined")
+        {
+            return ParseDefined(state);
+        }
+
+        if (IsIdentifierStart(token.front()))
+        {
+            if (state.iToken < state.tokens.size() && state.tokens.at(state.iToken) == "(")
+            {
+                // Function-like macros (ex. __has_include) cannot be evaluated.
+                state.bError = true;
+                return Value();
+            }
+
+            return GetMacroValue(token);
+        }
+
+        Value value;
+        value.bKnown = ParseNumber(token, value.value);
+        if (!value.bKnown)
+        {
+            state.bError = true;
+        }
+
+        return value;
+    }
+
+    ConditionEvaluator::Value ConditionEvaluator::ParseDefined(State& state) const
+    {
+        bool bParen = (state.iToken < state.tokens.size() && state.tokens.at(state.iToken) == "(");
+        if (bParen)
+        {
+            ++state.iToken;
+        }
+
+        if (state.iToken >= state.tokens.size() || !IsIdentifierStart(state.tokens.at(state.iToken).front()))
+        {
+            state.bError = true;
+            return Value();
+        }
+
+        std::string name = state.tokens.at(state.iToken);
+        ++state.iToken;
+
+        if (bParen)
+        {
+            if (state.iToken >= state.tokens.size() || state.tokens.at(state.iToken) != ")")
+            {
+                state.bError = true;
+                return Value();
+            }
+
+            ++state.iToken;
+        }
+
+        Value value;
+        if (m_ValuesByMacro.find(name) != m_ValuesByMacro.end())
+        {
+            value.bKnown = true;
+            value.value = 1;
+        }
+        else if (m_UndefinedMacros.find(name) != m_UndefinedMacros.end())
+        {
+            value.bKnown = true;
+            value.value = 0;
+        }
+
+        return value;
+    }
+
+    ConditionEvaluator::Value ConditionEvaluator::GetMacroValue(const std::string& name) const
+    {
+        Value value;
+
+        auto it = m_ValuesByMacro.find(name);
+        if (it != m_ValuesByMacro.end())
+        {
+            // A macro defined to something other than a number is not evaluated.
+            value.bKnown = ParseNumber(it->second, value.value);
+        }
+        else if (m_UndefinedMacros.find(name) != m_UndefinedMacros.end())
+        {
+            // Undefined macros evaluate to 0.
+            value.bKnown = true;
+            value.value = 0;
+        }
+        else if (name == "true" || name == "false")
+        {
+            value.bKnown = true;
+            value.value = (name == "true") ? 1 : 0;
+        }
+
+        return value;
+    }
+
+    ConditionEvaluator::Value ConditionEvaluator::ApplyInfix(const std::string& op, const Value& lhs, const Value& rhs)
+    {
+        Value result;
+
+        // A known operand may decide a logical operator on its own.
+        if (op == "&&")
+        {
+            if ((lhs.bKnown && lhs.value == 0) || (rhs.bKnown && rhs.value == 0))
+            {
+                result.bKnown = true;
+                result.value = 0;
+            }
+            else if (lhs.bKnown && rhs.bKnown)
+            {
+                result.bKnown = true;
+                result.value = 1;
+            }
+
+            return result;
+        }
+
+        if (op == "||")
+        {
+            if ((lhs.bKnown && lhs.value != 0) || (rhs.bKnown && rhs.value != 0))
+            {
+                result.bKnown = true;
+                result.value = 1;
+            }
+            else if (lhs.bKnown && rhs.bKnown)
+            {
+                result.bKnown = true;
+                result.value = 0;
+            }
+
+            return result;
+        }
+
+        if (!lhs.bKnown || !rhs.bKnown)
+        {
+            return result;
+        }
+
+        int64_t a = lhs.value;
+        int64_t b = rhs.value;
+
+        result.bKnown = true;
+        if (op == "|")
+        {
+            result.value = a | b;
+        }
+        else if (op == "^")
+        {
+            result.value = a ^ b;
+        }
+        else if (op == "&")
+        {
+            result.value = a & b;
+        }
+        else if (op == "==")
+        {
+            result.value = (a == b);
+        }
+        else if (op == "!=")
+        {
+            result.value = (a != b);
+        }
+        else if (op == "<")
+        {
+            result.value = (a < b);
+        }
+        else if (op == "<=")
+        {
+            result.value = (a <= b);
+        }
+        else if (op == ">")
+        {
+            result.value = (a > b);
+        }
+        else if (op == ">=")
+        {
+            result.value = (a >= b);
+        }
+        else if (op == "<<" && b >= 0 && b < 64)
+        {
+            result.value = a << b;
+        }
+        else if (op == ">>" && b >= 0 && b < 64)
+        {
+            result.value = a >> b;
+        }
+        else if (op == "+")
+        {
+            result.value = a + b;
+        }
+        else if (op == "-")
+        {
+            result.value = a - b;
+        }
+        else if (op == "*")
+        {
+            result.value = a * b;
+        }
+        else if (op == "/" && b != 0)
+        {
+            result.value = a / b;
+        }
+        else if (op == "%" && b != 0)
+        {
+            result.value = a % b;
+        }
+        else
+        {
+            // Division by zero, or an out of range shift.
+            result.bKnown = false;
+        }
+
+        return result;
+    }
+
+    bool ConditionEvaluator::Tokenize(const std::string& condition, std::vector<std::string>& tokens)
+    {
+        static const std::vector<std::string> TWO_CHAR_OPS = {
+            "||", "&&", "==", "!=", "<=", ">=", "<<", ">>",
+        };
+
+        static const std::string ONE_CHAR_OPS = "()!~+-*/%<>&|^";
+
+        size_t iChar = 0;
+        while (iChar < condition.size())
+        {
+            char c = condition.at(iChar);
+
+            if (std::isspace(static_cast<unsigned char>(c)))
+            {
+                ++iChar;
+            }
+            else if (IsIdentifierStart(c) || std::isdigit(static_cast<unsigned char>(c)))
+            {
+                // Numbers may contain suffixes and digit separators, which ParseNumber handles.
+                size_t iEnd = iChar + 1;
+                while (iEnd < condition.size()
+                    && (IsIdentifierChar(condition.at(iEnd)) || condition.at(iEnd) == '\''))
+                {
+                    ++iEnd;
+                }
+
+                tokens.push_back(condition.substr(iChar, iEnd - iChar));
+                iChar = iEnd;
+            }
+            else if (std::find(TWO_CHAR_OPS.begin(), TWO_CHAR_OPS.end(), condition.substr(iChar, 2)) != TWO_CHAR_OPS.end())
+            {
+                tokens.push_back(condition.substr(iChar, 2));
+                iChar += 2;
+            }
+            else if (ONE_CHAR_OPS.find(c) != std::string::npos)
+            {
+                tokens.push_back(std::string(1, c));
+                ++iChar;
+            }
+            else
+            {
+                // Unsupported syntax, such as character literals or the ternary operator.
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    int ConditionEvaluator::GetInfixPrecedence(const std::string& op)
+    {
+        static const std::unordered_map<std::string, int> PRECEDENCE_BY_OP = {
+            { "||", 1 },
+            { "&&", 2 },
+            { "|", 3 },
+            { "^", 4 },
+            { "&", 5 },
+            { "==", 6 }, { "!=", 6 },
+            { "<", 7 }, { "<=", 7 }, { ">", 7 }, { ">=", 7 },
+            { "<<", 8 }, { ">>", 8 },
+            { "+", 9 }, { "-", 9 },
+            { "*", 10 }, { "/", 10 }, { "%", 10 },
+        };
+
+        auto it = PRECEDENCE_BY_OP.find(op);
+        if (it != PRECEDENCE_BY_OP.end())
+        {
+            return it->second;
+        }
+
+        // Not an infix operator.
+        return -1;
+    }
+
+    bool ConditionEvaluator::ParseNumber(const std::string& str, int64_t& value)
+    {
+        std::string digits;
+        for (char c : str)
+        {
+            if (c != '\'')
+            {
+                digits += c;
+            }
+        }
+
+        // Remove integer suffixes, such as in 1L or 2ull.
+        while (!digits.empty() && std::string("uUlL").find(digits.back()) != std::string::npos)
+        {
+            digits.pop_back();
+        }
+
+        if (digits.empty() || !std::isdigit(static_cast<unsigned char>(digits.front())))
+        {
+            return false;
+        }
+
+        int base = 0;
+        size_t iStart = 0;
+        if (digits.size() > 2 && digits.at(0) == '0' && (digits.at(1) == 'b' || digits.at(1) == 'B'))
+        {
+            base = 2;
+            iStart = 2;
+        }
+
+        const char* pStart = digits.c_str() + iStart;
+        char* pEnd = nullptr;
+
+        errno = 0;
+        long long result = std::strtoll(pStart, &pEnd, base);
+        if (errno != 0 || pEnd == pStart || *pEnd != '\0')
+        {
+            return false;
+        }
+
+        value = static_cast<int64_t>(result);
+        return true;
+    }
+
+    bool ConditionEvaluator::IsIdentifierStart(char c)
+    {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool ConditionEvaluator::IsIdentifierChar(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+}
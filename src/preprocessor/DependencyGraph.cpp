@@ -3,49 +3,93 @@
 #include "hscpp/preprocessor/DependencyGraph.h"
 #include "hscpp/Util.h"
 
-#include <iostream>
-
 namespace hscpp
 {
 
+    static void InsertSorted(std::vector<int>& handles, int handle)
+    {
+        auto it = std::lower_bound(handles.begin(), handles.end(), handle);
+        if (it == handles.end() || *it != handle)
+        {
+            handles.insert(it, handle);
+        }
+    }
+
+    static void EraseSorted(std::vector<int>& handles, int handle)
+    {
+        auto it = std::lower_bound(handles.begin(), handles.end(), handle);
+        if (it != handles.end() && *it == handle)
+        {
+            handles.erase(it);
+        }
+    }
+
     std::vector<hscpp::fs::path> DependencyGraph::ResolveGraph(const fs::path& filePath)
     {
-        std::unordered_set<int> collectedDependentHandles;
-        std::unordered_set<int> collectedDependencyHandles;
+        return ResolveGraph(std::vector<fs::path>{ filePath });
+    }
 
-        int fileHandle = GetHandle(filePath);
+    std::vector<hscpp::fs::path> DependencyGraph::ResolveGraph(const std::vector<fs::path>& filePaths)
+    {
+        std::vector<int> fileHandles;
+        for (const auto& filePath : filePaths)
+        {
+            fileHandles.push_back(GetHandle(filePath));
+        }
 
-        // When compiling a module, add dependents of that module must also be compiled.
-        if (IsModule(fileHandle))
+        CompressEdges();
+        FindTrackedClasses();
+
+        // When compiling a module, add dependents of that module must also be compiled. Other
+        // modules of files within that module are unaffected, and so are not expanded.
+        Traversal dependents = CreateTraversal(false);
+        for (int fileHandle : fileHandles)
         {
-            CollectDependents(fileHandle, collectedDependentHandles);
+            if (!m_Nodes.at(fileHandle).moduleHandles.empty())
+            {
+                Visit(fileHandle, dependents);
+            }
         }
 
+        Collect(m_Dependents, dependents);
+
         // We want to compile all dependencies that are modules. If we have any dependents, their
-        // dependencies must also be added to the compilation list.
-        CollectDependencies(fileHandle, collectedDependencyHandles);
-        for (int collectedDependentHandle : collectedDependentHandles)
+        // dependencies must also be added to the compilation list. Since every dependent is a
+        // starting point of this traversal, the collected dependencies include all dependents.
+        // Every compiled file must be able to link, so the modules of all files are expanded.
+        Traversal dependencies = CreateTraversal(true);
+        for (int fileHandle : fileHandles)
         {
-            CollectDependencies(collectedDependentHandle, collectedDependencyHandles);
+            Visit(fileHandle, dependencies);
         }
 
-        std::unordered_set<int> collectedHandles;
-        collectedHandles.insert(collectedDependentHandles.begin(), collectedDependentHandles.end());
-        collectedHandles.insert(collectedDependencyHandles.begin(), collectedDependencyHandles.end());
+        for (int collectedDependentHandle : dependents.collectedHandles)
+        {
+            if (!m_bCompileOnlyTrackedDependents || m_bIncludesTrackedClass[collectedDependentHandle])
+            {
+                Visit(collectedDependentHandle, dependencies);
+            }
+        }
+
+        Collect(m_Dependencies, dependencies);
 
         std::vector<fs::path> resolvedFilePaths;
-        for (const auto& collectedHandle : collectedHandles)
+        for (int collectedHandle : dependencies.collectedHandles)
         {
-            fs::path collectedFilePath = GetFilepath(collectedHandle);
-            if (util::IsSourceFile(collectedFilePath))
+            if (m_Nodes.at(collectedHandle).bSourceFile)
             {
-                resolvedFilePaths.push_back(collectedFilePath);
+                resolvedFilePaths.push_back(m_FilePathByHandle.at(collectedHandle));
             }
         }
 
         return resolvedFilePaths;
     }
 
+    void DependencyGraph::SetCompileOnlyTrackedDependents(bool bCompileOnlyTrackedDependents)
+    {
+        m_bCompileOnlyTrackedDependents = bCompileOnlyTrackedDependents;
+    }
+
     void DependencyGraph::SetLinkedModules(const fs::path& filePath, const std::vector<std::string>& modules)
     {
         int handle = GetHandle(filePath);
@@ -54,259 +98,300 @@ namespace hscpp
         RemoveLinkedModule(handle);
 
         // Add new links.
-        if (!modules.empty())
+        for (const auto& module : modules)
         {
-            for (const auto& module : modules)
-            {
-                m_ModulesByHandle[handle].insert(module);
-                m_HandlesByModule[module].insert(handle);
-            }
+            int moduleHandle = GetModuleHandle(module);
+
+            InsertSorted(m_Nodes.at(handle).moduleHandles, moduleHandle);
+            InsertSorted(m_HandlesByModuleHandle.at(moduleHandle), handle);
         }
+
+        m_bTrackedClassesStale = true;
     }
 
     void DependencyGraph::SetFileDependencies(const fs::path& filePath, const std::vector<fs::path>& dependencies)
     {
         int fileHandle = GetHandle(filePath);
 
-        Node* pNode = GetNode(fileHandle);
-        if (pNode == nullptr)
-        {
-            pNode = CreateNode(filePath);
-        }
-
         // Remove reference to self from old dependencies.
-        for (int dependencyHandle : pNode->dependencyHandles)
-        {
-            Node* pDependency = GetNode(dependencyHandle);
-            pDependency->dependentHandles.erase(fileHandle);
-        }
+        RemoveDependencies(fileHandle);
 
         // Add reference to self to new dependencies.
-        pNode->dependencyHandles = AsHandleSet(dependencies);
-        for (int dependencyHandle : pNode->dependencyHandles)
+        std::vector<int> dependencyHandles;
+        for (const auto& dependency : dependencies)
         {
-            Node* pDependency = GetNode(dependencyHandle);
-            if (pDependency == nullptr)
-            {
-                pDependency = CreateNode(dependencyHandle);
-            }
+            dependencyHandles.push_back(GetHandle(dependency));
+        }
+
+        std::sort(dependencyHandles.begin(), dependencyHandles.end());
+        dependencyHandles.erase(std::unique(dependencyHandles.begin(), dependencyHandles.end()),
+            dependencyHandles.end());
 
-            pDependency->dependentHandles.insert(fileHandle);
+        for (int dependencyHandle : dependencyHandles)
+        {
+            InsertSorted(m_Nodes.at(dependencyHandle).dependentHandles, fileHandle);
         }
+
+        m_Nodes.at(fileHandle).dependencyHandles = std::move(dependencyHandles);
+        m_bCompressedEdgesStale = true;
     }
 
     void DependencyGraph::RemoveFile(const fs::path& filePath)
     {
-        int fileHandle = GetHandle(filePath);
-
-        Node* pNode = GetNode(fileHandle);
-        if (pNode == nullptr)
+        auto it = m_HandleByFilePath.find(filePath);
+        if (it == m_HandleByFilePath.end())
         {
             // File is not part of dependency graph.
             return;
         }
 
+        int fileHandle = it->second;
+        Node& node = m_Nodes.at(fileHandle);
+
         // Remove reference to self from old dependencies.
-        for (int dependencyHandle : pNode->dependencyHandles)
-        {
-            Node* pDependency = GetNode(dependencyHandle);
-            pDependency->dependentHandles.erase(fileHandle);
-        }
+        RemoveDependencies(fileHandle);
 
         // Remove reference to self from old dependents.
-        for (int dependentHandle : pNode->dependentHandles)
+        for (int dependentHandle : node.dependentHandles)
         {
-            Node* pDependent = GetNode(dependentHandle);
-            pDependent->dependencyHandles.erase(fileHandle);
+            EraseSorted(m_Nodes.at(dependentHandle).dependencyHandles, fileHandle);
         }
 
-        m_NodeByHandle.erase(m_NodeByHandle.find(fileHandle));
+        node.dependentHandles.clear();
+        m_bCompressedEdgesStale = true;
+
         RemoveLinkedModule(fileHandle);
     }
 
     void DependencyGraph::Clear()
     {
-        m_HandlesByModule.clear();
-        m_ModulesByHandle.clear();
+        m_Nodes.clear();
         m_FilePathByHandle.clear();
         m_HandleByFilePath.clear();
-        m_NodeByHandle.clear();
+        m_HandlesByModuleHandle.clear();
+        m_bTrackedModules.clear();
+        m_ModuleHandleByModule.clear();
+
+        m_Dependencies = CompressedEdges();
+        m_Dependents = CompressedEdges();
+        m_bCompressedEdgesStale = true;
     }
 
-    void DependencyGraph::Collect(int handle,
-            std::unordered_set<int>& collectedHandles, const std::function<void(Node*)>& cb)
+    void DependencyGraph::Collect(const CompressedEdges& edges, Traversal& traversal)
     {
-        if (collectedHandles.find(handle) != collectedHandles.end())
+        // Traverse with an explicit stack, as deep include chains could overflow the call stack.
+        while (!traversal.stack.empty())
         {
-            return;
+            int handle = traversal.stack.back();
+            traversal.stack.pop_back();
+
+            if (traversal.bExpandAllModules)
+            {
+                ExpandModules(handle, traversal);
+            }
+
+            int iEnd = edges.offsets[handle + 1];
+            for (int i = edges.offsets[handle]; i < iEnd; ++i)
+            {
+                Visit(edges.edgeHandles[i], traversal);
+            }
         }
+    }
 
-        std::vector<int> linkedHandles;
+    void DependencyGraph::Visit(int handle, Traversal& traversal)
+    {
+        if (traversal.bCollected[handle])
+        {
+            return;
+        }
 
-        bool bModule = IsModule(handle);
-        if (bModule)
+        if (m_Nodes[handle].moduleHandles.empty())
         {
-            linkedHandles = GetLinkedModuleHandles(handle);
+            Push(handle, traversal);
         }
         else
         {
-            linkedHandles = { handle };
+            ExpandModules(handle, traversal);
         }
+    }
 
-        for (const int linkedHandle : linkedHandles)
+    void DependencyGraph::Push(int handle, Traversal& traversal)
+    {
+        if (!traversal.bCollected[handle])
         {
-            if (collectedHandles.find(linkedHandle) == collectedHandles.end())
-            {
-                collectedHandles.insert(linkedHandle);
-                Node* pNode = GetNode(linkedHandle);
-                if (pNode != nullptr)
-                {
-                    cb(pNode);
-                }
-            }
+            traversal.bCollected[handle] = true;
+            traversal.collectedHandles.push_back(handle);
+            traversal.stack.push_back(handle);
         }
     }
 
-    void DependencyGraph::CollectDependencies(int handle, std::unordered_set<int>& collectedHandles)
+    void DependencyGraph::ExpandModules(int handle, Traversal& traversal)
     {
-        Collect(handle, collectedHandles, [&](Node* pNode) {
-            for (int dependencyHandle : pNode->dependencyHandles)
+        // All files within a module are linked, and must be collected together.
+        for (int moduleHandle : m_Nodes[handle].moduleHandles)
+        {
+            if (!traversal.bCollectedModules[moduleHandle])
             {
-                CollectDependencies(dependencyHandle, collectedHandles);
+                traversal.bCollectedModules[moduleHandle] = true;
+                for (int linkedHandle : m_HandlesByModuleHandle[moduleHandle])
+                {
+                    Push(linkedHandle, traversal);
+                }
             }
-        });
+        }
     }
 
-    void DependencyGraph::CollectDependents(int handle, std::unordered_set<int>& collectedHandles)
+    DependencyGraph::Traversal DependencyGraph::CreateTraversal(bool bExpandAllModules)
     {
-        Collect(handle, collectedHandles, [&](Node* pNode) {
-            for (int dependentHandle : pNode->dependentHandles)
-            {
-                CollectDependents(dependentHandle, collectedHandles);
-            }
-        });
+        Traversal traversal;
+        traversal.bExpandAllModules = bExpandAllModules;
+        traversal.bCollected.resize(m_Nodes.size());
+        traversal.bCollectedModules.resize(m_HandlesByModuleHandle.size());
+
+        return traversal;
     }
 
-    bool DependencyGraph::IsModule(int handle)
+    void DependencyGraph::CompressEdges()
     {
-        auto it = m_ModulesByHandle.find(handle);
-        if (it != m_ModulesByHandle.end())
+        if (m_bCompressedEdgesStale)
         {
-            return !m_ModulesByHandle.empty();
-        }
+            CompressEdges(&Node::dependencyHandles, m_Dependencies);
+            CompressEdges(&Node::dependentHandles, m_Dependents);
 
-        return false;
+            m_bCompressedEdgesStale = false;
+            m_bTrackedClassesStale = true;
+        }
     }
 
-    std::vector<int> DependencyGraph::GetLinkedModuleHandles(int handle)
+    void DependencyGraph::FindTrackedClasses()
     {
-        std::unordered_set<int> linkedHandles;
+        if (!m_bCompileOnlyTrackedDependents || !m_bTrackedClassesStale)
+        {
+            return;
+        }
 
-        auto modulesIt = m_ModulesByHandle.find(handle);
-        if (modulesIt != m_ModulesByHandle.end())
+        // Walk from each tracked file to every file that includes it. Modules are not expanded, as
+        // linking to a tracked file does not make its class visible.
+        Traversal traversal = CreateTraversal(false);
+        for (int handle = 0; handle < static_cast<int>(m_Nodes.size()); ++handle)
         {
-            for (const std::string& module : modulesIt->second)
+            if (IsTracked(handle))
             {
-                auto linkedHandlesIt = m_HandlesByModule.find(module);
-                if (linkedHandlesIt != m_HandlesByModule.end())
-                {
-                    for (const auto& linkedHandle : linkedHandlesIt->second)
-                    {
-                        linkedHandles.insert(linkedHandle);
-                    }
-                }
+                Push(handle, traversal);
             }
         }
 
-        return std::vector<int>(linkedHandles.begin(), linkedHandles.end());
-    }
-
-    void DependencyGraph::RemoveLinkedModule(int handle)
-    {
-        auto oldModulesIt = m_ModulesByHandle.find(handle);
-        if (oldModulesIt != m_ModulesByHandle.end())
+        while (!traversal.stack.empty())
         {
-            // Create copy, to allow deletion during iteration.
-            std::unordered_set<std::string> oldModulesCopy = oldModulesIt->second;
+            int handle = traversal.stack.back();
+            traversal.stack.pop_back();
 
-            // Remove all previously linked modules associated with this handle.
-            m_ModulesByHandle.erase(oldModulesIt);
-
-            // Remove stale handles.
-            for (const auto& oldModule : oldModulesCopy)
+            int iEnd = m_Dependents.offsets[handle + 1];
+            for (int i = m_Dependents.offsets[handle]; i < iEnd; ++i)
             {
-                m_HandlesByModule[oldModule].erase(handle);
+                Push(m_Dependents.edgeHandles[i], traversal);
             }
         }
+
+        m_bIncludesTrackedClass = std::move(traversal.bCollected);
+        m_bTrackedClassesStale = false;
     }
 
-    int DependencyGraph::CreateHandle(const fs::path& filePath)
+    void DependencyGraph::CompressEdges(std::vector<int> Node::* pEdgeHandles, CompressedEdges& edges)
     {
-        int handle = m_NextHandle;
-        ++m_NextHandle;
+        edges.offsets.clear();
+        edges.edgeHandles.clear();
 
-        m_HandleByFilePath[filePath] = handle;
-        m_FilePathByHandle[handle] = filePath;
+        edges.offsets.reserve(m_Nodes.size() + 1);
+        edges.offsets.push_back(0);
 
-        return handle;
+        for (const auto& node : m_Nodes)
+        {
+            const std::vector<int>& edgeHandles = node.*pEdgeHandles;
+            edges.edgeHandles.insert(edges.edgeHandles.end(), edgeHandles.begin(), edgeHandles.end());
+            edges.offsets.push_back(static_cast<int>(edges.edgeHandles.size()));
+        }
     }
 
-    int DependencyGraph::GetHandle(const fs::path& filePath)
+    bool DependencyGraph::IsTracked(int handle)
     {
-        auto it = m_HandleByFilePath.find(filePath);
-        if (it != m_HandleByFilePath.end())
+        for (int moduleHandle : m_Nodes[handle].moduleHandles)
         {
-            return it->second;
+            if (m_bTrackedModules[moduleHandle])
+            {
+                return true;
+            }
         }
 
-        return CreateHandle(filePath);
+        return false;
     }
 
-    hscpp::DependencyGraph::Node* DependencyGraph::CreateNode(const fs::path& filePath)
+    void DependencyGraph::RemoveLinkedModule(int handle)
     {
-        int handle = GetHandle(filePath);
-        return CreateNode(handle);
-    }
+        Node& node = m_Nodes.at(handle);
 
-    hscpp::DependencyGraph::Node* DependencyGraph::CreateNode(int handle)
-    {
-        m_NodeByHandle[handle] = std::unique_ptr<Node>(new Node());
+        // Remove stale handles.
+        for (int moduleHandle : node.moduleHandles)
+        {
+            EraseSorted(m_HandlesByModuleHandle.at(moduleHandle), handle);
+        }
 
-        Node* pNode = m_NodeByHandle[handle].get();
-        return pNode;
+        node.moduleHandles.clear();
+        m_bTrackedClassesStale = true;
     }
 
-    hscpp::DependencyGraph::Node* DependencyGraph::GetNode(int handle)
+    void DependencyGraph::RemoveDependencies(int handle)
     {
-        auto it = m_NodeByHandle.find(handle);
-        if (it != m_NodeByHandle.end())
+        Node& node = m_Nodes.at(handle);
+
+        for (int dependencyHandle : node.dependencyHandles)
         {
-            return it->second.get();
+            EraseSorted(m_Nodes.at(dependencyHandle).dependentHandles, handle);
         }
 
-        return nullptr;
+        node.dependencyHandles.clear();
+        m_bCompressedEdgesStale = true;
     }
 
-    hscpp::fs::path DependencyGraph::GetFilepath(int handle)
+    int DependencyGraph::GetHandle(const fs::path& filePath)
     {
-        auto it = m_FilePathByHandle.find(handle);
-        if (it != m_FilePathByHandle.end())
+        auto it = m_HandleByFilePath.find(filePath);
+        if (it != m_HandleByFilePath.end())
         {
             return it->second;
         }
 
-        return fs::path();
+        int handle = static_cast<int>(m_Nodes.size());
+
+        Node node;
+        node.bSourceFile = util::IsSourceFile(filePath);
+
+        m_Nodes.push_back(std::move(node));
+        m_FilePathByHandle.push_back(filePath);
+        m_HandleByFilePath[filePath] = handle;
+
+        m_bCompressedEdgesStale = true;
+
+        return handle;
     }
 
-    std::unordered_set<int> DependencyGraph::AsHandleSet(const std::vector<fs::path>& paths)
+    int DependencyGraph::GetModuleHandle(const std::string& module)
     {
-        std::unordered_set<int> handleSet;
-        for (const auto& path : paths)
+        auto it = m_ModuleHandleByModule.find(module);
+        if (it != m_ModuleHandleByModule.end())
         {
-            handleSet.insert(GetHandle(path));
+            return it->second;
         }
 
-        return handleSet;
+        int moduleHandle = static_cast<int>(m_HandlesByModuleHandle.size());
+
+        m_HandlesByModuleHandle.emplace_back();
+        m_ModuleHandleByModule[module] = moduleHandle;
+
+        // The Parser names the module of a HSCPP_TRACK "@" followed by its key.
+        m_bTrackedModules.push_back(!module.empty() && module.front() == '@');
+
+        return moduleHandle;
     }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,250 @@
+#include <fstream>
+
+#include "hscpp/preprocessor/DependencyGraphCache.h"
+#include "hscpp/Log.h"
+
+namespace hscpp
+{
+
+    const static char CACHE_MAGIC[4] = { 'H', 'S', 'D', 'G' };
+    const static uint32_t CACHE_VERSION = 1;
+
+    // Reject absurd lengths in corrupt files, rather than attempting huge allocations.
+    const static uint32_t MAX_STRING_LENGTH = 64 * 1024;
+
+    static void WriteU32(std::ofstream& file, uint32_t value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static void WriteU64(std::ofstream& file, uint64_t value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static void WriteString(std::ofstream& file, const std::string& str)
+    {
+        WriteU32(file, static_cast<uint32_t>(str.size()));
+        file.write(str.data(), str.size());
+    }
+
+    static void WriteStrings(std::ofstream& file, const std::vector<std::string>& strs)
+    {
+        WriteU32(file, static_cast<uint32_t>(strs.size()));
+        for (const auto& str : strs)
+        {
+            WriteString(file, str);
+        }
+    }
+
+    static bool ReadU32(std::ifstream& file, uint32_t& value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+    static bool ReadU64(std::ifstream& file, uint64_t& value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+
+    static bool ReadString(std::ifstream& file, std::string& str, uint32_t maxLength = MAX_STRING_LENGTH)
+    {
+        uint32_t length = 0;
+        if (!ReadU32(file, length) || length > maxLength)
+        {
+            return false;
+        }
+
+        str.resize(length);
+        return length == 0 || static_cast<bool>(file.read(&str[0], length));
+    }
+
+    static bool ReadStrings(std::ifstream& file, std::vector<std::string>& strs)
+    {
+        uint32_t count = 0;
+        if (!ReadU32(file, count) || count > MAX_STRING_LENGTH)
+        {
+            return false;
+        }
+
+        strs.resize(count);
+        for (auto& str : strs)
+        {
+            if (!ReadString(file, str))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool DependencyGraphCache::Load(const fs::path& cachePath, const std::string& varsKey)
+    {
+        m_EntriesByPath.clear();
+
+        std::ifstream file(cachePath.u8string(), std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        char magic[sizeof(CACHE_MAGIC)] = {};
+        uint32_t version = 0;
+        std::string savedVarsKey;
+        uint32_t nEntries = 0;
+
+        // A saved variables key of any other length cannot match, so the current key's length
+        // bounds the read.
+        if (!file.read(magic, sizeof(magic))
+            || !std::equal(magic, magic + sizeof(magic), CACHE_MAGIC)
+            || !ReadU32(file, version) || version != CACHE_VERSION
+            || !ReadString(file, savedVarsKey, static_cast<uint32_t>(varsKey.size()))
+            || savedVarsKey != varsKey
+            || !ReadU32(file, nEntries))
+        {
+            // Cache is from another version, or was built with different variables.
+            return false;
+        }
+
+        std::unordered_map<fs::path, Entry, FsPathHasher> entriesByPath;
+        for (uint32_t i = 0; i < nEntries; ++i)
+        {
+            std::string filePath;
+            uint64_t modificationTime = 0;
+            Entry entry;
+            std::vector<std::string> includeDirectoryPaths;
+
+            if (!ReadString(file, filePath)
+                || !ReadU64(file, modificationTime)
+                || !ReadU64(file, entry.stamp.size)
+                || !ReadStrings(file, entry.modules)
+                || !ReadStrings(file, entry.includes)
+                || !ReadStrings(file, includeDirectoryPaths))
+            {
+                log::Warning() << HSCPP_LOG_PREFIX << "Dependency graph cache "
+                    << cachePath << " is corrupt; ignoring it." << log::End();
+                return false;
+            }
+
+            entry.stamp.modificationTime = static_cast<int64_t>(modificationTime);
+            for (const auto& includeDirectoryPath : includeDirectoryPaths)
+            {
+                entry.includeDirectoryPaths.push_back(fs::u8path(includeDirectoryPath));
+            }
+
+            entriesByPath[fs::u8path(filePath)] = std::move(entry);
+        }
+
+        m_EntriesByPath = std::move(entriesByPath);
+        return true;
+    }
+
+    bool DependencyGraphCache::Save(const fs::path& cachePath, const std::string& varsKey)
+    {
+        // Write to a temporary file first, so that an interrupted save leaves the old cache intact.
+        fs::path tempCachePath = cachePath;
+        tempCachePath += ".tmp";
+
+        {
+            std::ofstream file(tempCachePath.u8string(), std::ios::binary | std::ios::trunc);
+            if (!file.is_open())
+            {
+                log::Error() << HSCPP_LOG_PREFIX << "Failed to open dependency graph cache "
+                    << tempCachePath << log::End(".");
+                return false;
+            }
+
+            file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            WriteU32(file, CACHE_VERSION);
+            WriteString(file, varsKey);
+            WriteU32(file, static_cast<uint32_t>(m_EntriesByPath.size()));
+
+            for (const auto& filePath__entry : m_EntriesByPath)
+            {
+                const Entry& entry = filePath__entry.second;
+
+                std::vector<std::string> includeDirectoryPaths;
+                for (const auto& includeDirectoryPath : entry.includeDirectoryPaths)
+                {
+                    includeDirectoryPaths.push_back(includeDirectoryPath.u8string());
+                }
+
+                WriteString(file, filePath__entry.first.u8string());
+                WriteU64(file, static_cast<uint64_t>(entry.stamp.modificationTime));
+                WriteU64(file, entry.stamp.size);
+                WriteStrings(file, entry.modules);
+                WriteStrings(file, entry.includes);
+                WriteStrings(file, includeDirectoryPaths);
+            }
+
+            if (!file.good())
+            {
+                log::Error() << HSCPP_LOG_PREFIX << "Failed to write dependency graph cache "
+                    << tempCachePath << log::End(".");
+                return false;
+            }
+        }
+
+        std::error_code error;
+        fs::rename(tempCachePath, cachePath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            log::Error() << HSCPP_LOG_PREFIX << "Failed to replace dependency graph cache "
+                << cachePath << ". " << log::OsError(error) << log::End();
+            return false;
+        }
+
+        return true;
+    }
+
+    const DependencyGraphCache::Entry* DependencyGraphCache::Find(const fs::path& filePath, const FileStamp& stamp) const
+    {
+        auto entryIt = m_EntriesByPath.find(filePath);
+        if (entryIt == m_EntriesByPath.end()
+            || entryIt->second.stamp.modificationTime != stamp.modificationTime
+            || entryIt->second.stamp.size != stamp.size)
+        {
+            return nullptr;
+        }
+
+        return &entryIt->second;
+    }
+
+    void DependencyGraphCache::Set(const fs::path& filePath, const Entry& entry)
+    {
+        m_EntriesByPath[filePath] = entry;
+    }
+
+    void DependencyGraphCache::Remove(const fs::path& filePath)
+    {
+        m_EntriesByPath.erase(filePath);
+    }
+
+    void DependencyGraphCache::Clear()
+    {
+        m_EntriesByPath.clear();
+    }
+
+    bool DependencyGraphCache::GetFileStamp(const fs::path& filePath, FileStamp& stamp)
+    {
+        std::error_code error;
+        auto modificationTime = fs::last_write_time(filePath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            return false;
+        }
+
+        uint64_t size = fs::file_size(filePath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            return false;
+        }
+
+        stamp.modificationTime = static_cast<int64_t>(modificationTime.time_since_epoch().count());
+        stamp.size = size;
+
+        return true;
+    }
+
+}
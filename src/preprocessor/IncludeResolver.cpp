@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <iterator>
+
+#include "hscpp/preprocessor/IncludeResolver.h"
+
+namespace hscpp
+{
+
+    bool IncludeResolver::Resolve(const fs::path& includeDirectoryPath, const std::string& include, fs::path& canonicalPath)
+    {
+        std::string key = includeDirectoryPath.u8string() + '\0' + include;
+        fs::path includePath = fs::u8path(include);
+
+        bool bCachedMiss = false;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            auto resolutionIt = m_ResolutionsByKey.find(key);
+            if (resolutionIt != m_ResolutionsByKey.end())
+            {
+                canonicalPath = resolutionIt->second.canonicalPath;
+                if (resolutionIt->second.bFound)
+                {
+                    return true;
+                }
+
+                bCachedMiss = true;
+            }
+        }
+
+        // Include directories need not be watched, and a file reached through a symlink is never
+        // named by file events. Confirm a miss, so that a file created since is found.
+        if (bCachedMiss && !fs::exists(includeDirectoryPath / includePath))
+        {
+            return false;
+        }
+
+        // Resolve without holding the lock, as this may touch the filesystem.
+        Resolution resolution;
+        resolution.bFound = ResolveUncached(includeDirectoryPath, includePath, resolution.canonicalPath);
+
+        canonicalPath = resolution.canonicalPath;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_ResolutionsByKey.emplace(key, resolution).second)
+        {
+            m_KeysByFileName[FoldName(includePath.filename().u8string())].push_back(key);
+        }
+        else
+        {
+            m_ResolutionsByKey[key] = resolution;
+        }
+
+        return resolution.bFound;
+    }
+
+    void IncludeResolver::Invalidate(const fs::path& canonicalFilePath, bool bExists)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        std::string fileName = FoldName(canonicalFilePath.filename().u8string());
+
+        auto keysIt = m_KeysByFileName.find(fileName);
+        if (keysIt != m_KeysByFileName.end())
+        {
+            for (const auto& key : keysIt->second)
+            {
+                m_ResolutionsByKey.erase(key);
+            }
+
+            m_KeysByFileName.erase(keysIt);
+        }
+
+        // A created file may also have created its parent directories, so any ancestor listing
+        // that is missing the next path component is stale. A removed file only affects its
+        // parent's listing.
+        fs::path childPath = canonicalFilePath;
+        fs::path directoryPath = canonicalFilePath.parent_path();
+        while (!directoryPath.empty() && directoryPath != childPath)
+        {
+            auto namesIt = m_NamesByDirectoryPath.find(directoryPath);
+            if (namesIt != m_NamesByDirectoryPath.end())
+            {
+                bool bListed = (namesIt->second.count(FoldName(childPath.filename().u8string())) != 0);
+                if (bListed != bExists)
+                {
+                    m_NamesByDirectoryPath.erase(namesIt);
+                }
+            }
+
+            if (!bExists)
+            {
+                break;
+            }
+
+            childPath = directoryPath;
+            directoryPath = directoryPath.parent_path();
+        }
+    }
+
+    void IncludeResolver::Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        m_ResolutionsByKey.clear();
+        m_KeysByFileName.clear();
+        m_CanonicalDirectoryPaths.clear();
+        m_NamesByDirectoryPath.clear();
+    }
+
+    bool IncludeResolver::ResolveUncached(const fs::path& includeDirectoryPath,
+        const fs::path& includePath, fs::path& canonicalPath)
+    {
+        // Walk the directory listings for plain relative includes (ex. "lib/Math.h"). Others fall
+        // back to querying the filesystem directly.
+        bool bSimple = includePath.is_relative() && !includePath.empty();
+        for (const auto& component : includePath)
+        {
+            if (component == "." || component == "..")
+            {
+                bSimple = false;
+            }
+        }
+
+        fs::path directoryPath;
+        if (bSimple && GetCanonicalDirectoryPath(includeDirectoryPath, directoryPath))
+        {
+            // Listings are keyed by canonical path, as file events are. Each directory along the
+            // way is canonicalized, in case it is a symlink.
+            bool bListed = true;
+            for (auto componentIt = includePath.begin(); componentIt != includePath.end(); ++componentIt)
+            {
+                if (!DirectoryContains(directoryPath, FoldName(componentIt->u8string())))
+                {
+                    bListed = false;
+                    break;
+                }
+
+                if (std::next(componentIt) != includePath.end()
+                    && !GetCanonicalDirectoryPath(directoryPath / *componentIt, directoryPath))
+                {
+                    bListed = false;
+                    break;
+                }
+            }
+
+            // A listing of a directory that is not watched may be out of date.
+            if (!bListed)
+            {
+                if (!fs::exists(includeDirectoryPath / includePath))
+                {
+                    return false;
+                }
+
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_NamesByDirectoryPath.erase(directoryPath);
+            }
+        }
+        else if (!fs::exists(includeDirectoryPath / includePath))
+        {
+            return false;
+        }
+
+        // Names are compared case-insensitively, so a match must still be confirmed. This also
+        // resolves symlinks.
+        std::error_code error;
+        canonicalPath = fs::canonical(includeDirectoryPath / includePath, error);
+
+        return error.value() == HSCPP_ERROR_SUCCESS;
+    }
+
+    bool IncludeResolver::GetCanonicalDirectoryPath(const fs::path& directoryPath, fs::path& canonicalDirectoryPath)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            auto pathIt = m_CanonicalDirectoryPaths.find(directoryPath);
+            if (pathIt != m_CanonicalDirectoryPaths.end())
+            {
+                canonicalDirectoryPath = pathIt->second;
+                return true;
+            }
+        }
+
+        std::error_code error;
+        canonicalDirectoryPath = fs::canonical(directoryPath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_CanonicalDirectoryPaths.emplace(directoryPath, canonicalDirectoryPath);
+
+        return true;
+    }
+
+    bool IncludeResolver::DirectoryContains(const fs::path& canonicalDirectoryPath, const std::string& name)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            auto namesIt = m_NamesByDirectoryPath.find(canonicalDirectoryPath);
+            if (namesIt != m_NamesByDirectoryPath.end())
+            {
+                return namesIt->second.count(name) != 0;
+            }
+        }
+
+        // A directory that does not exist is listed as empty.
+        std::unordered_set<std::string> names;
+
+        std::error_code error;
+        for (fs::directory_iterator it(canonicalDirectoryPath, error); !error && it != fs::directory_iterator(); it.increment(error))
+        {
+            names.insert(FoldName(it->path().filename().u8string()));
+        }
+
+        bool bContains = (names.count(name) != 0);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_NamesByDirectoryPath.emplace(canonicalDirectoryPath, std::move(names));
+
+        return bContains;
+    }
+
+    std::string IncludeResolver::FoldName(const std::string& name)
+    {
+        // Windows and macOS filesystems are usually case-insensitive. Folding case everywhere can
+        // only produce false matches, which are then rejected by fs::canonical.
+        std::string foldedName = name;
+        std::transform(foldedName.begin(), foldedName.end(), foldedName.begin(), [](char c) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        });
+
+        return foldedName;
+    }
+
+}
@@ -9,8 +9,19 @@ namespace hscpp
 
     bool Interpreter::Evaluate(const Stmt& rootStmt, const VarStore& varStore, Result& result)
     {
-        Reset(varStore, result);
+        Reset(varStore, nullptr, result);
+        return Evaluate(rootStmt);
+    }
 
+    bool Interpreter::Evaluate(const Stmt& rootStmt, const VarStore& varStore,
+        const ConditionEvaluator& conditionEvaluator, Result& result)
+    {
+        Reset(varStore, &conditionEvaluator, result);
+        return Evaluate(rootStmt);
+    }
+
+    bool Interpreter::Evaluate(const Stmt& rootStmt)
+    {
         try
         {
             rootStmt.Accept(*this);
@@ -33,9 +44,10 @@ namespace hscpp
         return m_Error;
     }
 
-    void Interpreter::Reset(const VarStore& varStore, Result& result)
+    void Interpreter::Reset(const VarStore& varStore, const ConditionEvaluator* pConditionEvaluator, Result& result)
     {
         m_pVarStore = &varStore;
+        m_pConditionEvaluator = pConditionEvaluator;
 
         result = Result();
         m_pResult = &result;
@@ -53,6 +65,17 @@ namespace hscpp
 
     void Interpreter::Visit(const IncludeStmt& includeStmt)
     {
+        if (m_pConditionEvaluator != nullptr)
+        {
+            for (const auto& condition : includeStmt.conditions)
+            {
+                if (m_pConditionEvaluator->Evaluate(condition) == ConditionEvaluator::Result::False)
+                {
+                    return;
+                }
+            }
+        }
+
         m_pResult->includePaths.push_back(includeStmt.path);
     }
 
@@ -1,8 +1,20 @@
 #include <fstream>
+#include <algorithm>
+#include <cstring>
 #include <unordered_map>
 
 #include "hscpp/preprocessor/Lexer.h"
 #include "hscpp/Log.h"
+#include "hscpp/Util.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define HSCPP_LEXER_SSE2
+    #include <emmintrin.h>
+
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
 
 namespace hscpp
 {
@@ -25,9 +37,73 @@ namespace hscpp
         { "false", Token::Type::Bool },
     };
 
+    static bool IsCandidate(char c)
+    {
+        // Characters that may begin a comment, a string, an #include, or an hscpp keyword.
+        return c == '"' || c == '/' || c == '#' || c == 'h' || c == 'H';
+    }
+
+    // Find the first candidate character at or after iChar, or return size if there is none.
+    static size_t FindCandidate(const char* pContent, size_t iChar, size_t size)
+    {
+#if defined(HSCPP_LEXER_SSE2)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i slash = _mm_set1_epi8('/');
+        const __m128i hash = _mm_set1_epi8('#');
+        const __m128i lowerH = _mm_set1_epi8('h');
+        const __m128i upperH = _mm_set1_epi8('H');
+
+        // Compare 16 characters at a time. Most of a C++ file contains no candidates at all.
+        while (iChar + 16 <= size)
+        {
+            __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pContent + iChar));
+            __m128i matches = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, slash)),
+                _mm_or_si128(_mm_cmpeq_epi8(chars, hash),
+                    _mm_or_si128(_mm_cmpeq_epi8(chars, lowerH), _mm_cmpeq_epi8(chars, upperH))));
+
+            unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(matches));
+            if (mask != 0)
+            {
+#if defined(_MSC_VER)
+                unsigned long iBit = 0;
+                _BitScanForward(&iBit, mask);
+                return iChar + iBit;
+#else
+                return iChar + __builtin_ctz(mask);
+#endif
+            }
+
+            iChar += 16;
+        }
+#endif
+
+        while (iChar < size && !IsCandidate(pContent[iChar]))
+        {
+            ++iChar;
+        }
+
+        return iChar;
+    }
+
     bool Lexer::Lex(const std::string& content, std::vector<Token>& tokens)
     {
-        Reset(content, tokens);
+        Reset(content.data(), content.size(), tokens);
+
+        try
+        {
+            return Lex();
+        }
+        catch (const std::runtime_error&)
+        {
+            return false;
+        }
+    }
+
+    bool Lexer::LexRelevant(const char* pContent, size_t size, std::vector<Token>& tokens)
+    {
+        Reset(pContent, size, tokens);
+        m_bRelevantOnly = true;
 
         try
         {
@@ -44,9 +120,10 @@ namespace hscpp
         return m_Error;
     }
 
-    void Lexer::Reset(const std::string& content, std::vector<Token>& tokens)
+    void Lexer::Reset(const char* pContent, size_t size, std::vector<Token>& tokens)
     {
-        m_Content = content;
+        m_pContent = pContent;
+        m_ContentSize = size;
         m_iChar = 0;
         m_Column = 0;
         m_Line = 1;
@@ -54,6 +131,10 @@ namespace hscpp
         tokens.clear();
         m_pTokens = &tokens;
 
+        m_bRelevantOnly = false;
+        m_bInStatement = false;
+        m_StatementDepth = 0;
+
         m_Error = LangError(LangError::Code::Success);
     }
 
@@ -61,6 +142,15 @@ namespace hscpp
     {
         while (!IsAtEnd())
         {
+            if (m_bRelevantOnly && !m_bInStatement)
+            {
+                SkipIrrelevant();
+                if (IsAtEnd())
+                {
+                    break;
+                }
+            }
+
             size_t iStartChar = m_iChar;
 
             switch (Peek())
@@ -195,6 +285,10 @@ namespace hscpp
                             LexString('>');
                         }
                     }
+                    else
+                    {
+                        LexConditionalDirective();
+                    }
                     break;
                 case ' ':
                 case '\t':
@@ -235,37 +329,119 @@ namespace hscpp
         return true;
     }
 
-    void Lexer::LexString(char endChar)
+    void Lexer::LexConditionalDirective()
     {
-        size_t startLine = m_Line;
-        std::string str;
-
-        Advance(); // Skip opening '"' or '<'.
+        // Conditions are kept whole, as the value of a single token, so that they can be evaluated
+        // against preprocessor definitions. #ifdef X becomes defined(X), and #ifndef X becomes
+        // !defined(X).
+        if (MatchWord("ifdef"))
+        {
+            PushToken("defined(" + LexDirectiveLine() + ")", Token::Type::If);
+        }
+        else if (MatchWord("ifndef"))
+        {
+            PushToken("!defined(" + LexDirectiveLine() + ")", Token::Type::If);
+        }
+        else if (MatchWord("if"))
+        {
+            PushToken(LexDirectiveLine(), Token::Type::If);
+        }
+        else if (MatchWord("elifdef"))
+        {
+            PushToken("defined(" + LexDirectiveLine() + ")", Token::Type::Elif);
+        }
+        else if (MatchWord("elifndef"))
+        {
+            PushToken("!defined(" + LexDirectiveLine() + ")", Token::Type::Elif);
+        }
+        else if (MatchWord("elif"))
+        {
+            PushToken(LexDirectiveLine(), Token::Type::Elif);
+        }
+        else if (MatchWord("else"))
+        {
+            LexDirectiveLine();
+            PushToken("", Token::Type::Else);
+        }
+        else if (MatchWord("endif"))
+        {
+            LexDirectiveLine();
+            PushToken("", Token::Type::Endif);
+        }
+    }
 
-        while (!IsAtEnd() && Peek() != endChar)
+    std::string Lexer::LexDirectiveLine()
+    {
+        // Read up to the end of the line, joining lines continued with a backslash. Comments are
+        // replaced with a space, as in the C preprocessor.
+        std::string line;
+        while (!IsAtEnd() && Peek() != '\n')
         {
-            if (Peek() == '\\' && PeekNext() == '"')
+            if (Peek() == '\\' && (PeekNext() == '\n' || PeekNext() == '\r'))
             {
-                // Escaped quote.
-                Advance();
-                Advance();
-                str += '"';
+                Advance(); // Skip \.
+                if (Peek() == '\r')
+                {
+                    Advance();
+                }
+
+                Advance(); // Skip \n.
+                line += ' ';
             }
-            else if (Peek() == '\\' && PeekNext() == '\\')
+            else if (Peek() == '/' && PeekNext() == '/')
             {
-                // Escaped slash.
-                Advance();
-                Advance();
-                str += '\\';
+                while (!IsAtEnd() && Peek() != '\n')
+                {
+                    Advance();
+                }
+            }
+            else if (Peek() == '/' && PeekNext() == '*')
+            {
+                SkipComment();
+                line += ' ';
             }
             else
             {
-                // Not handling other escape sequences (ex. \n).
-                str += Peek();
+                line += Peek();
                 Advance();
             }
         }
 
+        return util::Trim(line);
+    }
+
+    void Lexer::LexString(char endChar)
+    {
+        size_t startLine = m_Line;
+
+        bool bHasEscapes = false;
+        size_t iStart = m_iChar + 1; // Skip opening '"' or '<'.
+        size_t iEnd = FindStringEnd(endChar, bHasEscapes);
+
+        // Strings without escape sequences are copied straight from the content.
+        std::string str;
+        if (!bHasEscapes)
+        {
+            str.assign(m_pContent + iStart, iEnd - iStart);
+        }
+        else
+        {
+            str.reserve(iEnd - iStart);
+            for (size_t iChar = iStart; iChar < iEnd; ++iChar)
+            {
+                if (m_pContent[iChar] == '\\' && iChar + 1 < iEnd
+                    && (m_pContent[iChar + 1] == '"' || m_pContent[iChar + 1] == '\\'))
+                {
+                    // Escaped quote or slash. Not handling other escape sequences (ex. \n).
+                    ++iChar;
+                }
+
+                str += m_pContent[iChar];
+            }
+        }
+
+        AdvanceTo(iEnd);
+
         if (Peek() != endChar)
         {
             // Note that error includes start line and beginning of string, to make it easier to
@@ -275,64 +451,230 @@ namespace hscpp
         }
 
         Advance();
-        PushToken(str, Token::Type::String);
+        PushToken(std::move(str), Token::Type::String);
+    }
+
+    size_t Lexer::FindStringEnd(char endChar, bool& bHasEscapes)
+    {
+        bHasEscapes = false;
+
+        size_t iChar = m_iChar + 1;
+        while (iChar < m_ContentSize && m_pContent[iChar] != endChar)
+        {
+            if (m_pContent[iChar] == '\\' && iChar + 1 < m_ContentSize
+                && (m_pContent[iChar + 1] == '"' || m_pContent[iChar + 1] == '\\'))
+            {
+                bHasEscapes = true;
+                iChar += 2;
+            }
+            else
+            {
+                ++iChar;
+            }
+        }
+
+        return iChar;
     }
 
     void Lexer::LexIdentifier()
     {
-        std::string identifier;
+        size_t iStart = m_iChar;
+        size_t iEnd = m_iChar;
 
-        while (IsAlpha(Peek()) || IsDigit(Peek()) || Peek() == '_')
+        while (iEnd < m_ContentSize
+            && (IsAlpha(m_pContent[iEnd]) || IsDigit(m_pContent[iEnd]) || m_pContent[iEnd] == '_'))
         {
-            identifier += Peek();
-            Advance();
+            ++iEnd;
         }
 
+        AdvanceTo(iEnd);
+
+        std::string identifier(m_pContent + iStart, iEnd - iStart);
+
         auto keywordIt = KEYWORDS.find(identifier);
         if (keywordIt != KEYWORDS.end())
         {
-            PushToken(identifier, keywordIt->second);
+            PushToken(std::move(identifier), keywordIt->second);
         }
         else
         {
-            PushToken(identifier, Token::Type::Identifier);
+            PushToken(std::move(identifier), Token::Type::Identifier);
         }
     }
 
     void Lexer::LexNumber()
     {
-        std::string number;
+        size_t iStart = m_iChar;
+        size_t iEnd = m_iChar;
 
-        while (IsDigit(Peek()))
+        while (iEnd < m_ContentSize && IsDigit(m_pContent[iEnd]))
         {
-            number += Peek();
-            Advance();
+            ++iEnd;
         }
 
-        if (Peek() == '.')
+        if (iEnd < m_ContentSize && m_pContent[iEnd] == '.')
         {
-            number += ".";
-            Advance();
+            ++iEnd;
 
-            while (IsDigit(Peek()))
+            while (iEnd < m_ContentSize && IsDigit(m_pContent[iEnd]))
             {
-                number += Peek();
-                Advance();
+                ++iEnd;
             }
         }
 
-        PushToken(number, Token::Type::Number);
+        AdvanceTo(iEnd);
+        PushToken(std::string(m_pContent + iStart, iEnd - iStart), Token::Type::Number);
     }
 
-    void Lexer::PushToken(const std::string& value, Token::Type tokenType)
+    void Lexer::PushToken(std::string value, Token::Type tokenType)
     {
         Token token;
-        token.value = value;
+        token.value = std::move(value);
         token.type = tokenType;
         token.line = m_Line;
         token.column = m_Column;
 
-        m_pTokens->push_back(token);
+        m_pTokens->push_back(std::move(token));
+
+        if (m_bRelevantOnly)
+        {
+            // A statement begins with an #include or hscpp keyword, and ends after the next token,
+            // or after its closing paren if the next token opens one. Conditional directives are
+            // whole statements on their own.
+            if (tokenType >= Token::Type::If && tokenType <= Token::Type::Endif)
+            {
+                m_bInStatement = false;
+            }
+            else if (!m_bInStatement)
+            {
+                m_bInStatement = true;
+                m_StatementDepth = 0;
+            }
+            else
+            {
+                if (tokenType == Token::Type::LeftParen)
+                {
+                    ++m_StatementDepth;
+                }
+                else if (tokenType == Token::Type::RightParen)
+                {
+                    --m_StatementDepth;
+                }
+
+                m_bInStatement = (m_StatementDepth > 0);
+            }
+        }
+    }
+
+    void Lexer::SkipIrrelevant()
+    {
+        size_t iChar = m_iChar;
+        while (true)
+        {
+            iChar = FindCandidate(m_pContent, iChar, m_ContentSize);
+            if (iChar >= m_ContentSize)
+            {
+                AdvanceTo(m_ContentSize);
+                return;
+            }
+
+            char c = m_pContent[iChar];
+            char next = (iChar + 1 < m_ContentSize) ? m_pContent[iChar + 1] : 0;
+
+            if (c == '"')
+            {
+                AdvanceTo(iChar);
+                SkipString('"');
+                iChar = m_iChar;
+            }
+            else if (c == '/')
+            {
+                if (next == '/' || next == '*')
+                {
+                    AdvanceTo(iChar);
+                    SkipComment();
+                    iChar = m_iChar;
+                }
+                else
+                {
+                    ++iChar;
+                }
+            }
+            else if (c == '#')
+            {
+                // Let the full lexer handle a possible #include.
+                AdvanceTo(iChar);
+                return;
+            }
+            else if (!IsTokenStart(iChar))
+            {
+                // An 'h' in the middle of an identifier.
+                ++iChar;
+            }
+            else
+            {
+                size_t iEnd = iChar;
+                while (iEnd < m_ContentSize
+                    && (IsAlpha(m_pContent[iEnd]) || IsDigit(m_pContent[iEnd]) || m_pContent[iEnd] == '_'))
+                {
+                    ++iEnd;
+                }
+
+                if (std::strncmp(m_pContent + iChar, "hscpp_", 6) == 0
+                    || std::strncmp(m_pContent + iChar, "HSCPP_", 6) == 0)
+                {
+                    auto keywordIt = KEYWORDS.find(std::string(m_pContent + iChar, iEnd - iChar));
+                    if (keywordIt != KEYWORDS.end() && keywordIt->second != Token::Type::Bool)
+                    {
+                        // Let the full lexer lex the keyword and the remainder of its statement.
+                        AdvanceTo(iChar);
+                        return;
+                    }
+                }
+
+                iChar = iEnd;
+            }
+        }
+    }
+
+    void Lexer::SkipString(char endChar)
+    {
+        // Same rules as LexString, but without building the string.
+        bool bHasEscapes = false;
+        size_t iEnd = FindStringEnd(endChar, bHasEscapes);
+
+        if (iEnd >= m_ContentSize)
+        {
+            // Unterminated, let LexString report the error.
+            LexString(endChar);
+        }
+
+        AdvanceTo(iEnd + 1);
+    }
+
+    bool Lexer::IsTokenStart(size_t iChar)
+    {
+        // Only called for characters outside of comments and strings. A run of digits is lexed as
+        // a number, so an identifier may start right after one (ex. 1hscpp_module is 1, hscpp_module).
+        while (iChar > 0 && IsDigit(m_pContent[iChar - 1]))
+        {
+            --iChar;
+        }
+
+        return iChar == 0 || !(IsAlpha(m_pContent[iChar - 1]) || m_pContent[iChar - 1] == '_');
+    }
+
+    bool Lexer::MatchWord(const std::string& str)
+    {
+        // Like Match, but str must not be followed by more identifier characters.
+        size_t iEnd = m_iChar + str.size();
+        if (iEnd < m_ContentSize
+            && (IsAlpha(m_pContent[iEnd]) || IsDigit(m_pContent[iEnd]) || m_pContent[iEnd] == '_'))
+        {
+            return false;
+        }
+
+        return Match(str);
     }
 
     bool Lexer::Match(const std::string& str)
@@ -340,9 +682,9 @@ namespace hscpp
         size_t iChar = m_iChar;
         size_t iOffset = 0;
 
-        while (iChar < m_Content.size() && iOffset < str.size())
+        while (iChar < m_ContentSize && iOffset < str.size())
         {
-            if (str.at(iOffset) != m_Content.at(iChar))
+            if (str.at(iOffset) != m_pContent[iChar])
             {
                 return false;
             }
@@ -376,31 +718,40 @@ namespace hscpp
         {
             if (PeekNext() == '/')
             {
-                Advance(); // /
-                Advance(); // /
-                while (!IsAtEnd() && Peek() != '\n')
+                const char* pNewline = static_cast<const char*>(
+                    std::memchr(m_pContent + m_iChar, '\n', m_ContentSize - m_iChar));
+                if (pNewline == nullptr)
                 {
-                    Advance();
+                    AdvanceTo(m_ContentSize);
+                }
+                else
+                {
+                    AdvanceTo(pNewline - m_pContent + 1); // Include \n.
                 }
-                Advance(); // \n
             }
             else if (PeekNext() == '*')
             {
-                Advance(); // /
-                Advance(); // *
-                while (!IsAtEnd())
+                size_t iChar = m_iChar + 2;
+                while (iChar < m_ContentSize)
                 {
-                    if (Peek() == '*' && PeekNext() == '/')
+                    const char* pStar = static_cast<const char*>(
+                        std::memchr(m_pContent + iChar, '*', m_ContentSize - iChar));
+                    if (pStar == nullptr)
                     {
+                        iChar = m_ContentSize;
                         break;
                     }
-                    else
+
+                    iChar = pStar - m_pContent;
+                    if (iChar + 1 < m_ContentSize && m_pContent[iChar + 1] == '/')
                     {
-                        Advance();
+                        break;
                     }
+
+                    ++iChar;
                 }
-                Advance(); // *
-                Advance(); // /
+
+                AdvanceTo(iChar + 2); // Include */.
             }
         }
     }
@@ -417,7 +768,7 @@ namespace hscpp
 
     bool Lexer::IsAtEnd()
     {
-        return m_iChar >= m_Content.size();
+        return m_iChar >= m_ContentSize;
     }
 
     char Lexer::Peek()
@@ -427,17 +778,17 @@ namespace hscpp
             return 0;
         }
 
-        return m_Content.at(m_iChar);
+        return m_pContent[m_iChar];
     }
 
     char Lexer::PeekNext()
     {
-        if (m_iChar + 1 >= m_Content.size())
+        if (m_iChar + 1 >= m_ContentSize)
         {
             return 0;
         }
 
-        return m_Content.at(m_iChar + 1);
+        return m_pContent[m_iChar + 1];
     }
 
     void Lexer::Advance()
@@ -458,6 +809,39 @@ namespace hscpp
         }
     }
 
+    void Lexer::AdvanceTo(size_t iChar)
+    {
+        iChar = std::min(iChar, m_ContentSize);
+
+        // Equivalent to calling Advance until iChar is reached.
+        const char* pLastNewline = nullptr;
+        const char* pSearch = m_pContent + m_iChar;
+        const char* pEnd = m_pContent + iChar;
+        while (pSearch < pEnd)
+        {
+            const char* pNewline = static_cast<const char*>(std::memchr(pSearch, '\n', pEnd - pSearch));
+            if (pNewline == nullptr)
+            {
+                break;
+            }
+
+            ++m_Line;
+            pLastNewline = pNewline;
+            pSearch = pNewline + 1;
+        }
+
+        if (pLastNewline != nullptr)
+        {
+            m_Column = pEnd - (pLastNewline + 1);
+        }
+        else
+        {
+            m_Column += iChar - m_iChar;
+        }
+
+        m_iChar = iChar;
+    }
+
     void Lexer::ThrowError(const LangError& error)
     {
         m_Error = error;
@@ -33,6 +33,7 @@ namespace hscpp
         m_iToken = 0;
 
         m_Scopes = std::stack<std::unique_ptr<BlockStmt>>();
+        m_ConditionalBlocks.clear();
 
         // Last token contains the highest line number in the program. If Peek() returns the default
         // token, make the line number be set to the end of the program.
@@ -259,6 +260,12 @@ namespace hscpp
                 case Token::Type::Include:
                     pBlockStmt->statements.push_back(ParseIncludeStmt());
                     break;
+                case Token::Type::If:
+                case Token::Type::Elif:
+                case Token::Type::Else:
+                case Token::Type::Endif:
+                    ParseConditionalDirective();
+                    break;
                 case Token::Type::HscppIf:
                     pBlockStmt->statements.push_back(ParseHscppIfStmt());
                     break;
@@ -302,9 +309,75 @@ namespace hscpp
         pInclude->path = Peek().value;
         Consume(); // string
 
+        for (const auto& conditionalBlock : m_ConditionalBlocks)
+        {
+            // The current branch is taken when its own condition holds, and none of the previous
+            // branches' conditions did.
+            std::string condition;
+            size_t nPreviousBranches = conditionalBlock.branchConditions.size();
+            if (!conditionalBlock.bElse)
+            {
+                --nPreviousBranches;
+            }
+
+            for (size_t i = 0; i < nPreviousBranches; ++i)
+            {
+                condition += "!(" + conditionalBlock.branchConditions.at(i) + ") && ";
+            }
+
+            if (conditionalBlock.bElse)
+            {
+                condition += "1";
+            }
+            else
+            {
+                condition += "(" + conditionalBlock.branchConditions.back() + ")";
+            }
+
+            pInclude->conditions.push_back(condition);
+        }
+
         return pInclude;
     }
 
+    void Parser::ParseConditionalDirective()
+    {
+        // Conditional directives need not nest with hscpp statements, so they are tracked apart
+        // from the AST. Unbalanced directives are ignored rather than reported, as they are the
+        // business of the C preprocessor.
+        const Token& token = Peek();
+        switch (token.type)
+        {
+            case Token::Type::If:
+                m_ConditionalBlocks.push_back(ConditionalBlock());
+                m_ConditionalBlocks.back().branchConditions.push_back(token.value);
+                break;
+            case Token::Type::Elif:
+                if (!m_ConditionalBlocks.empty() && !m_ConditionalBlocks.back().bElse)
+                {
+                    m_ConditionalBlocks.back().branchConditions.push_back(token.value);
+                }
+                break;
+            case Token::Type::Else:
+                if (!m_ConditionalBlocks.empty())
+                {
+                    m_ConditionalBlocks.back().bElse = true;
+                }
+                break;
+            case Token::Type::Endif:
+                if (!m_ConditionalBlocks.empty())
+                {
+                    m_ConditionalBlocks.pop_back();
+                }
+                break;
+            default:
+                assert(false);
+                break;
+        }
+
+        Consume();
+    }
+
     std::unique_ptr<Stmt> Parser::ParseHscppIfStmt()
     {
         auto pIf = std::unique_ptr<HscppIfStmt>(new HscppIfStmt());
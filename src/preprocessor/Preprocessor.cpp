@@ -1,17 +1,37 @@
 #include <fstream>
-#include <sstream>
 #include <algorithm>
 #include <cassert>
+#include <atomic>
+#include <thread>
 
 #include "hscpp/preprocessor/Preprocessor.h"
 #include "hscpp/preprocessor/Ast.h"
 #include "hscpp/Log.h"
+#include "hscpp/MappedFile.h"
+#include "hscpp/file-watcher/FileHashCache.h"
 
 #include <iostream>
 
 namespace hscpp
 {
 
+    // Spawning a thread is not worth it for fewer files than this.
+    const static size_t MIN_FILES_PER_THREAD = 16;
+
+    // Files at least this large are memory mapped, rather than read into a buffer.
+    const static uint64_t MIN_MAPPED_FILE_SIZE = 64 * 1024;
+
+    Preprocessor::Preprocessor()
+        : Preprocessor(PreprocessorConfig())
+    {}
+
+    Preprocessor::Preprocessor(const PreprocessorConfig& config)
+        : m_Config(config)
+    {
+        m_Workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        m_DependencyGraph.SetCompileOnlyTrackedDependents(m_Config.bCompileOnlyTrackedDependents);
+    }
+
     bool Preprocessor::Preprocess(const std::vector<fs::path>& canonicalFilePaths, IPreprocessor::Output& output)
     {
         Reset(output);
@@ -53,16 +73,38 @@ namespace hscpp
     void Preprocessor::SetVar(const std::string& name, const Variant& value)
     {
         m_VarStore.SetVar(name, value);
+
+        // Cached results may depend on the previous value.
+        m_DependencyGraphCache.Clear();
     }
 
     bool Preprocessor::RemoveVar(const std::string& name)
     {
+        m_DependencyGraphCache.Clear();
         return m_VarStore.RemoveVar(name);
     }
 
+    void Preprocessor::SetPreprocessorDefinitions(const std::vector<std::string>& definitions)
+    {
+        std::string oldKey = m_ConditionEvaluator.GetKey();
+        m_ConditionEvaluator.SetDefinitions(definitions);
+
+        if (m_ConditionEvaluator.GetKey() != oldKey)
+        {
+            // Cached results may include files that are now excluded, or vice versa.
+            m_DependencyGraphCache.Clear();
+
+            std::lock_guard<std::mutex> lock(m_CachedResultsMutex);
+            m_CachedResultsByPath.clear();
+        }
+    }
+
     void Preprocessor::ClearDependencyGraph()
     {
         m_DependencyGraph.Clear();
+
+        // Include directories may not be watched, so start afresh whenever the graph is rebuilt.
+        m_IncludeResolver.Clear();
     }
 
     void Preprocessor::UpdateDependencyGraph(const std::vector<fs::path>& canonicalModifiedFilePaths,
@@ -72,57 +114,205 @@ namespace hscpp
         for (const auto& filePath : canonicalRemovedFilePaths)
         {
             m_DependencyGraph.RemoveFile(filePath);
+            m_DependencyGraphCache.Remove(filePath);
+            m_IncludeResolver.Invalidate(filePath, false);
+
+            std::lock_guard<std::mutex> lock(m_CachedResultsMutex);
+            m_CachedResultsByPath.erase(filePath);
         }
 
+        // Modified files include newly created ones, which may resolve previously missing includes.
         for (const auto& filePath : canonicalModifiedFilePaths)
         {
-            Interpreter::Result result;
-            if (Process(filePath, result))
+            m_IncludeResolver.Invalidate(filePath, true);
+        }
+
+        struct FileUpdate
+        {
+            DependencyGraphCache::FileStamp stamp;
+            bool bHasStamp = false;
+            bool bProcessed = false;
+
+            bool bSucceeded = false;
+            DependencyGraphCache::Entry entry;
+            std::vector<fs::path> canonicalIncludePaths;
+        };
+
+        // Files are processed in parallel, but the dependency graph and cache are only modified
+        // afterwards, on this thread.
+        std::vector<FileUpdate> updates(canonicalModifiedFilePaths.size());
+        ForEachFile(updates.size(), [&](Worker& worker, size_t iFile) {
+            const fs::path& filePath = canonicalModifiedFilePaths.at(iFile);
+            FileUpdate& update = updates.at(iFile);
+
+            update.bHasStamp = DependencyGraphCache::GetFileStamp(filePath, update.stamp);
+
+            const DependencyGraphCache::Entry* pCachedEntry = nullptr;
+            if (update.bHasStamp)
+            {
+                pCachedEntry = m_DependencyGraphCache.Find(filePath, update.stamp);
+            }
+
+            if (pCachedEntry != nullptr)
+            {
+                update.entry = *pCachedEntry;
+                update.bSucceeded = true;
+            }
+            else
+            {
+                update.bProcessed = true;
+                update.bSucceeded = CreateDependencyGraphEntry(worker, filePath, update.entry);
+                update.entry.stamp = update.stamp;
+            }
+
+            if (update.bSucceeded)
+            {
+                update.canonicalIncludePaths = ResolveIncludes(filePath, update.entry, includeDirectoryPaths);
+            }
+        });
+
+        for (size_t i = 0; i < updates.size(); ++i)
+        {
+            const fs::path& filePath = canonicalModifiedFilePaths.at(i);
+            const FileUpdate& update = updates.at(i);
+
+            if (update.bSucceeded)
             {
-                std::vector<fs::path> canonicalIncludePaths;
-                std::vector<fs::path> wholeIncludeDirectoryPaths{ filePath.parent_path() };
-                wholeIncludeDirectoryPaths.insert(wholeIncludeDirectoryPaths.end(), includeDirectoryPaths.begin(), includeDirectoryPaths.end());
+                m_DependencyGraph.SetLinkedModules(filePath, update.entry.modules);
+                m_DependencyGraph.SetFileDependencies(filePath, update.canonicalIncludePaths);
 
-                for (const auto& hscppRequire : result.hscppRequires)
+                if (update.bProcessed && update.bHasStamp)
                 {
-                    for (const auto& value : hscppRequire.values)
-                    {
-                        if (hscppRequire.type == HscppRequire::Type::IncludeDir)
-                        {
-                            fs::path canonicalPath;
-                            if (FormCanonical(filePath, value, canonicalPath)) {
-                                wholeIncludeDirectoryPaths.push_back(canonicalPath);
-                            }
-                        }
-                    }
+                    m_DependencyGraphCache.Set(filePath, update.entry);
                 }
+            }
+        }
+    }
+
+    std::vector<fs::path> Preprocessor::ResolveDependencyGraph(const std::vector<fs::path>& canonicalFilePaths)
+    {
+        return m_DependencyGraph.ResolveGraph(canonicalFilePaths);
+    }
 
-                for (const auto& include : result.includePaths)
+    bool Preprocessor::LoadDependencyGraphCache(const fs::path& cachePath)
+    {
+        return m_DependencyGraphCache.Load(cachePath, GetDependencyGraphCacheKey());
+    }
+
+    bool Preprocessor::SaveDependencyGraphCache(const fs::path& cachePath)
+    {
+        return m_DependencyGraphCache.Save(cachePath, GetDependencyGraphCacheKey());
+    }
+
+    std::string Preprocessor::GetDependencyGraphCacheKey()
+    {
+        std::string key = m_VarStore.GetKey();
+        if (m_Config.bEvaluateConditionalIncludes)
+        {
+            key += '\1' + m_ConditionEvaluator.GetKey();
+        }
+
+        return key;
+    }
+
+    bool Preprocessor::CreateDependencyGraphEntry(Worker& worker, const fs::path& filePath,
+            DependencyGraphCache::Entry& entry)
+    {
+        Interpreter::Result result;
+        if (!Process(worker, filePath, result))
+        {
+            return false;
+        }
+
+        entry.modules = result.hscppModules;
+        entry.includes = result.includePaths;
+
+        for (const auto& hscppRequire : result.hscppRequires)
+        {
+            for (const auto& value : hscppRequire.values)
+            {
+                if (hscppRequire.type == HscppRequire::Type::IncludeDir)
                 {
-                    fs::path includePath = fs::u8path(include);
-                    for (const auto& includeDirectoryPath : wholeIncludeDirectoryPaths)
-                    {
-                        // For example, the includePath may be "MathUtil.h", but we want to find the
-                        // full path for creating the dependency graph. Iterate through our include
-                        // directories to find the folder that contains a matching include.
-                        fs::path fullIncludePath = includeDirectoryPath / includePath;
-                        if (fs::exists(fullIncludePath))
-                        {
-                            std::error_code error;
-                            fullIncludePath = fs::canonical(fullIncludePath, error);
-                            if (error.value() == HSCPP_ERROR_SUCCESS)
-                            {
-                                canonicalIncludePaths.push_back(fullIncludePath);
-                                break;
-                            }
-                        }
+                    fs::path canonicalPath;
+                    if (FormCanonical(filePath, value, canonicalPath)) {
+                        entry.includeDirectoryPaths.push_back(canonicalPath);
                     }
                 }
+            }
+        }
+
+        return true;
+    }
 
-                m_DependencyGraph.SetLinkedModules(filePath, result.hscppModules);
-                m_DependencyGraph.SetFileDependencies(filePath, canonicalIncludePaths);
+    std::vector<fs::path> Preprocessor::ResolveIncludes(const fs::path& filePath,
+            const DependencyGraphCache::Entry& entry,
+            const std::vector<fs::path>& includeDirectoryPaths)
+    {
+        std::vector<fs::path> canonicalIncludePaths;
+        std::vector<fs::path> wholeIncludeDirectoryPaths{ filePath.parent_path() };
+        wholeIncludeDirectoryPaths.insert(wholeIncludeDirectoryPaths.end(), includeDirectoryPaths.begin(), includeDirectoryPaths.end());
+        wholeIncludeDirectoryPaths.insert(wholeIncludeDirectoryPaths.end(),
+                entry.includeDirectoryPaths.begin(), entry.includeDirectoryPaths.end());
+
+        // Includes are resolved on every update rather than cached with the entry, as the include
+        // directories may have changed since it was created. Resolutions are instead memoized by the
+        // IncludeResolver, which is kept up to date as files change.
+        for (const auto& include : entry.includes)
+        {
+            for (const auto& includeDirectoryPath : wholeIncludeDirectoryPaths)
+            {
+                // For example, the include may be "MathUtil.h", but we want to find the full path
+                // for creating the dependency graph. Iterate through our include directories to
+                // find the folder that contains a matching include.
+                fs::path canonicalIncludePath;
+                if (m_IncludeResolver.Resolve(includeDirectoryPath, include, canonicalIncludePath))
+                {
+                    canonicalIncludePaths.push_back(canonicalIncludePath);
+                    break;
+                }
             }
         }
+
+        return canonicalIncludePaths;
+    }
+
+    void Preprocessor::ForEachFile(size_t nFiles, const std::function<void(Worker& worker, size_t iFile)>& cb)
+    {
+        size_t nThreads = m_Config.nThreads;
+        if (nThreads == 0)
+        {
+            nThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        nThreads = std::max<size_t>(1, std::min(nThreads, nFiles / MIN_FILES_PER_THREAD));
+        while (m_Workers.size() < nThreads)
+        {
+            m_Workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        }
+
+        // Files may take very different amounts of time to process, so rather than splitting them
+        // into fixed ranges, each thread takes the next unprocessed file.
+        std::atomic<size_t> iNextFile(0);
+        auto ProcessFiles = [&](Worker& worker) {
+            for (size_t iFile = iNextFile++; iFile < nFiles; iFile = iNextFile++)
+            {
+                cb(worker, iFile);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < nThreads; ++i)
+        {
+            threads.emplace_back(ProcessFiles, std::ref(*m_Workers.at(i)));
+        }
+
+        // The calling thread uses the first worker.
+        ProcessFiles(*m_Workers.front());
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
     }
 
     void Preprocessor::Reset(Output& output)
@@ -152,22 +342,30 @@ namespace hscpp
 
     void Preprocessor::AddDependentFilePaths(std::unordered_set<fs::path, FsPathHasher>& filePaths)
     {
-        std::unordered_set<fs::path, FsPathHasher> dependentPaths;
-        for (const auto& filePath : filePaths)
-        {
-            std::vector<fs::path> dependentFilePaths = m_DependencyGraph.ResolveGraph(filePath);
-            dependentPaths.insert(dependentFilePaths.begin(), dependentFilePaths.end());
-        }
+        std::vector<fs::path> dependentFilePaths = m_DependencyGraph.ResolveGraph(
+            std::vector<fs::path>(filePaths.begin(), filePaths.end()));
 
-        filePaths.insert(dependentPaths.begin(), dependentPaths.end());
+        filePaths.insert(dependentFilePaths.begin(), dependentFilePaths.end());
     }
 
     bool Preprocessor::Preprocess(const std::unordered_set<fs::path, FsPathHasher>& filePaths)
     {
-        for (const auto& filePath : filePaths)
+        std::vector<fs::path> filePathsVec(filePaths.begin(), filePaths.end());
+        std::vector<Interpreter::Result> results(filePathsVec.size());
+
+        // std::vector<bool> packs its elements, and cannot be safely written from multiple threads.
+        std::unique_ptr<bool[]> pbSucceeded(new bool[filePathsVec.size()]());
+
+        ForEachFile(filePathsVec.size(), [&](Worker& worker, size_t iFile) {
+            pbSucceeded[iFile] = Process(worker, filePathsVec.at(iFile), results.at(iFile));
+        });
+
+        for (size_t i = 0; i < filePathsVec.size(); ++i)
         {
-            Interpreter::Result result;
-            if (!Process(filePath, result))
+            const fs::path& filePath = filePathsVec.at(i);
+            const Interpreter::Result& result = results.at(i);
+
+            if (!pbSucceeded[i])
             {
                 log::Error() << HSCPP_LOG_PREFIX << "Failed to process file " << filePath << log::End(".");
                 return false;
@@ -192,41 +390,102 @@ namespace hscpp
         return true;
     }
 
-    bool Preprocessor::Process(const fs::path& filePath, Interpreter::Result& result)
+    bool Preprocessor::Process(Worker& worker, const fs::path& filePath, Interpreter::Result& result)
     {
-        std::ifstream ifs(filePath.u8string());
-        if (!ifs.is_open())
+        std::error_code error;
+        uint64_t fileSize = fs::file_size(filePath, error);
+        if (error.value() != HSCPP_ERROR_SUCCESS)
         {
             log::Error() << HSCPP_LOG_PREFIX << "Failed to open file "
-                << filePath << log::LastOsError() << log::End(".");
+                << filePath << log::OsError(error) << log::End(".");
             return false;
         }
 
-        std::stringstream ss;
-        ss << ifs.rdbuf();
+        // Large files are mapped rather than copied. Small files are read into a reused buffer, as
+        // mapping them costs more than it saves, and keeps the window in which a file truncated by
+        // an editor could fault the mapping small.
+        MappedFile mappedFile;
+        const char* pContent = nullptr;
+        size_t contentSize = 0;
+
+        if (fileSize >= MIN_MAPPED_FILE_SIZE)
+        {
+            if (!mappedFile.Open(filePath))
+            {
+                return false;
+            }
 
-        if (!m_Lexer.Lex(ss.str(), m_Tokens))
+            pContent = mappedFile.GetData();
+            contentSize = mappedFile.GetSize();
+        }
+        else
+        {
+            std::ifstream ifs(filePath.u8string(), std::ios::binary);
+            if (!ifs.is_open())
+            {
+                log::Error() << HSCPP_LOG_PREFIX << "Failed to open file "
+                    << filePath << log::LastOsError() << log::End(".");
+                return false;
+            }
+
+            worker.buffer.resize(static_cast<size_t>(fileSize));
+            ifs.read(&worker.buffer[0], worker.buffer.size());
+            worker.buffer.resize(static_cast<size_t>(ifs.gcount()));
+
+            pContent = worker.buffer.data();
+            contentSize = worker.buffer.size();
+        }
+
+        uint64_t contentHash = FileHashCache::HashContent(pContent, contentSize);
+        uint64_t varsVersion = m_VarStore.GetVersion();
+
+        {
+            std::lock_guard<std::mutex> lock(m_CachedResultsMutex);
+
+            auto cachedResultIt = m_CachedResultsByPath.find(filePath);
+            if (cachedResultIt != m_CachedResultsByPath.end()
+                && cachedResultIt->second.contentHash == contentHash
+                && cachedResultIt->second.varsVersion == varsVersion)
+            {
+                result = cachedResultIt->second.result;
+                return true;
+            }
+        }
+
+        if (!worker.lexer.LexRelevant(pContent, contentSize, worker.tokens))
         {
             log::Error() << HSCPP_LOG_PREFIX << "Failed to lex " << filePath << log::End(".");
-            log::Error() << m_Lexer.GetLastError().ToString() << log::End();
+            log::Error() << worker.lexer.GetLastError().ToString() << log::End();
             return false;
         }
 
         std::unique_ptr<Stmt> pRootStmt;
-        if (!m_Parser.Parse(m_Tokens, pRootStmt))
+        if (!worker.parser.Parse(worker.tokens, pRootStmt))
         {
             log::Error() << HSCPP_LOG_PREFIX << "Failed to parse " << filePath << log::End(".");
-            log::Error() << m_Parser.GetLastError().ToString() << log::End();
+            log::Error() << worker.parser.GetLastError().ToString() << log::End();
             return false;
         }
 
-        if (!m_Interpreter.Evaluate(*pRootStmt, m_VarStore, result))
+        bool bEvaluated = m_Config.bEvaluateConditionalIncludes
+            ? worker.interpreter.Evaluate(*pRootStmt, m_VarStore, m_ConditionEvaluator, result)
+            : worker.interpreter.Evaluate(*pRootStmt, m_VarStore, result);
+
+        if (!bEvaluated)
         {
             log::Error() << HSCPP_LOG_PREFIX << "Failed to interpret " << filePath << log::End(".");
-            log::Error() << m_Interpreter.GetLastError().ToString() << log::End();
+            log::Error() << worker.interpreter.GetLastError().ToString() << log::End();
             return false;
         }
 
+        CachedResult cachedResult;
+        cachedResult.contentHash = contentHash;
+        cachedResult.varsVersion = varsVersion;
+        cachedResult.result = result;
+
+        std::lock_guard<std::mutex> lock(m_CachedResultsMutex);
+        m_CachedResultsByPath[filePath] = std::move(cachedResult);
+
         return true;
     }
 
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <vector>
+
 #include "hscpp/preprocessor/VarStore.h"
 #include "hscpp/Log.h"
 #include "hscpp/Util.h"
@@ -8,6 +11,7 @@ namespace hscpp
     void VarStore::SetVar(const std::string& name, const Variant& val)
     {
         m_Vars[util::Trim(name)] = val;
+        ++m_Version;
     }
 
     bool VarStore::GetVar(const std::string& name, Variant& val) const
@@ -31,9 +35,36 @@ namespace hscpp
         }
 
         m_Vars.erase(varIt);
+        ++m_Version;
+
         return true;
     }
 
+    uint64_t VarStore::GetVersion() const
+    {
+        return m_Version;
+    }
+
+    std::string VarStore::GetKey() const
+    {
+        std::vector<std::string> entries;
+        for (const auto& name__var : m_Vars)
+        {
+            entries.push_back(name__var.first + '\0' + name__var.second.GetTypeName()
+                + '\0' + name__var.second.ToString());
+        }
+
+        std::sort(entries.begin(), entries.end());
+
+        std::string key;
+        for (const auto& entry : entries)
+        {
+            key += entry + '\0';
+        }
+
+        return key;
+    }
+
     std::string VarStore::Interpolate(const std::string& str) const
     {
         std::string interpolatedStr = str;
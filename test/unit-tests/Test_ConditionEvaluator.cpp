@@ -0,0 +1,81 @@
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/preprocessor/ConditionEvaluator.h"
+
+namespace hscpp { namespace test
+{
+
+    static void ValidateCondition(const ConditionEvaluator& evaluator,
+        const std::string& condition, ConditionEvaluator::Result expected)
+    {
+        INFO("Condition: " + condition);
+        REQUIRE(evaluator.Evaluate(condition) == expected);
+    }
+
+    TEST_CASE("ConditionEvaluator can evaluate conditions against definitions.")
+    {
+        using Result = ConditionEvaluator::Result;
+
+        ConditionEvaluator evaluator;
+        evaluator.SetDefinitions({ "A", "B=2", "C=text" });
+
+        CALL(ValidateCondition, evaluator, "defined(A)", Result::True);
+        CALL(ValidateCondition, evaluator, "defined A", Result::True);
+        CALL(ValidateCondition, evaluator, "!defined(B)", Result::False);
+        CALL(ValidateCondition, evaluator, "defined(C)", Result::True);
+        CALL(ValidateCondition, evaluator, "A", Result::True);
+        CALL(ValidateCondition, evaluator, "B == 2 && A", Result::True);
+        CALL(ValidateCondition, evaluator, "B * 3 - 1 >= 0x5", Result::True);
+        CALL(ValidateCondition, evaluator, "(B << 2) / 4 == 2L", Result::True);
+        CALL(ValidateCondition, evaluator, "1 + 2 * 3 == 7", Result::True);
+        CALL(ValidateCondition, evaluator, "0", Result::False);
+        CALL(ValidateCondition, evaluator, "!(1)", Result::False);
+
+        // Macros not passed as definitions may be defined in code.
+        CALL(ValidateCondition, evaluator, "defined(D)", Result::Unknown);
+        CALL(ValidateCondition, evaluator, "D > 1", Result::Unknown);
+        CALL(ValidateCondition, evaluator, "C == 1", Result::Unknown);
+
+        // A known operand may decide a logical operator.
+        CALL(ValidateCondition, evaluator, "defined(D) && !defined(A)", Result::False);
+        CALL(ValidateCondition, evaluator, "defined(D) || defined(A)", Result::True);
+        CALL(ValidateCondition, evaluator, "defined(D) && defined(A)", Result::Unknown);
+
+        // Unsupported syntax.
+        CALL(ValidateCondition, evaluator, "", Result::Unknown);
+        CALL(ValidateCondition, evaluator, "__has_include(<a.h>)", Result::Unknown);
+        CALL(ValidateCondition, evaluator, "A ? 1 : 0", Result::Unknown);
+        CALL(ValidateCondition, evaluator, "(A", Result::Unknown);
+        CALL(ValidateCondition, evaluator, "1 / 0", Result::Unknown);
+        CALL(ValidateCondition, evaluator, "defined()", Result::Unknown);
+
+        // Platform macros are always known.
+#ifdef _WIN32
+        CALL(ValidateCondition, evaluator, "defined(_WIN32)", Result::True);
+        CALL(ValidateCondition, evaluator, "defined(__linux__) || defined(__APPLE__)", Result::False);
+#elif defined(__linux__)
+        CALL(ValidateCondition, evaluator, "defined(__linux__)", Result::True);
+        CALL(ValidateCondition, evaluator, "defined(_WIN32) || defined(__APPLE__)", Result::False);
+#endif
+
+        // Definitions are replaced, rather than added to.
+        evaluator.SetDefinitions({ "D" });
+        CALL(ValidateCondition, evaluator, "defined(A)", Result::Unknown);
+        CALL(ValidateCondition, evaluator, "defined(D)", Result::True);
+    }
+
+    TEST_CASE("ConditionEvaluator keys depend only on definitions.")
+    {
+        ConditionEvaluator a;
+        ConditionEvaluator b;
+        REQUIRE(a.GetKey() == b.GetKey());
+
+        a.SetDefinitions({ "X", "Y=1" });
+        b.SetDefinitions({ "Y=1", "X" });
+        REQUIRE(a.GetKey() == b.GetKey());
+
+        b.SetDefinitions({ "Y=2", "X" });
+        REQUIRE(a.GetKey() != b.GetKey());
+    }
+
+}}
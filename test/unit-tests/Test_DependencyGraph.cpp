@@ -1,3 +1,7 @@
+#include <chrono>
+#include <iostream>
+#include <unordered_set>
+
 #include "catch/catch.hpp"
 #include "common/Common.h"
 
@@ -161,4 +165,183 @@ namespace hscpp { namespace test {
         });
     }
 
-}}
+    TEST_CASE("DependencyGraph can handle deep include chains.")
+    {
+        DependencyGraph graph;
+
+        // Deep enough that a recursive traversal would risk overflowing the stack.
+        const int CHAIN_LENGTH = 200000;
+
+        fs::path rootCpp = "root.cpp";
+        graph.SetFileDependencies(rootCpp, { "header0.h" });
+
+        for (int i = 0; i < CHAIN_LENGTH - 1; ++i)
+        {
+            fs::path headerH = "header" + std::to_string(i) + ".h";
+            fs::path nextH = "header" + std::to_string(i + 1) + ".h";
+
+            graph.SetFileDependencies(headerH, { nextH });
+        }
+
+        fs::path leafH = "header" + std::to_string(CHAIN_LENGTH - 1) + ".h";
+        fs::path leafCpp = "leaf.cpp";
+        graph.SetLinkedModules(leafH, { "leaf" });
+        graph.SetLinkedModules(leafCpp, { "leaf" });
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(rootCpp), { rootCpp, leafCpp });
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(leafH), { rootCpp, leafCpp });
+    }
+
+    static void CreateSyntheticGraph(DependencyGraph& graph, int nModules, int nIncludesPerFile)
+    {
+        // Each module is a header and source pair. Every source includes its own header, as well
+        // as a pseudo-random selection of other headers.
+        uint32_t seed = 12345;
+        auto random = [&]() {
+            seed = seed * 1664525 + 1013904223;
+            return static_cast<int>(seed >> 8);
+        };
+
+        for (int i = 0; i < nModules; ++i)
+        {
+            std::string module = "module" + std::to_string(i);
+            fs::path headerH = module + ".h";
+            fs::path sourceCpp = module + ".cpp";
+
+            graph.SetLinkedModules(headerH, { module });
+            graph.SetLinkedModules(sourceCpp, { module });
+
+            std::vector<fs::path> dependencies = { headerH };
+            for (int j = 0; j < nIncludesPerFile; ++j)
+            {
+                dependencies.push_back("module" + std::to_string(random() % nModules) + ".h");
+            }
+
+            graph.SetFileDependencies(sourceCpp, dependencies);
+        }
+    }
+
+    TEST_CASE("DependencyGraph can resolve multiple files at once.")
+    {
+        DependencyGraph graph;
+        CreateSyntheticGraph(graph, 500, 2);
+
+        // Resolving several files at once must give the same result as resolving them one by one.
+        std::vector<fs::path> filePaths = {
+            "module3.h",
+            "module42.cpp",
+            "module137.h",
+            "module499.cpp",
+            "untracked.cpp",
+        };
+
+        std::unordered_set<fs::path, FsPathHasher> expectedSet;
+        for (const auto& filePath : filePaths)
+        {
+            std::vector<fs::path> resolved = graph.ResolveGraph(filePath);
+            expectedSet.insert(resolved.begin(), resolved.end());
+        }
+
+        std::vector<fs::path> expected(expectedSet.begin(), expectedSet.end());
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(filePaths), expected);
+    }
+
+    TEST_CASE("DependencyGraph can compile only tracked dependents.")
+    {
+        DependencyGraph graph;
+
+        fs::path commonH = "common.h";
+        fs::path commonCpp = "common.cpp";
+        fs::path helperH = "helper.h";
+        fs::path helperCpp = "helper.cpp";
+        fs::path trackedH = "tracked.h";
+        fs::path trackedCpp = "tracked.cpp";
+        fs::path untrackedCpp = "untracked.cpp";
+
+        graph.SetFileDependencies(helperH, { commonH });
+        graph.SetFileDependencies(helperCpp, { helperH });
+        graph.SetFileDependencies(trackedH, { commonH, helperH });
+        graph.SetFileDependencies(trackedCpp, { trackedH });
+        graph.SetFileDependencies(untrackedCpp, { commonH });
+
+        graph.SetLinkedModules(commonH, { "common" });
+        graph.SetLinkedModules(commonCpp, { "common" });
+        graph.SetLinkedModules(helperH, { "helper" });
+        graph.SetLinkedModules(helperCpp, { "helper" });
+
+        // The Parser names the module of HSCPP_TRACK(Tracked, "Tracked") "@Tracked".
+        graph.SetLinkedModules(trackedH, { "@Tracked" });
+
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(commonH), {
+            commonCpp,
+            helperCpp,
+            trackedCpp,
+            untrackedCpp,
+        });
+
+        graph.SetCompileOnlyTrackedDependents(true);
+
+        // helper.cpp does not include a tracked class, but tracked.cpp must link with it.
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(commonH), {
+            commonCpp,
+            helperCpp,
+            trackedCpp,
+        });
+
+        // Files that are resolved directly are always compiled.
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(untrackedCpp), {
+            commonCpp,
+            untrackedCpp,
+        });
+
+        // No longer tracked.
+        graph.SetLinkedModules(trackedH, {});
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(commonH), {
+            commonCpp,
+        });
+
+        graph.SetCompileOnlyTrackedDependents(false);
+        CALL(ValidateUnorderedVector, graph.ResolveGraph(commonH), {
+            commonCpp,
+            helperCpp,
+            trackedCpp,
+            untrackedCpp,
+        });
+    }
+
+    TEST_CASE("DependencyGraph benchmark on a large graph.", "[.][benchmark]")
+    {
+        DependencyGraph graph;
+
+        // 25000 modules, giving 50000 files.
+        auto start = std::chrono::steady_clock::now();
+        CreateSyntheticGraph(graph, 25000, 8);
+        auto buildDuration = std::chrono::steady_clock::now() - start;
+
+        std::vector<fs::path> filePaths;
+        for (int i = 0; i < 100; ++i)
+        {
+            filePaths.push_back("module" + std::to_string(i * 250) + ".h");
+        }
+
+        start = std::chrono::steady_clock::now();
+        std::vector<fs::path> resolved = graph.ResolveGraph(filePaths);
+        auto resolveDuration = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        graph.ResolveGraph(filePaths);
+        auto cachedResolveDuration = std::chrono::steady_clock::now() - start;
+
+        REQUIRE(!resolved.empty());
+
+        auto toMs = [](std::chrono::steady_clock::duration duration) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+        };
+
+        std::cout << "Build graph: " << toMs(buildDuration) << "ms" << std::endl;
+        std::cout << "Resolve graph (" << filePaths.size() << " files, " << resolved.size()
+            << " resolved): " << toMs(resolveDuration) << "ms" << std::endl;
+        std::cout << "Resolve graph again: " << toMs(cachedResolveDuration) << "ms" << std::endl;
+    }
+
+}}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include <string>
+#include <algorithm>
+
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/file-watcher/DirectorySnapshot.h"
+#include "hscpp/Util.h"
+
+namespace hscpp { namespace test
+{
+
+    const static fs::path TEST_FILES_PATH = util::GetHscppTestPath() / "unit-tests" / "files" / "test-file-watcher";
+
+    TEST_CASE("DirectorySnapshot can detect changes across many files.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path srcPath = sandboxPath / "src";
+
+        const int nDirectories = 4;
+        const int nFilesPerDirectory = 1000;
+
+        for (int iDirectory = 0; iDirectory < nDirectories; ++iDirectory)
+        {
+            fs::path directoryPath = srcPath / ("dir" + std::to_string(iDirectory));
+            REQUIRE(fs::create_directory(directoryPath));
+
+            for (int iFile = 0; iFile < nFilesPerDirectory; ++iFile)
+            {
+                CALL(NewFile, directoryPath / ("File" + std::to_string(iFile) + ".cpp"), "");
+            }
+        }
+
+        REQUIRE(fs::create_directory(srcPath / ".git"));
+        CALL(NewFile, srcPath / ".git" / "index", "");
+
+        FileWatcherConfig config;
+        config.bRecursive = true;
+        config.nPollingThreads = 4;
+
+        DirectorySnapshot snapshot;
+        REQUIRE(snapshot.Scan(srcPath, config));
+        REQUIRE(snapshot.GetFileCount() == nDirectories * nFilesPerDirectory + 1);
+
+        fs::path modifiedFilePath = srcPath / "dir1" / "File10.cpp";
+        fs::path removedFilePath = srcPath / "dir2" / "File20.cpp";
+        fs::path newFilePath = srcPath / "dir3" / "NewFile.cpp";
+
+        CALL(NewFile, modifiedFilePath, "int main() {}");
+        CALL(RemoveFile, removedFilePath);
+        CALL(NewFile, newFilePath, "");
+
+        DirectorySnapshot newSnapshot;
+        REQUIRE(newSnapshot.Scan(srcPath, config));
+
+        std::vector<IFileWatcher::Event> events;
+        newSnapshot.Diff(snapshot, events);
+
+        std::vector<fs::path> filePaths;
+        for (const auto& event : events)
+        {
+            filePaths.push_back(event.filePath);
+        }
+
+        REQUIRE(filePaths.size() == 3);
+        REQUIRE(std::find(filePaths.begin(), filePaths.end(), modifiedFilePath) != filePaths.end());
+        REQUIRE(std::find(filePaths.begin(), filePaths.end(), removedFilePath) != filePaths.end());
+        REQUIRE(std::find(filePaths.begin(), filePaths.end(), newFilePath) != filePaths.end());
+
+        // Once the reported events are applied, nothing is left to diff. Paths outside the scanned
+        // directory are ignored.
+        IFileWatcher::Event outsideEvent;
+        outsideEvent.filePath = sandboxPath / "Outside.cpp";
+        CALL(NewFile, outsideEvent.filePath, "");
+        events.push_back(outsideEvent);
+
+        snapshot.Update(events);
+        REQUIRE(snapshot.GetFileCount() == newSnapshot.GetFileCount());
+
+        events.clear();
+        newSnapshot.Diff(snapshot, events);
+        REQUIRE(events.empty());
+    }
+
+}}
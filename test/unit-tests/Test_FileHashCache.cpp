@@ -0,0 +1,225 @@
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/file-watcher/FileHashCache.h"
+#include "hscpp/Util.h"
+
+namespace hscpp { namespace test
+{
+
+    const static fs::path TEST_FILES_PATH = util::GetHscppTestPath() / "unit-tests" / "files" / "test-file-watcher";
+
+    TEST_CASE("FileHashCache drops events for files with unchanged content.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path testFilePath = sandboxPath / "src" / "Test.cpp";
+
+        FileWatcherConfig config;
+        config.bRecursive = false;
+
+        FileHashCache cache;
+        cache.AddDirectory(sandboxPath / "src", config);
+
+        std::vector<IFileWatcher::Event> events;
+        auto AddEvent = [&events](const fs::path& filePath) {
+            IFileWatcher::Event event;
+            event.filePath = filePath;
+            events.push_back(event);
+        };
+
+        SECTION("Saving a file without changes drops its event.")
+        {
+            CALL(NewFile, testFilePath, CALL(FileToString, testFilePath));
+
+            AddEvent(testFilePath);
+            cache.RemoveUnchangedEvents(events);
+
+            REQUIRE(events.empty());
+        }
+
+        SECTION("Changing a file keeps its event once.")
+        {
+            CALL(ModifyFile, testFilePath, {
+                { "body", "int main() {}" },
+            });
+
+            AddEvent(testFilePath);
+            AddEvent(testFilePath);
+            cache.RemoveUnchangedEvents(events);
+
+            REQUIRE(events.size() == 1);
+
+            // The new content is now recorded.
+            events.clear();
+            AddEvent(testFilePath);
+            cache.RemoveUnchangedEvents(events);
+
+            REQUIRE(events.empty());
+        }
+
+        SECTION("Invalidating a file keeps its next event.")
+        {
+            cache.Invalidate(testFilePath);
+
+            AddEvent(testFilePath);
+            cache.RemoveUnchangedEvents(events);
+
+            REQUIRE(events.size() == 1);
+        }
+
+        SECTION("Removing or creating a file keeps its event.")
+        {
+            fs::path newFilePath = sandboxPath / "src" / "NewFile.cpp";
+
+            CALL(RemoveFile, testFilePath);
+            CALL(NewFile, newFilePath, "int main() {}");
+
+            AddEvent(testFilePath);
+            AddEvent(newFilePath);
+            cache.RemoveUnchangedEvents(events);
+
+            REQUIRE(events.size() == 2);
+        }
+    }
+
+    TEST_CASE("FileHashCache follows the file watcher config, and can forget a directory.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path srcPath = sandboxPath / "src";
+
+        REQUIRE(fs::create_directories(srcPath / "nested"));
+        REQUIRE(fs::create_directories(srcPath / "ignored"));
+        CALL(NewFile, srcPath / "nested" / "Nested.cpp", "int Nested() { return 0; }");
+        CALL(NewFile, srcPath / "ignored" / "Ignored.cpp", "int Ignored() { return 0; }");
+
+        FileWatcherConfig config;
+        config.bRecursive = true;
+        config.ignoredDirectoryNames = { "ignored" };
+
+        FileHashCache cache;
+        cache.AddDirectory(srcPath, config);
+
+        // Events of recorded files are dropped, since their content is unchanged.
+        auto GetKeptFilePaths = [&cache](const std::vector<fs::path>& filePaths) {
+            std::vector<IFileWatcher::Event> events;
+            for (const auto& filePath : filePaths)
+            {
+                IFileWatcher::Event event;
+                event.filePath = filePath;
+                events.push_back(event);
+            }
+
+            cache.RemoveUnchangedEvents(events);
+
+            std::vector<fs::path> keptFilePaths;
+            for (const auto& event : events)
+            {
+                keptFilePaths.push_back(event.filePath);
+            }
+
+            return keptFilePaths;
+        };
+
+        SECTION("Subdirectories are hashed, unless ignored.")
+        {
+            ValidateUnorderedVector(GetKeptFilePaths({
+                srcPath / "Test.cpp",
+                srcPath / "nested" / "Nested.cpp",
+                srcPath / "ignored" / "Ignored.cpp",
+            }), {
+                srcPath / "ignored" / "Ignored.cpp",
+            });
+        }
+
+        SECTION("Removing a directory forgets the hashes of its files.")
+        {
+            cache.RemoveDirectory(srcPath / "nested");
+
+            ValidateUnorderedVector(GetKeptFilePaths({
+                srcPath / "Test.cpp",
+                srcPath / "nested" / "Nested.cpp",
+            }), {
+                srcPath / "nested" / "Nested.cpp",
+            });
+        }
+    }
+
+    TEST_CASE("FileHashCache can ignore comment and whitespace changes.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path testFilePath = sandboxPath / "src" / "Test.cpp";
+
+        std::string original =
+            "#include <string>\n"
+            "#define VALUE 1\n"
+            "int Subtract(int a, int b) { return a - -b; }\n"
+            "const char* pStr = \"a  b\";\n";
+
+        auto HashTokens = [&testFilePath](const std::string& content) {
+            CALL(NewFile, testFilePath, content);
+
+            uint64_t hash = 0;
+            REQUIRE(FileHashCache::HashFile(testFilePath, FileHashCache::HashMode::Tokens, hash));
+
+            return hash;
+        };
+
+        uint64_t originalHash = HashTokens(original);
+
+        SECTION("Comment and whitespace changes do not change the hash.")
+        {
+            REQUIRE(originalHash == HashTokens(
+                "// Header comment.\n"
+                "#include <string>\n"
+                "#define VALUE 1 /* Value. */\n"
+                "int Subtract(int a, int b)\n"
+                "{\n"
+                "    return a - -b; // Comment.\n"
+                "}\n"
+                "\n"
+                "const char* pStr =   \"a  b\";\n"));
+        }
+
+        SECTION("Code changes change the hash.")
+        {
+            REQUIRE(originalHash != HashTokens(
+                "#include <string>\n"
+                "#define VALUE 1\n"
+                "int Subtract(int a, int b) { return a--b; }\n"
+                "const char* pStr = \"a  b\";\n"));
+
+            REQUIRE(originalHash != HashTokens(
+                "#include <string>\n"
+                "#define VALUE 1\n"
+                "int Subtract(int a, int b) { return a - -b; }\n"
+                "const char* pStr = \"a b\";\n"));
+
+            REQUIRE(originalHash != HashTokens(
+                "#include <string>\n"
+                "#define VALUE 1 int Subtract(int a, int b) { return a - -b; }\n"
+                "const char* pStr = \"a  b\";\n"));
+        }
+
+        SECTION("Events are dropped for comment-only changes.")
+        {
+            FileHashCache cache;
+            cache.SetHashMode(FileHashCache::HashMode::Tokens);
+            FileWatcherConfig config;
+            config.bRecursive = false;
+            cache.AddDirectory(sandboxPath / "src", config);
+
+            CALL(NewFile, testFilePath, "// New comment.\n" + original);
+
+            IFileWatcher::Event event;
+            event.filePath = testFilePath;
+
+            std::vector<IFileWatcher::Event> events = { event };
+            cache.RemoveUnchangedEvents(events);
+
+            REQUIRE(events.empty());
+        }
+    }
+
+}}
@@ -2,12 +2,15 @@
 #include <thread>
 #include <chrono>
 #include <fstream>
+#include <string>
+#include <unordered_set>
 
 #include "catch/catch.hpp"
 #include "common/Common.h"
 #include "hscpp/file-watcher/IFileWatcher.h"
 #include "hscpp/Platform.h"
 #include "hscpp/Util.h"
+#include "hscpp/FsPathHasher.h"
 
 namespace hscpp { namespace test
 {
@@ -97,4 +100,426 @@ namespace hscpp { namespace test
         }
     }
 
-}}
\ No newline at end of file
+    TEST_CASE("FileWatcher can monitor directories recursively.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+
+        fs::path nestedDirectoryPath = sandboxPath / "src" / "nested" / "deeper";
+        fs::path ignoredDirectoryPath = sandboxPath / "src" / ".git";
+
+        std::error_code error;
+        fs::create_directories(nestedDirectoryPath, error);
+        REQUIRE(error.value() == HSCPP_ERROR_SUCCESS);
+        fs::create_directories(ignoredDirectoryPath, error);
+        REQUIRE(error.value() == HSCPP_ERROR_SUCCESS);
+
+        fs::path nestedFilePath = nestedDirectoryPath / "Nested.cpp";
+        CALL(NewFile, nestedFilePath, "int main() {}");
+
+        auto pConfig = std::unique_ptr<Config>(new Config());
+        pConfig->fileWatcher.bRecursive = true;
+
+        std::unique_ptr<IFileWatcher> pFileWatcher = platform::CreateFileWatcher(&pConfig->fileWatcher);
+        REQUIRE(pFileWatcher->AddWatch(sandboxPath / "src"));
+
+        std::vector<IFileWatcher::Event> events;
+        std::vector<fs::path> canonicalModifiedFilePaths;
+        std::vector<fs::path> canonicalRemovedFilePaths;
+
+        auto cb = [&](Milliseconds) {
+            pFileWatcher->PollChanges(events);
+            return !events.empty()
+                   ? UpdateLoop::Done
+                   : UpdateLoop::Running;
+        };
+
+        SECTION("Modifying a file in an existing subdirectory triggers event.")
+        {
+            CALL(NewFile, nestedFilePath, "int main() { return 0; }");
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            fs::path canonicalNestedFilePath = CALL(Canonical, nestedFilePath);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalRemovedFilePaths.empty());
+            REQUIRE(canonicalModifiedFilePaths.at(0) == canonicalNestedFilePath);
+        }
+
+        SECTION("Creating a file in a new subdirectory triggers event.")
+        {
+            fs::path newDirectoryPath = sandboxPath / "src" / "new";
+            fs::create_directories(newDirectoryPath, error);
+            REQUIRE(error.value() == HSCPP_ERROR_SUCCESS);
+
+            // Give the FileWatcher a chance to start watching the new directory.
+            std::this_thread::sleep_for(Milliseconds(50));
+            pFileWatcher->PollChanges(events);
+            REQUIRE(events.empty());
+
+            fs::path newFilePath = newDirectoryPath / "NewFile.cpp";
+            CALL(NewFile, newFilePath, "int main() {}");
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            fs::path canonicalNewFilePath = CALL(Canonical, newFilePath);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalRemovedFilePaths.empty());
+            REQUIRE(canonicalModifiedFilePaths.at(0) == canonicalNewFilePath);
+        }
+
+        SECTION("Ignored subdirectories do not trigger events.")
+        {
+            CALL(NewFile, ignoredDirectoryPath / "index", "");
+            CALL(NewFile, nestedFilePath, "int main() { return 0; }");
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            fs::path canonicalNestedFilePath = CALL(Canonical, nestedFilePath);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalModifiedFilePaths.at(0) == canonicalNestedFilePath);
+        }
+    }
+
+#if defined(HSCPP_PLATFORM_UNIX) && !defined(HSCPP_PLATFORM_APPLE)
+
+    TEST_CASE("FileWatcher reports events once files are closed for writing.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path testFilePath = sandboxPath / "src" / "Test.cpp";
+
+        fs::path canonicalTestFilePath = CALL(Canonical, testFilePath);
+
+        // With a long latency, events can only arrive in time if they are released early.
+        auto pConfig = std::unique_ptr<Config>(new Config());
+        pConfig->fileWatcher.latency = std::chrono::milliseconds(5000);
+
+        std::unique_ptr<IFileWatcher> pFileWatcher = platform::CreateFileWatcher(&pConfig->fileWatcher);
+        REQUIRE(pFileWatcher->AddWatch(sandboxPath / "src"));
+
+        std::vector<IFileWatcher::Event> events;
+        std::vector<fs::path> canonicalModifiedFilePaths;
+        std::vector<fs::path> canonicalRemovedFilePaths;
+
+        auto cb = [&](Milliseconds) {
+            pFileWatcher->PollChanges(events);
+            return !events.empty()
+                   ? UpdateLoop::Done
+                   : UpdateLoop::Running;
+        };
+
+        SECTION("Closing a modified file releases its event.")
+        {
+            CALL(ModifyFile, testFilePath, {
+                { "body", "int main() {}" },
+            });
+
+            CALL(StartUpdateLoop, Milliseconds(1000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalModifiedFilePaths.at(0) == canonicalTestFilePath);
+        }
+
+        SECTION("A file that is still open holds back events.")
+        {
+            std::ofstream file(testFilePath.c_str(), std::ios::app);
+            REQUIRE(file.is_open());
+
+            file << "// Modified." << std::flush;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            pFileWatcher->PollChanges(events);
+            REQUIRE(events.empty());
+
+            file.close();
+
+            CALL(StartUpdateLoop, Milliseconds(1000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalModifiedFilePaths.at(0) == canonicalTestFilePath);
+        }
+    }
+
+    TEST_CASE("FileWatcher reports the type of each event.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path testFilePath = sandboxPath / "src" / "Test.cpp";
+
+        fs::path canonicalTestFilePath = CALL(Canonical, testFilePath);
+
+        auto pConfig = std::unique_ptr<Config>(new Config());
+        std::unique_ptr<IFileWatcher> pFileWatcher = platform::CreateFileWatcher(&pConfig->fileWatcher);
+        REQUIRE(pFileWatcher->AddWatch(sandboxPath / "src"));
+
+        std::vector<IFileWatcher::Event> events;
+        auto cb = [&](Milliseconds) {
+            pFileWatcher->PollChanges(events);
+            return !events.empty()
+                   ? UpdateLoop::Done
+                   : UpdateLoop::Running;
+        };
+
+        SECTION("Modifying a file reports a modification.")
+        {
+            CALL(ModifyFile, testFilePath, {
+                { "body", "int main() {}" },
+            });
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+
+            REQUIRE(!events.empty());
+            for (const auto& event : events)
+            {
+                REQUIRE(event.type == IFileWatcher::Event::Type::Modified);
+                REQUIRE(event.bCanonical);
+                REQUIRE(event.filePath == canonicalTestFilePath);
+                REQUIRE(event.time.time_since_epoch().count() != 0);
+            }
+        }
+
+        SECTION("Renaming a file reports a rename.")
+        {
+            fs::path newFilePath = sandboxPath / "src" / "Renamed.cpp";
+            CALL(RenameFile, testFilePath, newFilePath);
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+
+            REQUIRE(events.size() == 1);
+            REQUIRE(events.at(0).type == IFileWatcher::Event::Type::Renamed);
+            REQUIRE(events.at(0).oldFilePath == canonicalTestFilePath);
+            REQUIRE(events.at(0).filePath == CALL(Canonical, newFilePath));
+
+            std::vector<fs::path> canonicalModifiedFilePaths;
+            std::vector<fs::path> canonicalRemovedFilePaths;
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalRemovedFilePaths.size() == 1);
+            REQUIRE(canonicalRemovedFilePaths.at(0) == canonicalTestFilePath);
+        }
+
+        SECTION("A file created and removed before polling is reported as removed.")
+        {
+            fs::path tempFilePath = sandboxPath / "src" / "Temp.cpp";
+            CALL(NewFile, tempFilePath, "int main() {}");
+            CALL(RemoveFile, tempFilePath);
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+
+            std::vector<fs::path> canonicalModifiedFilePaths;
+            std::vector<fs::path> canonicalRemovedFilePaths;
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            REQUIRE(canonicalModifiedFilePaths.empty());
+            REQUIRE(canonicalRemovedFilePaths.size() == 1);
+        }
+    }
+
+    TEST_CASE("FileWatcher recovers events lost to a queue overflow.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path srcPath = sandboxPath / "src";
+
+        size_t maxQueuedEvents = 0;
+        std::ifstream maxQueuedEventsFile("/proc/sys/fs/inotify/max_queued_events");
+        REQUIRE(maxQueuedEventsFile >> maxQueuedEvents);
+
+        if (maxQueuedEvents > 100000)
+        {
+            WARN("Skipping test, as fs.inotify.max_queued_events is too large to overflow quickly.");
+            return;
+        }
+
+        fs::path canonicalSrcPath = CALL(Canonical, srcPath);
+
+        auto pConfig = std::unique_ptr<Config>(new Config());
+        std::unique_ptr<IFileWatcher> pFileWatcher = platform::CreateFileWatcher(&pConfig->fileWatcher);
+        REQUIRE(pFileWatcher->AddWatch(srcPath));
+
+        // A change that has already been reported is not reported again by the rescan.
+        CALL(ModifyFile, srcPath / "Test.cpp", {
+            { "body", "int main() {}" },
+        });
+
+        std::vector<IFileWatcher::Event> modifiedEvents;
+        CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), [&](Milliseconds) {
+            pFileWatcher->PollChanges(modifiedEvents);
+            return !modifiedEvents.empty()
+                   ? UpdateLoop::Done
+                   : UpdateLoop::Running;
+        });
+
+        REQUIRE(modifiedEvents.at(0).filePath == canonicalSrcPath / "Test.cpp");
+
+        // Each new file produces at least two events (create and close), so this overflows the
+        // queue before any events are read.
+        size_t nFiles = maxQueuedEvents / 2 + 100;
+        for (size_t i = 0; i < nFiles; ++i)
+        {
+            CALL(NewFile, srcPath / ("File" + std::to_string(i) + ".cpp"), "int main() {}");
+        }
+
+        std::unordered_set<fs::path, FsPathHasher> reportedFilePaths;
+        auto cb = [&](Milliseconds) {
+            std::vector<IFileWatcher::Event> events;
+            pFileWatcher->PollChanges(events);
+
+            for (const auto& event : events)
+            {
+                reportedFilePaths.insert(event.filePath);
+            }
+
+            return reportedFilePaths.size() >= nFiles
+                   ? UpdateLoop::Done
+                   : UpdateLoop::Running;
+        };
+
+        CALL(StartUpdateLoop, Milliseconds(10000), Milliseconds(10), cb);
+
+        size_t nMissingFiles = 0;
+        for (size_t i = 0; i < nFiles; ++i)
+        {
+            nMissingFiles += 1 - reportedFilePaths.count(canonicalSrcPath / ("File" + std::to_string(i) + ".cpp"));
+        }
+
+        REQUIRE(nMissingFiles == 0);
+        REQUIRE(reportedFilePaths.count(canonicalSrcPath / "Test.cpp") == 0);
+    }
+
+#endif
+
+    TEST_CASE("FileWatcher can gather events on a watcher thread.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path testFilePath = sandboxPath / "src" / "Test.cpp";
+
+        fs::path canonicalTestFilePath = CALL(Canonical, testFilePath);
+
+        auto pConfig = std::unique_ptr<Config>(new Config());
+        pConfig->fileWatcher.bUseWatcherThread = true;
+
+        std::unique_ptr<IFileWatcher> pFileWatcher = platform::CreateFileWatcher(&pConfig->fileWatcher);
+        REQUIRE(pFileWatcher->AddWatch(sandboxPath / "src"));
+
+        std::vector<IFileWatcher::Event> events;
+        std::vector<fs::path> canonicalModifiedFilePaths;
+        std::vector<fs::path> canonicalRemovedFilePaths;
+
+        auto cb = [&](Milliseconds) {
+            pFileWatcher->PollChanges(events);
+            return !events.empty()
+                   ? UpdateLoop::Done
+                   : UpdateLoop::Running;
+        };
+
+        SECTION("Modifying a file triggers event.")
+        {
+            CALL(ModifyFile, testFilePath, {
+                { "body", "int main() {}" },
+            });
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalRemovedFilePaths.empty());
+            REQUIRE(canonicalModifiedFilePaths.at(0) == canonicalTestFilePath);
+        }
+
+        SECTION("Removing the watch stops events.")
+        {
+            REQUIRE(pFileWatcher->RemoveWatch(sandboxPath / "src"));
+
+            CALL(ModifyFile, testFilePath, {
+                { "body", "int main() {}" },
+            });
+
+            std::this_thread::sleep_for(pConfig->fileWatcher.latency * 2);
+            pFileWatcher->PollChanges(events);
+
+            REQUIRE(events.empty());
+        }
+    }
+
+    TEST_CASE("Polling FileWatcher can monitor simple directory for changes.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path testFilePath = sandboxPath / "src" / "Test.cpp";
+
+        fs::path canonicalTestFilePath = CALL(Canonical, testFilePath);
+
+        auto pConfig = std::unique_ptr<Config>(new Config());
+        pConfig->fileWatcher.bUsePolling = true;
+        pConfig->fileWatcher.pollingInterval = std::chrono::milliseconds(10);
+
+        std::unique_ptr<IFileWatcher> pFileWatcher = platform::CreateFileWatcher(&pConfig->fileWatcher);
+        REQUIRE(pFileWatcher->AddWatch(sandboxPath / "src"));
+
+        std::vector<IFileWatcher::Event> events;
+        std::vector<fs::path> canonicalModifiedFilePaths;
+        std::vector<fs::path> canonicalRemovedFilePaths;
+
+        auto cb = [&](Milliseconds) {
+            pFileWatcher->PollChanges(events);
+            return !events.empty()
+                   ? UpdateLoop::Done
+                   : UpdateLoop::Running;
+        };
+
+        SECTION("Modifying a file triggers event.")
+        {
+            CALL(ModifyFile, testFilePath, {
+                { "body", "int main() {}" },
+            });
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalRemovedFilePaths.empty());
+            REQUIRE(canonicalModifiedFilePaths.at(0) == canonicalTestFilePath);
+        }
+
+        SECTION("Creating a new file triggers event.")
+        {
+            fs::path newFilePath = sandboxPath / "src" / "NewFile.cpp";
+
+            CALL(NewFile, newFilePath, "int main() {}");
+
+            fs::path canonicalNewFilePath = CALL(Canonical, newFilePath);
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            REQUIRE(canonicalModifiedFilePaths.size() == 1);
+            REQUIRE(canonicalRemovedFilePaths.empty());
+            REQUIRE(canonicalModifiedFilePaths.at(0) == canonicalNewFilePath);
+        }
+
+        SECTION("Deleting an existing file triggers event.")
+        {
+            CALL(RemoveFile, testFilePath);
+
+            CALL(StartUpdateLoop, Milliseconds(2000), Milliseconds(10), cb);
+            util::SortFileEvents(events, canonicalModifiedFilePaths, canonicalRemovedFilePaths);
+
+            REQUIRE(canonicalModifiedFilePaths.empty());
+            REQUIRE(canonicalRemovedFilePaths.size() == 1);
+            REQUIRE(canonicalRemovedFilePaths.at(0) == canonicalTestFilePath);
+        }
+    }
+
+}}
@@ -0,0 +1,204 @@
+#include <algorithm>
+
+#include "catch/catch.hpp"
+#include "common/Common.h"
+
+#include "hscpp/Hotswapper.h"
+#include "hscpp/Util.h"
+
+namespace hscpp { namespace test
+{
+
+    const static fs::path TEST_FILES_PATH = util::GetHscppTestPath() / "unit-tests" / "files" / "test-file-watcher";
+
+    // Reports only the events it is given.
+    class FakeFileWatcher : public IFileWatcher
+    {
+    public:
+        std::vector<Event> events;
+
+        bool AddWatch(const fs::path&) override
+        {
+            return true;
+        }
+
+        bool RemoveWatch(const fs::path&) override
+        {
+            return true;
+        }
+
+        void ClearAllWatches() override
+        {}
+
+        void PollChanges(std::vector<Event>& polledEvents) override
+        {
+            polledEvents = events;
+            events.clear();
+        }
+    };
+
+    // Finishes each build after buildDuration, without compiling anything.
+    class FakeCompiler : public ICompiler
+    {
+    public:
+        Milliseconds buildDuration = Milliseconds(0);
+
+        bool IsInitialized() override
+        {
+            return true;
+        }
+
+        bool StartBuild(const Input&) override
+        {
+            m_bCompiling = true;
+            m_BuildEndTime = std::chrono::steady_clock::now() + buildDuration;
+
+            return true;
+        }
+
+        void Update() override
+        {
+            if (m_bCompiling && std::chrono::steady_clock::now() >= m_BuildEndTime)
+            {
+                m_bCompiling = false;
+                m_bHasCompiledModule = true;
+            }
+        }
+
+        bool IsCompiling() override
+        {
+            return m_bCompiling;
+        }
+
+        bool HasCompiledModule() override
+        {
+            return m_bHasCompiledModule;
+        }
+
+        fs::path PopModule() override
+        {
+            m_bHasCompiledModule = false;
+            return fs::path();
+        }
+
+    private:
+        bool m_bCompiling = false;
+        bool m_bHasCompiledModule = false;
+        std::chrono::steady_clock::time_point m_BuildEndTime;
+    };
+
+    TEST_CASE("Hotswapper can estimate the cost of rebuilding after a file changes.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "simple-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path srcPath = CALL(Canonical, sandboxPath / "src");
+
+        CALL(NewFile, srcPath / "Shared.h", "#pragma once\nhscpp_module(\"shared\")\nint Shared();\n");
+        CALL(NewFile, srcPath / "Shared.cpp", "#include \"Shared.h\"\nhscpp_module(\"shared\")\nint Shared() { return 0; }\n");
+        CALL(NewFile, srcPath / "Cheap.cpp", "#include \"Shared.h\"\nint Cheap() { return Shared(); }\n");
+        CALL(NewFile, srcPath / "Expensive.cpp", "#include \"Shared.h\"\nint Expensive() { return Shared(); }\n");
+        CALL(NewFile, srcPath / "Unrelated.cpp", "int Unrelated() { return 0; }\n");
+
+        FakeFileWatcher* pFileWatcher = new FakeFileWatcher();
+        FakeCompiler* pCompiler = new FakeCompiler();
+
+        Hotswapper swapper(std::unique_ptr<Config>(new Config()),
+            std::unique_ptr<IFileWatcher>(pFileWatcher),
+            std::unique_ptr<ICompiler>(pCompiler),
+            nullptr);
+
+        swapper.EnableFeature(Feature::DependentCompilation);
+        swapper.AddSourceDirectory(srcPath);
+        swapper.AddIncludeDirectory(srcPath);
+
+        // Change a file, and wait for its compile to finish.
+        auto Compile = [&](const fs::path& filePath, Milliseconds buildDuration) {
+            CALL(NewFile, filePath, CALL(FileToString, filePath) + "\n// Changed.\n");
+
+            IFileWatcher::Event event;
+            event.type = IFileWatcher::Event::Type::Modified;
+            event.filePath = filePath;
+            pFileWatcher->events.push_back(event);
+
+            pCompiler->buildDuration = buildDuration;
+            REQUIRE(swapper.Update() == Hotswapper::UpdateResult::StartedCompiling);
+
+            CALL(StartUpdateLoop, Milliseconds(5000), Milliseconds(10), [&](Milliseconds) {
+                Hotswapper::UpdateResult result = swapper.Update();
+                return (result == Hotswapper::UpdateResult::PerformedSwap || result == Hotswapper::UpdateResult::FailedSwap)
+                       ? UpdateLoop::Done
+                       : UpdateLoop::Running;
+            });
+        };
+
+        auto GetSourceFilePaths = [](const std::vector<Hotswapper::CompileCost>& costs) {
+            std::vector<fs::path> sourceFilePaths;
+            for (const auto& cost : costs)
+            {
+                sourceFilePaths.push_back(cost.sourceFilePath);
+            }
+
+            return sourceFilePaths;
+        };
+
+        // Nothing has been compiled yet.
+        std::vector<Hotswapper::CompileCost> costs = swapper.QueryRebuildImpact(srcPath / "Shared.h");
+        CALL(ValidateUnorderedVector, GetSourceFilePaths(costs), {
+            srcPath / "Shared.cpp",
+            srcPath / "Cheap.cpp",
+            srcPath / "Expensive.cpp",
+        });
+
+        for (const auto& cost : costs)
+        {
+            REQUIRE_FALSE(cost.bMeasured);
+        }
+
+        CALL(Compile, srcPath / "Expensive.cpp", Milliseconds(200));
+        CALL(Compile, srcPath / "Cheap.cpp", Milliseconds(20));
+
+        SECTION("Dependents are ordered from most to least expensive.")
+        {
+            // Each compile also built Shared.cpp, which the dependents link against. The time of a
+            // compile is split evenly between its files.
+            costs = swapper.QueryRebuildImpact(srcPath / "Shared.h");
+            CALL(ValidateUnorderedVector, GetSourceFilePaths(costs), {
+                srcPath / "Shared.cpp",
+                srcPath / "Cheap.cpp",
+                srcPath / "Expensive.cpp",
+            });
+
+            REQUIRE(costs.at(0).sourceFilePath == srcPath / "Expensive.cpp");
+
+            for (size_t i = 0; i < costs.size(); ++i)
+            {
+                REQUIRE(costs.at(i).bMeasured);
+
+                if (i > 0)
+                {
+                    REQUIRE(costs.at(i).lastCompileDuration <= costs.at(i - 1).lastCompileDuration);
+                }
+            }
+
+            auto cheapIt = std::find_if(costs.begin(), costs.end(), [&srcPath](const Hotswapper::CompileCost& cost) {
+                return cost.sourceFilePath == srcPath / "Cheap.cpp";
+            });
+
+            REQUIRE(cheapIt->lastCompileDuration < costs.at(0).lastCompileDuration);
+        }
+
+        SECTION("Files that were never compiled are not measured.")
+        {
+            costs = swapper.QueryRebuildImpact(srcPath / "Unrelated.cpp");
+            REQUIRE(costs.size() == 1);
+            REQUIRE(costs.at(0).sourceFilePath == srcPath / "Unrelated.cpp");
+            REQUIRE_FALSE(costs.at(0).bMeasured);
+        }
+
+        SECTION("Missing files have no impact.")
+        {
+            REQUIRE(swapper.QueryRebuildImpact(srcPath / "Missing.cpp").empty());
+        }
+    }
+
+}}
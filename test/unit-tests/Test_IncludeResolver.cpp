@@ -0,0 +1,113 @@
+#include "catch/catch.hpp"
+#include "common/Common.h"
+#include "hscpp/preprocessor/IncludeResolver.h"
+#include "hscpp/Util.h"
+
+namespace hscpp { namespace test
+{
+
+    const static fs::path TEST_FILES_PATH = util::GetHscppTestPath() / "unit-tests" / "files" / "test-preprocessor";
+
+    TEST_CASE("IncludeResolver resolves includes and tracks file changes.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "dependent-compilation-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+
+        IncludeResolver resolver;
+        fs::path canonicalPath;
+
+        REQUIRE(resolver.Resolve(sandboxPath, "Math.h", canonicalPath));
+        REQUIRE(canonicalPath == CALL(Canonical, sandboxPath / "Math.h"));
+
+        // Resolved a second time from the cache.
+        REQUIRE(resolver.Resolve(sandboxPath, "Math.h", canonicalPath));
+        REQUIRE(canonicalPath == CALL(Canonical, sandboxPath / "Math.h"));
+
+        REQUIRE(resolver.Resolve(sandboxPath / "..", (sandboxPath.filename() / "Vector.h").u8string(), canonicalPath));
+        REQUIRE(canonicalPath == CALL(Canonical, sandboxPath / "Vector.h"));
+
+        REQUIRE_FALSE(resolver.Resolve(sandboxPath, "sub/New.h", canonicalPath));
+
+        fs::create_directory(sandboxPath / "sub");
+        CALL(NewFile, sandboxPath / "sub" / "New.h", "");
+
+        resolver.Invalidate(CALL(Canonical, sandboxPath / "sub" / "New.h"), true);
+        REQUIRE(resolver.Resolve(sandboxPath, "sub/New.h", canonicalPath));
+        REQUIRE(canonicalPath == CALL(Canonical, sandboxPath / "sub" / "New.h"));
+
+        fs::path canonicalNewPath = CALL(Canonical, sandboxPath / "sub" / "New.h");
+        CALL(RemoveFile, sandboxPath / "sub" / "New.h");
+
+        // Not yet told of the removed file.
+        REQUIRE(resolver.Resolve(sandboxPath, "sub/New.h", canonicalPath));
+
+        resolver.Invalidate(canonicalNewPath, false);
+        REQUIRE_FALSE(resolver.Resolve(sandboxPath, "sub/New.h", canonicalPath));
+
+        // A stale cache is dropped on Clear.
+        CALL(NewFile, sandboxPath / "sub" / "New.h", "");
+        REQUIRE(resolver.Resolve(sandboxPath, "sub/New.h", canonicalPath));
+
+        CALL(RemoveFile, sandboxPath / "sub" / "New.h");
+        resolver.Clear();
+        REQUIRE_FALSE(resolver.Resolve(sandboxPath, "sub/New.h", canonicalPath));
+    }
+
+    TEST_CASE("IncludeResolver finds files created in directories that are not watched.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "dependent-compilation-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+
+        IncludeResolver resolver;
+        fs::path canonicalPath;
+
+        // No file events are received for an unwatched include directory.
+        REQUIRE_FALSE(resolver.Resolve(sandboxPath, "New.h", canonicalPath));
+        REQUIRE_FALSE(resolver.Resolve(sandboxPath, "sub/New.h", canonicalPath));
+
+        CALL(NewFile, sandboxPath / "New.h", "");
+        REQUIRE(resolver.Resolve(sandboxPath, "New.h", canonicalPath));
+        REQUIRE(canonicalPath == CALL(Canonical, sandboxPath / "New.h"));
+
+        fs::create_directory(sandboxPath / "sub");
+        CALL(NewFile, sandboxPath / "sub" / "New.h", "");
+        REQUIRE(resolver.Resolve(sandboxPath, "sub/New.h", canonicalPath));
+        REQUIRE(canonicalPath == CALL(Canonical, sandboxPath / "sub" / "New.h"));
+    }
+
+    TEST_CASE("IncludeResolver finds files created behind a symlinked directory.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "dependent-compilation-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+
+        fs::create_directory(sandboxPath / "target");
+
+        std::error_code error;
+        fs::create_directory_symlink(sandboxPath / "target", sandboxPath / "linked", error);
+        if (error)
+        {
+            WARN("Skipping test, as directory symlinks cannot be created.");
+            return;
+        }
+
+        IncludeResolver resolver;
+        fs::path canonicalPath;
+
+        REQUIRE_FALSE(resolver.Resolve(sandboxPath, "linked/New.h", canonicalPath));
+
+        // The watcher reports the file under its canonical path, within the target directory.
+        CALL(NewFile, sandboxPath / "target" / "New.h", "");
+        resolver.Invalidate(CALL(Canonical, sandboxPath / "target" / "New.h"), true);
+
+        REQUIRE(resolver.Resolve(sandboxPath, "linked/New.h", canonicalPath));
+        REQUIRE(canonicalPath == CALL(Canonical, sandboxPath / "target" / "New.h"));
+
+        // Removal is seen through the symlink as well.
+        fs::path canonicalNewPath = canonicalPath;
+        CALL(RemoveFile, sandboxPath / "target" / "New.h");
+        resolver.Invalidate(canonicalNewPath, false);
+
+        REQUIRE_FALSE(resolver.Resolve(sandboxPath, "linked/New.h", canonicalPath));
+    }
+
+}}
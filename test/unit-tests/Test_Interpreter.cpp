@@ -123,6 +123,65 @@ namespace hscpp { namespace test
         CALL(ValidateSingleMessage, result, "else");
     }
 
+    TEST_CASE("Interpreter can omit includes that are not compiled.")
+    {
+        std::string program = R"(
+            #include "always.h"
+            #ifdef NOT_DEFINED_ANYWHERE
+                #include "unknown.h"
+            #endif
+            #if defined(DEFINED) && !defined(DEFINED)
+                #include "never.h"
+            #elif DEFINED == 2
+                #include "elif.h"
+                #if 0
+                    #include "nested.h"
+                #else
+                    #include "nested-else.h"
+                #endif
+            #else
+                #include "else.h"
+            #endif
+        )";
+
+        Lexer lexer;
+        Parser parser;
+        Interpreter interpreter;
+
+        std::vector<Token> tokens;
+        REQUIRE(lexer.Lex(program, tokens));
+
+        std::unique_ptr<Stmt> pRootStmt;
+        REQUIRE(parser.Parse(tokens, pRootStmt));
+
+        VarStore store;
+        Interpreter::Result result;
+
+        // Without a ConditionEvaluator, all includes are kept.
+        REQUIRE(interpreter.Evaluate(*pRootStmt, store, result));
+        REQUIRE(result.includePaths.size() == 7);
+
+        ConditionEvaluator conditionEvaluator;
+        conditionEvaluator.SetDefinitions({ "DEFINED=2" });
+
+        REQUIRE(interpreter.Evaluate(*pRootStmt, store, conditionEvaluator, result));
+        CALL(ValidateUnorderedVector, result.includePaths, {
+            "always.h",
+            "unknown.h",
+            "elif.h",
+            "nested-else.h",
+        });
+
+        conditionEvaluator.SetDefinitions({ "DEFINED=3" });
+
+        REQUIRE(interpreter.Evaluate(*pRootStmt, store, conditionEvaluator, result));
+        CALL(ValidateUnorderedVector, result.includePaths, {
+            "always.h",
+            "unknown.h",
+            "else.h",
+        });
+    }
+
     TEST_CASE("Interpreter can evaluate basic expressions.")
     {
         VarStore store;
@@ -20,6 +20,65 @@ namespace hscpp { namespace test
 
         REQUIRE_FALSE(lexer.Lex(program, tokens));
         CALL(ValidateError, lexer.GetLastError(), expectedCode, expectedLine, expectedArgs);
+
+        REQUIRE_FALSE(lexer.LexRelevant(program.data(), program.size(), tokens));
+        CALL(ValidateError, lexer.GetLastError(), expectedCode, expectedLine, expectedArgs);
+    }
+
+    // LexRelevant should produce the same tokens as Lex, minus those outside of #include, hscpp, and
+    // conditional directive statements.
+    static void ValidateRelevant(const std::string& program)
+    {
+        std::vector<Token> allTokens;
+        std::vector<Token> relevantTokens;
+
+        Lexer lexer;
+        REQUIRE(lexer.Lex(program, allTokens));
+        REQUIRE(lexer.LexRelevant(program.data(), program.size(), relevantTokens));
+
+        std::vector<Token> expectedTokens;
+        bool bInStatement = false;
+        int depth = 0;
+
+        for (const auto& token : allTokens)
+        {
+            if (!bInStatement)
+            {
+                // #include and hscpp keywords are at the end of Token::Type.
+                if (static_cast<int>(token.type) < static_cast<int>(Token::Type::Include))
+                {
+                    continue;
+                }
+
+                // Conditional directives are statements on their own.
+                bInStatement = (token.type < Token::Type::If || token.type > Token::Type::Endif);
+                depth = 0;
+            }
+            else
+            {
+                if (token.type == Token::Type::LeftParen)
+                {
+                    ++depth;
+                }
+                else if (token.type == Token::Type::RightParen)
+                {
+                    --depth;
+                }
+
+                bInStatement = (depth > 0);
+            }
+
+            expectedTokens.push_back(token);
+        }
+
+        REQUIRE(relevantTokens.size() == expectedTokens.size());
+        for (size_t i = 0; i < expectedTokens.size(); ++i)
+        {
+            REQUIRE(relevantTokens.at(i).type == expectedTokens.at(i).type);
+            REQUIRE(relevantTokens.at(i).value == expectedTokens.at(i).value);
+            REQUIRE(relevantTokens.at(i).line == expectedTokens.at(i).line);
+            REQUIRE(relevantTokens.at(i).column == expectedTokens.at(i).column);
+        }
     }
 
     TEST_CASE("Lexer can lex all tokens.")
@@ -239,6 +298,51 @@ namespace hscpp { namespace test
         REQUIRE(tokens.at(9).value == "FILENAME");
     }
 
+    TEST_CASE("Lexer can lex conditional directives.")
+    {
+        std::string str = R"PROGRAM(
+            #if defined(_WIN32) && !defined(A) // Comment.
+            #include "a.h"
+            #elif A > \
+1
+            #  ifdef   B
+            #ifndef C /* Comment. */
+            #elifdef D
+            #elifndef E
+            #else // Comment.
+            #endif
+            #iff
+            #define ifdef
+            hscpp_module("module")
+        )PROGRAM";
+
+        CALL(ValidateRelevant, str);
+
+        std::vector<Token> tokens;
+
+        Lexer lexer;
+        REQUIRE(lexer.LexRelevant(str.data(), str.size(), tokens));
+        REQUIRE(tokens.size() == 14);
+
+        REQUIRE(tokens.at(0).type == Token::Type::If);
+        REQUIRE(tokens.at(0).value == "defined(_WIN32) && !defined(A)");
+        REQUIRE(tokens.at(1).type == Token::Type::Include);
+        REQUIRE(tokens.at(2).value == "a.h");
+        REQUIRE(tokens.at(3).type == Token::Type::Elif);
+        REQUIRE(tokens.at(3).value == "A >  1");
+        REQUIRE(tokens.at(4).type == Token::Type::If);
+        REQUIRE(tokens.at(4).value == "defined(B)");
+        REQUIRE(tokens.at(5).type == Token::Type::If);
+        REQUIRE(tokens.at(5).value == "!defined(C)");
+        REQUIRE(tokens.at(6).type == Token::Type::Elif);
+        REQUIRE(tokens.at(6).value == "defined(D)");
+        REQUIRE(tokens.at(7).type == Token::Type::Elif);
+        REQUIRE(tokens.at(7).value == "!defined(E)");
+        REQUIRE(tokens.at(8).type == Token::Type::Else);
+        REQUIRE(tokens.at(9).type == Token::Type::Endif);
+        REQUIRE(tokens.at(10).type == Token::Type::HscppModule);
+    }
+
     TEST_CASE("Lexer can make it through complex C++ files.")
     {
         std::vector<Token> tokens;
@@ -260,6 +364,46 @@ namespace hscpp { namespace test
         REQUIRE(tokens.size() > 1000);
     }
 
+    TEST_CASE("Lexer can lex only relevant tokens.")
+    {
+        std::string str = R"PROGRAM(
+            #include <vector>
+            #include "Header.h" // hscpp_module("in-line-comment")
+            /* hscpp_module("in-block-comment") */ hscpp_module("after-block-comment")
+            const char* pStr = "hscpp_module(\"in-string\")"; hscpp_message("after-string")
+            int xhscpp_module = 0; int hscpp_modulex = 0; int _hscpp_module = 0; int a1hscpp_module;
+            int y = 12hscpp_module("after-number") + 1.5hscpp_message("after-decimal");
+            hscpp_require_source("a.cpp", "b.cpp")
+            hscpp_if (os == "Windows" && (a || b))
+                hscpp_require_library("lib")
+            hscpp_elif (true)
+                void Function(int x) { return (x * 2) / 3; }
+            hscpp_else()
+            hscpp_end()
+            HSCPP_TRACK(Type, "Key");
+              #  include"x.h"
+            # define X hscpp_message("in-define")
+            #define_hscpp_module
+            hash hscpp_return() hscpp_module hscpp_message
+            hscpp_require_preprocessor_def(A, B
+        )PROGRAM";
+
+        CALL(ValidateRelevant, str);
+
+        std::vector<Token> tokens;
+
+        Lexer lexer;
+        REQUIRE(lexer.LexRelevant(str.data(), str.size(), tokens));
+        REQUIRE(tokens.at(0).type == Token::Type::Include);
+        REQUIRE(tokens.at(1).value == "vector");
+        REQUIRE(tokens.at(4).type == Token::Type::HscppModule);
+        REQUIRE(tokens.at(6).value == "after-block-comment");
+
+        CALL(ValidateRelevant, CALL(FileToString, CLANG_FILES_PATH / "Lexer.cpp"));
+        CALL(ValidateRelevant, CALL(FileToString, BOOST_FILE_PATH / "crc.hpp"));
+        CALL(ValidateRelevant, CALL(FileToString, BOOST_FILE_PATH / "future.hpp"));
+    }
+
     TEST_CASE("Lexer handles errors correctly.")
     {
         std::vector<Token> tokens;
@@ -1,3 +1,5 @@
+#include <fstream>
+
 #include "catch/catch.hpp"
 #include "common/Common.h"
 #include "hscpp/Util.h"
@@ -44,6 +46,38 @@ namespace hscpp { namespace test
         });
     }
 
+    TEST_CASE("Preprocessor reprocesses files only when their content or variables change.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "require-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+
+        Preprocessor preprocessor;
+        preprocessor.SetVar("num", Variant(2.0));
+
+        Preprocessor::Output output;
+        REQUIRE(preprocessor.Preprocess({ sandboxPath / "Source1.cpp" }, output));
+        CALL(ValidateUnorderedVector, output.preprocessorDefinitions, {
+            "PREPROCESSOR2", "IF", "SOURCE2", "SOURCE3",
+        });
+
+        REQUIRE(preprocessor.Preprocess({ sandboxPath / "Source1.cpp" }, output));
+        CALL(ValidateUnorderedVector, output.preprocessorDefinitions, {
+            "PREPROCESSOR2", "IF", "SOURCE2", "SOURCE3",
+        });
+
+        preprocessor.SetVar("num", Variant(3.0));
+        REQUIRE(preprocessor.Preprocess({ sandboxPath / "Source1.cpp" }, output));
+        CALL(ValidateUnorderedVector, output.preprocessorDefinitions, {
+            "ELIF", "SOURCE2", "SOURCE3",
+        });
+
+        CALL(NewFile, sandboxPath / "Source1.cpp", "hscpp_require_preprocessor_def(CHANGED)");
+        REQUIRE(preprocessor.Preprocess({ sandboxPath / "Source1.cpp" }, output));
+        CALL(ValidateUnorderedVector, output.preprocessorDefinitions, {
+            "CHANGED",
+        });
+    }
+
     TEST_CASE("Preprocessor can handle dependent compilation.")
     {
         fs::path assetsPath = TEST_FILES_PATH / "dependent-compilation-test";
@@ -184,6 +218,273 @@ namespace hscpp { namespace test
         }
     }
 
+    TEST_CASE("Preprocessor can resolve the source files compiled when a file changes.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "dependent-compilation-test";
+
+        Preprocessor preprocessor;
+        preprocessor.UpdateDependencyGraph({
+            assetsPath / "Math.cpp",
+            assetsPath / "Math.h",
+            assetsPath / "MathDependency.cpp",
+            assetsPath / "Vector.cpp",
+            assetsPath / "Vector.h",
+            assetsPath / "VectorDependency.cpp",
+            assetsPath / "VectorAndMathDependency.cpp",
+        }, {}, { assetsPath });
+
+        CALL(ValidateUnorderedVector, preprocessor.ResolveDependencyGraph({ assetsPath / "Math.h" }), {
+            assetsPath / "Math.cpp",
+            assetsPath / "MathDependency.cpp",
+            assetsPath / "VectorAndMathDependency.cpp",
+            assetsPath / "Vector.cpp",
+        });
+
+        CALL(ValidateUnorderedVector, preprocessor.ResolveDependencyGraph({ assetsPath / "VectorDependency.cpp" }), {
+            assetsPath / "VectorDependency.cpp",
+            assetsPath / "Vector.cpp",
+        });
+
+        // Resolving does not process files, so the Output of Preprocess is unaffected.
+        Preprocessor::Output output;
+        REQUIRE(preprocessor.Preprocess({ assetsPath / "MathDependency.cpp" }, output));
+        CALL(ValidateUnorderedVector, output.sourceFiles, {
+            assetsPath / "Math.cpp",
+            assetsPath / "MathDependency.cpp",
+        });
+    }
+
+    TEST_CASE("Preprocessor can reuse a saved dependency graph cache.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "dependent-compilation-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+        fs::path cachePath = sandboxPath / "dependency-graph.cache";
+
+        std::vector<fs::path> filePaths = {
+            sandboxPath / "Math.cpp",
+            sandboxPath / "Math.h",
+            sandboxPath / "MathDependency.cpp",
+        };
+
+        std::vector<fs::path> mathPaths = {
+            sandboxPath / "Math.cpp",
+            sandboxPath / "MathDependency.cpp",
+        };
+
+        {
+            Preprocessor preprocessor;
+            preprocessor.SetVar("var", Variant(1.0));
+            preprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+            REQUIRE(preprocessor.SaveDependencyGraphCache(cachePath));
+        }
+
+        // Break the include without changing the file's size or modification time. A preprocessor
+        // that loads the cache should not notice the change.
+        fs::path mathDependencyPath = sandboxPath / "MathDependency.cpp";
+        auto modificationTime = fs::last_write_time(mathDependencyPath);
+        CALL(NewFile, mathDependencyPath, "#include \"Mxth.h\"");
+        fs::last_write_time(mathDependencyPath, modificationTime);
+
+        Preprocessor::Output output;
+
+        SECTION("Unchanged files are not processed again.")
+        {
+            Preprocessor preprocessor;
+            preprocessor.SetVar("var", Variant(1.0));
+            REQUIRE(preprocessor.LoadDependencyGraphCache(cachePath));
+            preprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+
+            REQUIRE(preprocessor.Preprocess({ sandboxPath / "Math.cpp" }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, mathPaths);
+        }
+
+        SECTION("Modified files are processed again.")
+        {
+            CALL(NewFile, mathDependencyPath, "#include \"Mxth.hpp\"");
+
+            Preprocessor preprocessor;
+            preprocessor.SetVar("var", Variant(1.0));
+            REQUIRE(preprocessor.LoadDependencyGraphCache(cachePath));
+            preprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+
+            REQUIRE(preprocessor.Preprocess({ sandboxPath / "Math.cpp" }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, { sandboxPath / "Math.cpp" });
+        }
+
+        SECTION("Cache is rejected if variables differ.")
+        {
+            Preprocessor preprocessor;
+            preprocessor.SetVar("var", Variant(2.0));
+            REQUIRE_FALSE(preprocessor.LoadDependencyGraphCache(cachePath));
+            preprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+
+            REQUIRE(preprocessor.Preprocess({ sandboxPath / "Math.cpp" }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, { sandboxPath / "Math.cpp" });
+        }
+
+        SECTION("Cache is rejected if its variables key has a corrupt length.")
+        {
+            // The key length follows the 4 byte magic and 4 byte version.
+            std::fstream cacheFile(cachePath.u8string(), std::ios::binary | std::ios::in | std::ios::out);
+            REQUIRE(cacheFile.is_open());
+
+            uint32_t corruptLength = 0xFFFFFFF0;
+            cacheFile.seekp(8);
+            cacheFile.write(reinterpret_cast<const char*>(&corruptLength), sizeof(corruptLength));
+            cacheFile.close();
+
+            Preprocessor preprocessor;
+            preprocessor.SetVar("var", Variant(1.0));
+            REQUIRE_FALSE(preprocessor.LoadDependencyGraphCache(cachePath));
+        }
+
+        SECTION("Cache is discarded when a variable changes.")
+        {
+            Preprocessor preprocessor;
+            preprocessor.SetVar("var", Variant(1.0));
+            REQUIRE(preprocessor.LoadDependencyGraphCache(cachePath));
+            preprocessor.SetVar("var", Variant(3.0));
+            preprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+
+            REQUIRE(preprocessor.Preprocess({ sandboxPath / "Math.cpp" }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, { sandboxPath / "Math.cpp" });
+        }
+    }
+
+    TEST_CASE("Preprocessor gives the same results when processing files in parallel.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "dependent-compilation-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+
+        // Create a chain of headers, each including the last, and a source file for each header. All
+        // belong to the same module, so that compiling one file compiles them all.
+        const size_t N_FILES = 100;
+
+        std::vector<fs::path> filePaths;
+        for (size_t i = 0; i < N_FILES; ++i)
+        {
+            std::string name = "Gen" + std::to_string(i);
+
+            std::string headerContent = "hscpp_module(\"gen\")\n";
+            if (i > 0)
+            {
+                headerContent += "#include \"Gen" + std::to_string(i - 1) + ".h\"\n";
+            }
+
+            std::string sourceContent = "#include \"" + name + ".h\"\n"
+                + "hscpp_module(\"gen\")\n"
+                + "hscpp_require_preprocessor_def(\"" + name + "\")\n";
+
+            CALL(NewFile, sandboxPath / (name + ".h"), headerContent);
+            CALL(NewFile, sandboxPath / (name + ".cpp"), sourceContent);
+
+            filePaths.push_back(sandboxPath / (name + ".h"));
+            filePaths.push_back(sandboxPath / (name + ".cpp"));
+        }
+
+        PreprocessorConfig serialConfig;
+        serialConfig.nThreads = 1;
+
+        PreprocessorConfig parallelConfig;
+        parallelConfig.nThreads = 4;
+
+        Preprocessor serialPreprocessor(serialConfig);
+        Preprocessor parallelPreprocessor(parallelConfig);
+
+        serialPreprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+        parallelPreprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+
+        for (const auto& filePath : { sandboxPath / "Gen0.cpp", sandboxPath / "Gen50.h" })
+        {
+            Preprocessor::Output serialOutput;
+            Preprocessor::Output parallelOutput;
+
+            REQUIRE(serialPreprocessor.Preprocess({ filePath }, serialOutput));
+            REQUIRE(parallelPreprocessor.Preprocess({ filePath }, parallelOutput));
+
+            REQUIRE(parallelOutput.sourceFiles.size() >= N_FILES);
+            CALL(ValidateUnorderedVector, parallelOutput.sourceFiles, serialOutput.sourceFiles);
+            CALL(ValidateUnorderedVector, parallelOutput.preprocessorDefinitions,
+                serialOutput.preprocessorDefinitions);
+        }
+    }
+
+    TEST_CASE("Preprocessor omits includes that are not compiled from the dependency graph.")
+    {
+        fs::path assetsPath = TEST_FILES_PATH / "dependent-compilation-test";
+        fs::path sandboxPath = CALL(InitializeSandbox, assetsPath);
+
+        CALL(NewFile, sandboxPath / "Platform.cpp",
+            "#ifdef USE_A\n"
+            "    #include \"A.h\"\n"
+            "#else\n"
+            "    #include \"B.h\"\n"
+            "#endif\n");
+
+        CALL(NewFile, sandboxPath / "A.h", "hscpp_module(\"a\")");
+        CALL(NewFile, sandboxPath / "A.cpp", "hscpp_module(\"a\")");
+        CALL(NewFile, sandboxPath / "B.h", "hscpp_module(\"b\")");
+        CALL(NewFile, sandboxPath / "B.cpp", "hscpp_module(\"b\")");
+
+        std::vector<fs::path> filePaths = {
+            sandboxPath / "Platform.cpp",
+            sandboxPath / "A.h",
+            sandboxPath / "A.cpp",
+            sandboxPath / "B.h",
+            sandboxPath / "B.cpp",
+        };
+
+        Preprocessor::Output output;
+
+        SECTION("Includes are kept when their conditions cannot be evaluated.")
+        {
+            Preprocessor preprocessor;
+            preprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+
+            REQUIRE(preprocessor.Preprocess({ sandboxPath / "A.cpp" }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, {
+                sandboxPath / "A.cpp",
+                sandboxPath / "B.cpp",
+                sandboxPath / "Platform.cpp",
+            });
+        }
+
+        SECTION("Includes are omitted when their conditions do not hold.")
+        {
+            Preprocessor preprocessor;
+            preprocessor.SetPreprocessorDefinitions({ "USE_A" });
+            preprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+
+            REQUIRE(preprocessor.Preprocess({ sandboxPath / "A.cpp" }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, {
+                sandboxPath / "A.cpp",
+                sandboxPath / "Platform.cpp",
+            });
+
+            REQUIRE(preprocessor.Preprocess({ sandboxPath / "B.cpp" }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, {
+                sandboxPath / "B.cpp",
+            });
+        }
+
+        SECTION("Conditions are not evaluated when disabled.")
+        {
+            PreprocessorConfig config;
+            config.bEvaluateConditionalIncludes = false;
+
+            Preprocessor preprocessor(config);
+            preprocessor.SetPreprocessorDefinitions({ "USE_A" });
+            preprocessor.UpdateDependencyGraph(filePaths, {}, { sandboxPath });
+
+            REQUIRE(preprocessor.Preprocess({ sandboxPath / "B.cpp" }, output));
+            CALL(ValidateUnorderedVector, output.sourceFiles, {
+                sandboxPath / "A.cpp",
+                sandboxPath / "B.cpp",
+                sandboxPath / "Platform.cpp",
+            });
+        }
+    }
+
     TEST_CASE("Preprocessor can handle infinite recursion.")
     {
         // These files all add each other as hscpp_require_sources, validate that this does not
@@ -0,0 +1,74 @@
+#include <thread>
+#include <vector>
+
+#include "catch/catch.hpp"
+#include "hscpp/SpscQueue.h"
+
+namespace hscpp { namespace test
+{
+
+    TEST_CASE("SpscQueue pushes and pops items in order.")
+    {
+        SpscQueue<int> queue(3);
+        REQUIRE(queue.GetCapacity() == 4);
+
+        int value = 0;
+        REQUIRE(!queue.TryPop(value));
+
+        for (int i = 0; i < 4; ++i)
+        {
+            REQUIRE(queue.TryPush(int(i)));
+        }
+
+        REQUIRE(!queue.TryPush(4));
+
+        for (int i = 0; i < 4; ++i)
+        {
+            REQUIRE(queue.TryPop(value));
+            REQUIRE(value == i);
+        }
+
+        REQUIRE(!queue.TryPop(value));
+    }
+
+    TEST_CASE("SpscQueue hands items from one thread to another.")
+    {
+        const int nItems = 100000;
+
+        SpscQueue<std::vector<int>> queue(16);
+
+        std::thread producer([&queue]() {
+            for (int i = 0; i < nItems; ++i)
+            {
+                std::vector<int> item = { i, -i };
+                while (!queue.TryPush(std::move(item)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        int nPopped = 0;
+        bool bInOrder = true;
+
+        std::vector<int> item;
+        while (nPopped < nItems)
+        {
+            if (queue.TryPop(item))
+            {
+                bInOrder = bInOrder && item.size() == 2 && item.at(0) == nPopped && item.at(1) == -nPopped;
+                ++nPopped;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        producer.join();
+
+        REQUIRE(bInOrder);
+        REQUIRE(!queue.TryPop(item));
+    }
+
+}}
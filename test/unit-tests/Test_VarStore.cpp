@@ -74,4 +74,20 @@ namespace hscpp { namespace test
         REQUIRE(store.Interpolate(str) == "Bool: true, Number: 0.5");
     }
 
+    TEST_CASE("VarStore version changes when variables change.")
+    {
+        VarStore store;
+        uint64_t version = store.GetVersion();
+
+        store.SetVar("Var", Variant(1.0));
+        REQUIRE(store.GetVersion() != version);
+        version = store.GetVersion();
+
+        REQUIRE_FALSE(store.RemoveVar("Missing"));
+        REQUIRE(store.GetVersion() == version);
+
+        REQUIRE(store.RemoveVar("Var"));
+        REQUIRE(store.GetVersion() != version);
+    }
+
 }}
\ No newline at end of file
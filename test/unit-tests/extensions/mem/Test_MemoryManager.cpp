@@ -7,6 +7,7 @@
 #include "hscpp/Platform.h"
 #include "hscpp/Util.h"
 #include "hscpp/Hotswapper.h"
+#include "hscpp/module/Tracker.h"
 
 namespace hscpp { namespace test {
 
@@ -16,6 +17,54 @@ namespace hscpp { namespace test {
     template <typename T>
     using Ref = hscpp::mem::Ref<T>;
 
+    template <typename T>
+    using SharedRef = hscpp::mem::SharedRef<T>;
+
+    template <typename T>
+    using WeakRef = hscpp::mem::WeakRef<T>;
+
+    class CompactedData
+    {
+        HSCPP_TRACK(CompactedData, "hscpp::test::CompactedData");
+
+    public:
+        int value = 0;
+
+        CompactedData()
+        {
+            auto cb = [this](SwapInfo& info) {
+                info.Save("value", value);
+            };
+
+            Hscpp_SetSwapHandler(cb);
+        }
+    };
+
+    class OtherCompactedData
+    {
+        HSCPP_TRACK(OtherCompactedData, "hscpp::test::OtherCompactedData");
+
+    public:
+        double value = 0;
+
+        OtherCompactedData()
+        {
+            auto cb = [this](SwapInfo& info) {
+                info.Save("value", value);
+            };
+
+            Hscpp_SetSwapHandler(cb);
+        }
+    };
+
+    class UncompactedData
+    {
+        HSCPP_TRACK(UncompactedData, "hscpp::test::UncompactedData");
+
+    public:
+        int value = 0;
+    };
+
     void RunTest(const std::function<void(UniqueRef<hscpp::mem::MemoryManager>)>& cb)
     {
         UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create();
@@ -74,12 +123,14 @@ namespace hscpp { namespace test {
                 UniqueRef<Data> rMoreUniqueData = rMemoryManager->Allocate<Data>();
                 REQUIRE(rMemoryManager->GetNumBlocks() == 2);
 
-                // The original memory should be reused, so the old Ref should work again. This
-                // is because the MemoryManager will recycle old memory blocks.
+                // The original Block is recycled, but the old Ref refers to a previous generation
+                // of the Block, so it must remain invalid.
                 rUniqueData = std::move(rMoreUniqueData);
                 REQUIRE(rMemoryManager->GetNumBlocks() == 1);
-                REQUIRE(rData->a == 100);
-                REQUIRE(rData->b == 1.5);
+                CHECK_THROWS(rData->a);
+                CHECK_THROWS(rData->b);
+                REQUIRE(rUniqueData->a == 100);
+                REQUIRE(rUniqueData->b == 1.5);
 
                 // Data has been moved.
                 CHECK_THROWS(rMoreUniqueData->a);
@@ -93,6 +144,109 @@ namespace hscpp { namespace test {
         CALL(RunTest, cb);
     }
 
+    TEST_CASE("MemoryManager can share ownership with SharedRefs and WeakRefs.")
+    {
+        auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager){
+            static size_t nDestructed = 0;
+            nDestructed = 0;
+
+            struct Data
+            {
+                int a = 100;
+
+                ~Data()
+                {
+                    ++nDestructed;
+                }
+            };
+
+            WeakRef<Data> rWeakData;
+
+            // Intentional scope.
+            {
+                SharedRef<Data> rSharedData = rMemoryManager->AllocateShared<Data>();
+                REQUIRE(rMemoryManager->GetNumBlocks() == 1);
+                REQUIRE(rSharedData.GetUseCount() == 1);
+                REQUIRE(rSharedData->a == 100);
+
+                rWeakData = rSharedData;
+                REQUIRE_FALSE(rWeakData.IsExpired());
+
+                // Intentional scope.
+                {
+                    SharedRef<Data> rMoreSharedData = rSharedData;
+                    REQUIRE(rSharedData.GetUseCount() == 2);
+
+                    rMoreSharedData->a = 200;
+                    REQUIRE(rSharedData->a == 200);
+
+                    SharedRef<Data> rLockedData = rWeakData.Lock();
+                    REQUIRE(rSharedData.GetUseCount() == 3);
+                    REQUIRE(rLockedData->a == 200);
+                }
+
+                REQUIRE(rSharedData.GetUseCount() == 1);
+                REQUIRE(nDestructed == 0);
+
+                // Ownership can be taken from a UniqueRef.
+                UniqueRef<Data> rUniqueData = rMemoryManager->Allocate<Data>();
+                SharedRef<Data> rSharedFromUnique = std::move(rUniqueData);
+                REQUIRE(rSharedFromUnique.GetUseCount() == 1);
+                REQUIRE(rMemoryManager->GetNumBlocks() == 2);
+                CHECK_THROWS(rUniqueData->a);
+            }
+
+            // Last owners went out of scope.
+            REQUIRE(nDestructed == 2);
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+            REQUIRE(rWeakData.IsExpired());
+            REQUIRE(rWeakData.Lock().GetUseCount() == 0);
+            CHECK_THROWS(rWeakData.Lock()->a);
+
+            // A WeakRef never locks onto a new object that recycled its Block.
+            SharedRef<Data> rNewData = rMemoryManager->AllocateShared<Data>();
+            REQUIRE(rWeakData.IsExpired());
+            REQUIRE(rNewData.GetUseCount() == 1);
+        };
+
+        CALL(RunTest, cb);
+    }
+
+    TEST_CASE("MemoryManager preserves SharedRef counts across swaps.")
+    {
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create();
+
+        struct Data
+        {
+            int a = 100;
+        };
+
+        SharedRef<Data> rSharedData = rMemoryManager->AllocateShared<Data>();
+        SharedRef<Data> rMoreSharedData = rSharedData;
+        REQUIRE(rSharedData.GetUseCount() == 2);
+
+        // Perform the same steps as hscpp, moving the object into a larger size class.
+        IAllocator* pAllocator = &rMemoryManager;
+
+        Data* pOldData = &rSharedData;
+        pOldData->~Data();
+        uint64_t id = pAllocator->Hscpp_FreeSwap(reinterpret_cast<uint8_t*>(pOldData));
+        REQUIRE(rSharedData.GetUseCount() == 2);
+
+        AllocationInfo info = pAllocator->Hscpp_AllocateSwap(id, 400);
+        new (info.pMemory) Data;
+        REQUIRE(info.pMemory != reinterpret_cast<uint8_t*>(pOldData));
+        REQUIRE(&rSharedData == reinterpret_cast<Data*>(info.pMemory));
+        REQUIRE(rSharedData.GetUseCount() == 2);
+
+        rMoreSharedData.Reset();
+        REQUIRE(rSharedData.GetUseCount() == 1);
+        REQUIRE(rMemoryManager->GetNumBlocks() == 1);
+
+        rSharedData.Reset();
+        REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+    }
+
     TEST_CASE("MemoryManager can handle many allocations.")
     {
         auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager){
@@ -162,4 +316,740 @@ namespace hscpp { namespace test {
 
         CALL(RunTest, cb);
     }
-}}
\ No newline at end of file
+
+    TEST_CASE("MemoryManager respects type alignment.")
+    {
+        auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager){
+            struct alignas(32) AlignedData
+            {
+                float values[8] = {};
+            };
+
+            struct alignas(64) CacheLineData
+            {
+                char c = 'a';
+            };
+
+            std::vector<UniqueRef<AlignedData>> alignedData;
+            std::vector<UniqueRef<CacheLineData>> cacheLineData;
+
+            for (size_t i = 0; i < 100; ++i)
+            {
+                alignedData.push_back(rMemoryManager->Allocate<AlignedData>());
+                cacheLineData.push_back(rMemoryManager->Allocate<CacheLineData>());
+            }
+
+            for (size_t i = 0; i < 100; ++i)
+            {
+                REQUIRE(reinterpret_cast<uintptr_t>(&alignedData.at(i)) % alignof(AlignedData) == 0);
+                REQUIRE(reinterpret_cast<uintptr_t>(&cacheLineData.at(i)) % alignof(CacheLineData) == 0);
+                REQUIRE(cacheLineData.at(i)->c == 'a');
+            }
+        };
+
+        CALL(RunTest, cb);
+    }
+
+    TEST_CASE("MemoryManager can use custom allocation callbacks.")
+    {
+        size_t nAllocations = 0;
+        size_t nFrees = 0;
+
+        hscpp::mem::MemoryManager::Config config;
+        config.AllocateCb = [&](uint64_t size) {
+            ++nAllocations;
+            return new uint8_t[size];
+        };
+        config.FreeCb = [&](uint8_t* pMemory) {
+            ++nFrees;
+            delete[] pMemory;
+        };
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+
+        struct Data
+        {
+            int a = 100;
+        };
+
+        // Intentional scope.
+        {
+            UniqueRef<Data> rData1 = rMemoryManager->Allocate<Data>();
+            UniqueRef<Data> rData2 = rMemoryManager->Allocate<Data>();
+            REQUIRE(rData1->a == 100);
+
+            REQUIRE(nAllocations == 2);
+            REQUIRE(nFrees == 0);
+        }
+
+        REQUIRE(nFrees == 2);
+    }
+
+    TEST_CASE("MemoryManager reuses slots across swaps with the same size class.")
+    {
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create();
+
+        // Drive the allocator through the interface hscpp uses during a runtime swap.
+        IAllocator* pAllocator = &rMemoryManager;
+        hscpp::mem::IMemoryManager* pMemoryManager = &rMemoryManager;
+
+        AllocationInfo info = pAllocator->Hscpp_Allocate(48);
+        REQUIRE(rMemoryManager->GetNumBlocks() == 1);
+
+        uint64_t id = pAllocator->Hscpp_FreeSwap(info.pMemory);
+        REQUIRE(id == info.id);
+
+        // New object falls within the same size class, so the old slot is reused.
+        AllocationInfo swappedInfo = pAllocator->Hscpp_AllocateSwap(id, 48);
+        REQUIRE(swappedInfo.id == info.id);
+        REQUIRE(swappedInfo.pMemory == info.pMemory);
+        REQUIRE(pMemoryManager->GetMemory(id) == info.pMemory);
+
+        // New object is much larger, and requires a new slot.
+        id = pAllocator->Hscpp_FreeSwap(swappedInfo.pMemory);
+        swappedInfo = pAllocator->Hscpp_AllocateSwap(id, 400);
+        REQUIRE(swappedInfo.id == info.id);
+        REQUIRE(swappedInfo.pMemory != info.pMemory);
+        REQUIRE(pMemoryManager->GetMemory(id) == swappedInfo.pMemory);
+
+        pMemoryManager->FreeBlock(id, true);
+        REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+    }
+
+    TEST_CASE("MemoryManager can allocate and free from multiple threads.")
+    {
+        auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager) {
+            struct Data
+            {
+                uint64_t value = 0;
+                uint64_t check = 0;
+            };
+
+            const size_t N_THREADS = 4;
+            const size_t N_ITERATIONS = 5000;
+
+            std::atomic<bool> bFailed = { false };
+            std::atomic<size_t> nFinishedThreads = { 0 };
+
+            std::vector<std::thread> threads;
+            for (size_t iThread = 0; iThread < N_THREADS; ++iThread)
+            {
+                threads.emplace_back([&, iThread]() {
+                    std::vector<UniqueRef<Data>> refs;
+                    for (size_t i = 0; i < N_ITERATIONS; ++i)
+                    {
+                        UniqueRef<Data> rData = rMemoryManager->Allocate<Data>();
+                        rData->value = iThread * N_ITERATIONS + i;
+                        rData->check = ~rData->value;
+                        refs.push_back(std::move(rData));
+
+                        // Free in bursts, so that Blocks move between thread caches and the
+                        // global free list.
+                        if (refs.size() > 100)
+                        {
+                            for (UniqueRef<Data>& rOldData : refs)
+                            {
+                                if (rOldData->check != ~rOldData->value)
+                                {
+                                    bFailed = true;
+                                }
+                            }
+
+                            refs.clear();
+                        }
+                    }
+
+                    nFinishedThreads++;
+                });
+            }
+
+            // Periodically stop the world, as would be done on a runtime swap.
+            while (nFinishedThreads.load() < N_THREADS)
+            {
+                rMemoryManager->StopTheWorld();
+
+                // Other threads are held off, so the Block count is stable. The thread that
+                // stopped the world may still allocate.
+                uint64_t nBlocks = rMemoryManager->GetNumBlocks();
+                uint64_t nBlocksAllocated = 0;
+                {
+                    UniqueRef<Data> rData = rMemoryManager->Allocate<Data>();
+                    nBlocksAllocated = rMemoryManager->GetNumBlocks();
+                }
+                uint64_t nBlocksFreed = rMemoryManager->GetNumBlocks();
+
+                rMemoryManager->ResumeTheWorld();
+
+                REQUIRE(nBlocksAllocated == nBlocks + 1);
+                REQUIRE(nBlocksFreed == nBlocks);
+                std::this_thread::yield();
+            }
+
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            REQUIRE_FALSE(bFailed.load());
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+        };
+
+        hscpp::mem::MemoryManager::Config config;
+        config.bConcurrent = true;
+
+        CALL(cb, hscpp::mem::MemoryManager::Create(config));
+
+        hscpp::Hotswapper swapper;
+        config.pAllocationResolver = swapper.GetAllocationResolver();
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+        swapper.SetAllocator(&rMemoryManager);
+
+        CALL(cb, std::move(rMemoryManager));
+    }
+
+    TEST_CASE("MemoryManager holds off tracked object creation while the world is stopped.")
+    {
+        hscpp::Hotswapper swapper;
+
+        hscpp::mem::MemoryManager::Config config;
+        config.bConcurrent = true;
+        config.pAllocationResolver = swapper.GetAllocationResolver();
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+        swapper.SetAllocator(&rMemoryManager);
+
+        auto canLockTrackers = []() {
+            bool bLocked = false;
+            std::thread thread([&]() {
+                bLocked = ModuleSharedState::s_pTrackersMutex->try_lock();
+                if (bLocked)
+                {
+                    ModuleSharedState::s_pTrackersMutex->unlock();
+                }
+            });
+
+            thread.join();
+            return bLocked;
+        };
+
+        REQUIRE(canLockTrackers());
+
+        // No other thread may construct a tracked object, which could otherwise be built from a
+        // constructor that a swap is about to replace.
+        rMemoryManager->StopTheWorld();
+        REQUIRE_FALSE(canLockTrackers());
+
+        // The thread that stopped the world may still create and rebuild tracked objects.
+        UniqueRef<CompactedData> rData = rMemoryManager->Allocate<CompactedData>();
+        rData->value = 5;
+        swapper.GetAllocationResolver()->RebuildTrackedObjects("hscpp::test::CompactedData");
+        REQUIRE(rData->value == 5);
+
+        rMemoryManager->ResumeTheWorld();
+        REQUIRE(canLockTrackers());
+
+        // Tracked objects created on another thread wait for the world to resume.
+        std::atomic<bool> bAllocated = { false };
+        UniqueRef<CompactedData> rOtherData;
+
+        rMemoryManager->StopTheWorld();
+        std::thread thread([&]() {
+            rOtherData = rMemoryManager->Allocate<CompactedData>();
+            bAllocated = true;
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE_FALSE(bAllocated.load());
+
+        rMemoryManager->ResumeTheWorld();
+        thread.join();
+
+        REQUIRE(bAllocated.load());
+        REQUIRE(rOtherData->value == 0);
+    }
+
+    TEST_CASE("MemoryManager gives thread caches back when threads exit.")
+    {
+        struct Data
+        {
+            uint64_t value = 0;
+        };
+
+        hscpp::mem::MemoryManager::Config config;
+        config.bConcurrent = true;
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+
+        auto allocateOnNewThread = [&]() {
+            uint64_t nThreadCaches = 0;
+            std::thread thread([&]() {
+                UniqueRef<Data> rData = rMemoryManager->Allocate<Data>();
+                nThreadCaches = rMemoryManager->GetNumThreadCaches();
+            });
+
+            thread.join();
+            return nThreadCaches;
+        };
+
+        // Threads come and go, ex. in a job system that rebuilds its pool. Far more of them run
+        // over time than there are caches.
+        REQUIRE(config.maxThreadCaches == 64);
+        for (uint64_t i = 0; i < 2 * config.maxThreadCaches; ++i)
+        {
+            REQUIRE(allocateOnNewThread() == 1);
+            REQUIRE(rMemoryManager->GetNumThreadCaches() == 0);
+        }
+
+        REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+
+        SECTION("Threads may exit after the MemoryManager is destroyed.")
+        {
+            std::atomic<bool> bAllocated = { false };
+            std::atomic<bool> bDestroyed = { false };
+
+            std::thread thread([&]() {
+                {
+                    UniqueRef<Data> rData = rMemoryManager->Allocate<Data>();
+                }
+
+                bAllocated = true;
+                while (!bDestroyed.load())
+                {
+                    std::this_thread::yield();
+                }
+            });
+
+            while (!bAllocated.load())
+            {
+                std::this_thread::yield();
+            }
+
+            REQUIRE(rMemoryManager->GetNumThreadCaches() == 1);
+
+            rMemoryManager.Free();
+            bDestroyed = true;
+
+            thread.join();
+        }
+    }
+
+    TEST_CASE("MemoryManager can compact tracked objects into contiguous memory.")
+    {
+        struct Padding
+        {
+            uint8_t data[40] = {};
+        };
+
+        size_t nAllocations = 0;
+        size_t nFrees = 0;
+
+        hscpp::Hotswapper swapper;
+
+        hscpp::mem::MemoryManager::Config config;
+        config.pAllocationResolver = swapper.GetAllocationResolver();
+        config.AllocateCb = [&](uint64_t size) {
+            ++nAllocations;
+            return new uint8_t[size];
+        };
+        config.FreeCb = [&](uint8_t* pMemory) {
+            ++nFrees;
+            delete[] pMemory;
+        };
+
+        // Intentional scope.
+        {
+            UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+            swapper.SetAllocator(&rMemoryManager);
+
+            // Interleave tracked objects with untracked ones, and free every other tracked object,
+            // leaving the survivors scattered across the heap.
+            std::vector<UniqueRef<CompactedData>> compactedData;
+            std::vector<UniqueRef<Padding>> padding;
+            for (int i = 0; i < 64; ++i)
+            {
+                compactedData.push_back(rMemoryManager->Allocate<CompactedData>());
+                compactedData.back()->value = i;
+                padding.push_back(rMemoryManager->Allocate<Padding>());
+            }
+
+            std::vector<UniqueRef<CompactedData>> liveData;
+            for (size_t i = 0; i < compactedData.size(); i += 2)
+            {
+                liveData.push_back(std::move(compactedData.at(i)));
+            }
+            compactedData.clear();
+
+            UniqueRef<OtherCompactedData> rOtherData = rMemoryManager->Allocate<OtherCompactedData>();
+            rOtherData->value = 1.5;
+
+            UniqueRef<UncompactedData> rUncompactedData = rMemoryManager->Allocate<UncompactedData>();
+            rUncompactedData->value = 7;
+            UncompactedData* pUncompactedData = *rUncompactedData;
+
+            // Only types whose every instance has a swap handler can be rebuilt without losing state.
+            std::vector<std::string> compactableKeys = swapper.GetAllocationResolver()->GetTrackedKeys(true);
+            ValidateUnorderedVector(compactableKeys, {
+                "hscpp::test::CompactedData", "hscpp::test::OtherCompactedData" });
+
+            std::vector<Padding*> paddingMemory;
+            for (const auto& rPadding : padding)
+            {
+                paddingMemory.push_back(*rPadding);
+            }
+
+            uint64_t nBlocks = rMemoryManager->GetNumBlocks();
+
+            // Compact one type at a time.
+            REQUIRE_FALSE(rMemoryManager->Compact(1));
+            REQUIRE(rMemoryManager->Compact(1));
+            REQUIRE(rMemoryManager->GetNumBlocks() == nBlocks);
+
+            // Objects were rebuilt through their swap handler, and are now laid out in order.
+            ptrdiff_t stride = reinterpret_cast<uint8_t*>(*liveData.at(1))
+                - reinterpret_cast<uint8_t*>(*liveData.at(0));
+            REQUIRE(stride >= static_cast<ptrdiff_t>(sizeof(CompactedData)));
+
+            for (size_t i = 0; i < liveData.size(); ++i)
+            {
+                REQUIRE(liveData.at(i)->value == static_cast<int>(2 * i));
+
+                if (i > 0)
+                {
+                    REQUIRE(reinterpret_cast<uint8_t*>(*liveData.at(i))
+                        - reinterpret_cast<uint8_t*>(*liveData.at(i - 1)) == stride);
+                }
+            }
+
+            REQUIRE(rOtherData->value == 1.5);
+
+            // Types without a swap handler are left untouched.
+            REQUIRE(*rUncompactedData == pUncompactedData);
+            REQUIRE(rUncompactedData->value == 7);
+
+            // Untracked objects are never moved.
+            for (size_t i = 0; i < padding.size(); ++i)
+            {
+                REQUIRE(*padding.at(i) == paddingMemory.at(i));
+            }
+
+            // Compacting again moves objects into a new Region, and frees the old one.
+            REQUIRE(rMemoryManager->Compact());
+            for (size_t i = 0; i < liveData.size(); ++i)
+            {
+                REQUIRE(liveData.at(i)->value == static_cast<int>(2 * i));
+            }
+
+            liveData.clear();
+            padding.clear();
+            rOtherData = UniqueRef<OtherCompactedData>();
+            rUncompactedData = UniqueRef<UncompactedData>();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+        }
+
+        REQUIRE(nAllocations == nFrees);
+
+        // Without an AllocationResolver, there are no tracked types to compact.
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create();
+        UniqueRef<Padding> rPadding = rMemoryManager->Allocate<Padding>();
+        Padding* pPadding = *rPadding;
+
+        REQUIRE(rMemoryManager->Compact());
+        REQUIRE(*rPadding == pPadding);
+    }
+
+    TEST_CASE("MemoryManager keeps per-type statistics.")
+    {
+        struct Data
+        {
+            uint64_t a = 0;
+            uint64_t b = 0;
+        };
+
+        hscpp::Hotswapper swapper;
+
+        hscpp::mem::MemoryManager::Config config;
+        config.pAllocationResolver = swapper.GetAllocationResolver();
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+        swapper.SetAllocator(&rMemoryManager);
+
+        const std::string dataKey = typeid(Data).name();
+        const std::string compactedDataKey = "hscpp::test::CompactedData";
+
+        hscpp::mem::MemoryStats emptyStats = rMemoryManager->GetStats();
+        REQUIRE(emptyStats.Find(dataKey) == nullptr);
+        REQUIRE(emptyStats.Find(compactedDataKey) == nullptr);
+
+        std::vector<UniqueRef<Data>> data;
+        for (int i = 0; i < 10; ++i)
+        {
+            data.push_back(rMemoryManager->Allocate<Data>());
+        }
+        data.resize(4);
+
+        std::vector<UniqueRef<CompactedData>> compactedData;
+        for (int i = 0; i < 3; ++i)
+        {
+            compactedData.push_back(rMemoryManager->Allocate<CompactedData>());
+        }
+
+        hscpp::mem::MemoryStats stats = rMemoryManager->GetStats();
+
+        const hscpp::mem::TypeStats* pDataStats = stats.Find(dataKey);
+        REQUIRE(pDataStats != nullptr);
+        REQUIRE(pDataStats->nLiveBlocks == 4);
+        REQUIRE(pDataStats->liveBytes == 4 * sizeof(Data));
+        REQUIRE(pDataStats->nAllocations == 10);
+        REQUIRE(pDataStats->nFrees == 6);
+        REQUIRE(pDataStats->highWaterBlocks == 10);
+        REQUIRE(pDataStats->highWaterBytes == 10 * sizeof(Data));
+
+        // Tracked types are allocated through hscpp, and are reported by their HSCPP_TRACK key.
+        const hscpp::mem::TypeStats* pCompactedDataStats = stats.Find(compactedDataKey);
+        REQUIRE(pCompactedDataStats != nullptr);
+        REQUIRE(pCompactedDataStats->nLiveBlocks == 3);
+        REQUIRE(pCompactedDataStats->nAllocations == 3);
+        REQUIRE(pCompactedDataStats->nSwaps == 0);
+
+        // Rebuilding tracked objects goes through the same path as a runtime swap.
+        REQUIRE(rMemoryManager->Compact());
+
+        hscpp::mem::MemoryStats swappedStats = rMemoryManager->GetStats();
+        hscpp::mem::MemoryStatsDiff diff = swappedStats.Diff(stats);
+        REQUIRE(diff.seconds >= 0);
+        REQUIRE(diff.GetLeaks().empty());
+
+        pCompactedDataStats = swappedStats.Find(compactedDataKey);
+        REQUIRE(pCompactedDataStats->nLiveBlocks == 3);
+        REQUIRE(pCompactedDataStats->nAllocations == 3);
+        REQUIRE(pCompactedDataStats->nSwaps == 3);
+
+        // Objects that outlive the later snapshot are reported as leaks.
+        data.push_back(rMemoryManager->Allocate<Data>());
+        compactedData.pop_back();
+
+        diff = rMemoryManager->GetStats().Diff(swappedStats);
+
+        std::vector<hscpp::mem::TypeStatsDiff> leaks = diff.GetLeaks();
+        REQUIRE(leaks.size() == 1);
+        REQUIRE(leaks.at(0).key == dataKey);
+        REQUIRE(leaks.at(0).liveBlocksDelta == 1);
+        REQUIRE(leaks.at(0).liveBytesDelta == sizeof(Data));
+        REQUIRE(leaks.at(0).nAllocations == 1);
+
+        data.clear();
+        compactedData.clear();
+
+        stats = rMemoryManager->GetStats();
+        REQUIRE(stats.Find(dataKey)->nLiveBlocks == 0);
+        REQUIRE(stats.Find(dataKey)->liveBytes == 0);
+        REQUIRE(stats.Find(compactedDataKey)->nLiveBlocks == 0);
+        REQUIRE(stats.Find(compactedDataKey)->nFrees == 3);
+    }
+
+    TEST_CASE("MemoryManager numbers type keys separately for each instance.")
+    {
+        struct Data
+        {
+            uint64_t a = 0;
+            uint64_t b = 0;
+        };
+
+        struct OtherData
+        {
+            uint64_t a = 0;
+            uint64_t b = 0;
+            uint64_t c = 0;
+            uint64_t d = 0;
+        };
+
+        const std::string dataKey = typeid(Data).name();
+        const std::string otherDataKey = typeid(OtherData).name();
+
+        // Each MemoryManager sees the types in a different order, and numbers them differently.
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create();
+        UniqueRef<hscpp::mem::MemoryManager> rOtherMemoryManager = hscpp::mem::MemoryManager::Create();
+
+        UniqueRef<Data> rData = rMemoryManager->Allocate<Data>();
+        UniqueRef<OtherData> rOtherData = rOtherMemoryManager->Allocate<OtherData>();
+        UniqueRef<OtherData> rMoreOtherData = rMemoryManager->Allocate<OtherData>();
+        UniqueRef<Data> rMoreData = rOtherMemoryManager->Allocate<Data>();
+        UniqueRef<Data> rLastData = rOtherMemoryManager->Allocate<Data>();
+
+        hscpp::mem::MemoryStats stats = rMemoryManager->GetStats();
+        REQUIRE(stats.types.size() == 2);
+        REQUIRE(stats.Find(dataKey)->nLiveBlocks == 1);
+        REQUIRE(stats.Find(dataKey)->liveBytes == sizeof(Data));
+        REQUIRE(stats.Find(otherDataKey)->nLiveBlocks == 1);
+        REQUIRE(stats.Find(otherDataKey)->liveBytes == sizeof(OtherData));
+
+        hscpp::mem::MemoryStats otherStats = rOtherMemoryManager->GetStats();
+        REQUIRE(otherStats.types.size() == 2);
+        REQUIRE(otherStats.Find(dataKey)->nLiveBlocks == 2);
+        REQUIRE(otherStats.Find(dataKey)->liveBytes == 2 * sizeof(Data));
+        REQUIRE(otherStats.Find(otherDataKey)->nLiveBlocks == 1);
+        REQUIRE(otherStats.Find(otherDataKey)->liveBytes == sizeof(OtherData));
+    }
+
+    TEST_CASE("MemoryManager can allocate objects contiguously in bulk.")
+    {
+        auto cb = [](UniqueRef<hscpp::mem::MemoryManager> rMemoryManager) {
+            struct Data
+            {
+                uint64_t a = 100;
+                uint64_t b = 200;
+            };
+
+            REQUIRE(rMemoryManager->AllocateN<Data>(0).empty());
+
+            std::vector<UniqueRef<Data>> data = rMemoryManager->AllocateN<Data>(100);
+            REQUIRE(data.size() == 100);
+            REQUIRE(rMemoryManager->GetNumBlocks() == 100);
+
+            ptrdiff_t stride = reinterpret_cast<uint8_t*>(*data.at(1)) - reinterpret_cast<uint8_t*>(*data.at(0));
+            REQUIRE(stride >= static_cast<ptrdiff_t>(sizeof(Data)));
+
+            for (size_t i = 0; i < data.size(); ++i)
+            {
+                REQUIRE(data.at(i)->a == 100);
+                REQUIRE(data.at(i)->b == 200);
+
+                if (i > 0)
+                {
+                    REQUIRE(reinterpret_cast<uint8_t*>(*data.at(i))
+                        - reinterpret_cast<uint8_t*>(*data.at(i - 1)) == stride);
+                }
+            }
+
+            // Objects are freed individually.
+            data.erase(data.begin(), data.begin() + 50);
+            REQUIRE(rMemoryManager->GetNumBlocks() == 50);
+            REQUIRE(data.at(0)->a == 100);
+
+            data.clear();
+            REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+        };
+
+        CALL(RunTest, cb);
+    }
+
+    TEST_CASE("MemoryManager can allocate in bulk from multiple threads.")
+    {
+        struct Data
+        {
+            uint64_t a = 0;
+            uint64_t b = 0;
+        };
+
+        hscpp::mem::MemoryManager::Config config;
+        config.bConcurrent = true;
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+
+        const size_t N_THREADS = 4;
+        const size_t N_OBJECTS = 64;
+
+        // Each thread keeps its own bulk allocation, and interleaved single allocations on other
+        // threads do not land in it.
+        std::atomic<bool> bContiguous = { true };
+
+        std::vector<std::thread> threads;
+        for (size_t iThread = 0; iThread < N_THREADS; ++iThread)
+        {
+            threads.emplace_back([&]() {
+                std::vector<UniqueRef<Data>> data = rMemoryManager->AllocateN<Data>(N_OBJECTS);
+                UniqueRef<Data> rSingleData = rMemoryManager->Allocate<Data>();
+
+                ptrdiff_t stride = reinterpret_cast<uint8_t*>(*data.at(1)) - reinterpret_cast<uint8_t*>(*data.at(0));
+                for (size_t i = 1; i < data.size(); ++i)
+                {
+                    if (reinterpret_cast<uint8_t*>(*data.at(i)) - reinterpret_cast<uint8_t*>(*data.at(i - 1)) != stride)
+                    {
+                        bContiguous = false;
+                    }
+                }
+            });
+        }
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(bContiguous.load());
+        REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+    }
+
+    TEST_CASE("MemoryManager keeps bulk allocations contiguous across swaps.")
+    {
+        hscpp::Hotswapper swapper;
+
+        hscpp::mem::MemoryManager::Config config;
+        config.pAllocationResolver = swapper.GetAllocationResolver();
+
+        UniqueRef<hscpp::mem::MemoryManager> rMemoryManager = hscpp::mem::MemoryManager::Create(config);
+        swapper.SetAllocator(&rMemoryManager);
+
+        std::vector<UniqueRef<CompactedData>> compactedData = rMemoryManager->AllocateN<CompactedData>(16);
+
+        std::vector<uint8_t*> memory;
+        for (size_t i = 0; i < compactedData.size(); ++i)
+        {
+            compactedData.at(i)->value = static_cast<int>(i);
+            memory.push_back(reinterpret_cast<uint8_t*>(*compactedData.at(i)));
+        }
+
+        ptrdiff_t stride = memory.at(1) - memory.at(0);
+        for (size_t i = 1; i < memory.size(); ++i)
+        {
+            REQUIRE(memory.at(i) - memory.at(i - 1) == stride);
+        }
+
+        // A swap to an implementation of the same size rebuilds every object in place.
+        swapper.GetAllocationResolver()->RebuildTrackedObjects("hscpp::test::CompactedData");
+        for (size_t i = 0; i < compactedData.size(); ++i)
+        {
+            REQUIRE(compactedData.at(i)->value == static_cast<int>(i));
+            REQUIRE(reinterpret_cast<uint8_t*>(*compactedData.at(i)) == memory.at(i));
+        }
+
+        // Drive a swap to a larger implementation through the interface hscpp uses. The objects
+        // no longer fit their slots, and move together into a new Region.
+        IAllocator* pAllocator = &rMemoryManager;
+
+        std::vector<uint64_t> ids;
+        pAllocator->Hscpp_BeginSwapBatch("hscpp::test::CompactedData", compactedData.size());
+        for (size_t i = 0; i < compactedData.size(); ++i)
+        {
+            (*compactedData.at(i))->~CompactedData();
+            ids.push_back(pAllocator->Hscpp_FreeSwap(memory.at(i)));
+        }
+
+        std::vector<uint8_t*> swappedMemory;
+        for (uint64_t id : ids)
+        {
+            AllocationInfo info = pAllocator->Hscpp_AllocateSwap(id, 256);
+            REQUIRE(info.id == id);
+            swappedMemory.push_back(info.pMemory);
+        }
+        pAllocator->Hscpp_EndSwapBatch();
+
+        ptrdiff_t swappedStride = swappedMemory.at(1) - swappedMemory.at(0);
+        REQUIRE(swappedStride >= 256);
+        for (size_t i = 1; i < swappedMemory.size(); ++i)
+        {
+            REQUIRE(swappedMemory.at(i) - swappedMemory.at(i - 1) == swappedStride);
+        }
+
+        // The raw memory no longer holds a CompactedData, so release the Blocks directly.
+        hscpp::mem::IMemoryManager* pMemoryManager = &rMemoryManager;
+        for (uint64_t id : ids)
+        {
+            pMemoryManager->FreeBlock(id, true);
+        }
+
+        REQUIRE(rMemoryManager->GetNumBlocks() == 0);
+    }
+
+}}
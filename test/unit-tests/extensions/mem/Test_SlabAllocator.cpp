@@ -0,0 +1,76 @@
+#include <unordered_set>
+
+#include "catch/catch.hpp"
+#include "common/Common.h"
+
+#include "hscpp/mem/SlabAllocator.h"
+
+namespace hscpp { namespace test {
+
+    TEST_CASE("SlabAllocator rounds sizes to aligned size classes.")
+    {
+        REQUIRE(hscpp::mem::SlabAllocator::GetSizeClass(1) == 16);
+        REQUIRE(hscpp::mem::SlabAllocator::GetSizeClass(16) == 16);
+        REQUIRE(hscpp::mem::SlabAllocator::GetSizeClass(17) == 32);
+        REQUIRE(hscpp::mem::SlabAllocator::GetSizeClass(128) == 128);
+        REQUIRE(hscpp::mem::SlabAllocator::GetSizeClass(129) == 160);
+        REQUIRE(hscpp::mem::SlabAllocator::GetSizeClass(257) == 320);
+        REQUIRE(hscpp::mem::SlabAllocator::GetSizeClass(2048) == 2048);
+        REQUIRE(hscpp::mem::SlabAllocator::GetSizeClass(5000) == 5000);
+
+        for (uint64_t size = 1; size <= hscpp::mem::SlabAllocator::MAX_SLOT_SIZE; ++size)
+        {
+            uint64_t sizeClass = hscpp::mem::SlabAllocator::GetSizeClass(size);
+            REQUIRE(sizeClass >= size);
+
+            // Size classes never lose alignment relative to the requested size.
+            uint64_t sizeAlignment = size & (~size + 1);
+            uint64_t classAlignment = sizeClass & (~sizeClass + 1);
+            REQUIRE(classAlignment >= (std::min)(sizeAlignment, uint64_t(16)));
+        }
+    }
+
+    TEST_CASE("SlabAllocator can allocate and recycle slots.")
+    {
+        hscpp::mem::SlabAllocator allocator;
+
+        std::vector<uint8_t*> allocations;
+        std::unordered_set<uint8_t*> uniqueAllocations;
+
+        for (size_t i = 0; i < 10000; ++i)
+        {
+            uint8_t* pMemory = allocator.Allocate(48);
+            REQUIRE(reinterpret_cast<uintptr_t>(pMemory) % 16 == 0);
+
+            // Touch all the memory, to ensure slots do not overlap.
+            std::fill(pMemory, pMemory + 48, static_cast<uint8_t>(i));
+
+            allocations.push_back(pMemory);
+            uniqueAllocations.insert(pMemory);
+        }
+
+        REQUIRE(uniqueAllocations.size() == allocations.size());
+
+        uint64_t nSlabs = allocator.GetNumSlabs();
+        for (uint8_t* pMemory : allocations)
+        {
+            allocator.Free(pMemory, 48);
+        }
+
+        // Freed slots are reused by allocations of the same size class.
+        for (size_t i = 0; i < 10000; ++i)
+        {
+            uint8_t* pMemory = allocator.Allocate(40);
+            REQUIRE(uniqueAllocations.find(pMemory) != uniqueAllocations.end());
+        }
+
+        REQUIRE(allocator.GetNumSlabs() == nSlabs);
+
+        // Large allocations bypass the slabs.
+        uint8_t* pLarge = allocator.Allocate(100000);
+        REQUIRE(reinterpret_cast<uintptr_t>(pLarge) % hscpp::mem::SlabAllocator::MAX_ALIGNMENT == 0);
+        REQUIRE(allocator.GetNumSlabs() == nSlabs);
+        allocator.Free(pLarge, 100000);
+    }
+
+}}